@@ -6,16 +6,19 @@
 CPP_SRCS += \
 ../Source/costmap/costmap_2d/CostMap2D.cpp \
 ../Source/costmap/costmap_2d/CostMapLayer.cpp \
+../Source/costmap/costmap_2d/FreeSpaceComponents.cpp \
 ../Source/costmap/costmap_2d/LayeredCostMap.cpp 
 
 OBJS += \
 ./Source/costmap/costmap_2d/CostMap2D.o \
 ./Source/costmap/costmap_2d/CostMapLayer.o \
+./Source/costmap/costmap_2d/FreeSpaceComponents.o \
 ./Source/costmap/costmap_2d/LayeredCostMap.o 
 
 CPP_DEPS += \
 ./Source/costmap/costmap_2d/CostMap2D.d \
 ./Source/costmap/costmap_2d/CostMapLayer.d \
+./Source/costmap/costmap_2d/FreeSpaceComponents.d \
 ./Source/costmap/costmap_2d/LayeredCostMap.d 
 
 
@@ -4,24 +4,39 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../Source/planner/implements/GlobalPlanner/Algorithm/AnytimeAstar.cpp \
 ../Source/planner/implements/GlobalPlanner/Algorithm/Astar.cpp \
+../Source/planner/implements/GlobalPlanner/Algorithm/Bidirectional.cpp \
 ../Source/planner/implements/GlobalPlanner/Algorithm/Dijkstra.cpp \
+../Source/planner/implements/GlobalPlanner/Algorithm/FixedPoint.cpp \
 ../Source/planner/implements/GlobalPlanner/Algorithm/GradientPath.cpp \
+../Source/planner/implements/GlobalPlanner/Algorithm/JumpPoint.cpp \
 ../Source/planner/implements/GlobalPlanner/Algorithm/OrientationFilter.cpp \
+../Source/planner/implements/GlobalPlanner/Algorithm/PathSimplifier.cpp \
 ../Source/planner/implements/GlobalPlanner/Algorithm/QuadraticCalculator.cpp 
 
 OBJS += \
+./Source/planner/implements/GlobalPlanner/Algorithm/AnytimeAstar.o \
 ./Source/planner/implements/GlobalPlanner/Algorithm/Astar.o \
+./Source/planner/implements/GlobalPlanner/Algorithm/Bidirectional.o \
 ./Source/planner/implements/GlobalPlanner/Algorithm/Dijkstra.o \
+./Source/planner/implements/GlobalPlanner/Algorithm/FixedPoint.o \
 ./Source/planner/implements/GlobalPlanner/Algorithm/GradientPath.o \
+./Source/planner/implements/GlobalPlanner/Algorithm/JumpPoint.o \
 ./Source/planner/implements/GlobalPlanner/Algorithm/OrientationFilter.o \
+./Source/planner/implements/GlobalPlanner/Algorithm/PathSimplifier.o \
 ./Source/planner/implements/GlobalPlanner/Algorithm/QuadraticCalculator.o 
 
 CPP_DEPS += \
+./Source/planner/implements/GlobalPlanner/Algorithm/AnytimeAstar.d \
 ./Source/planner/implements/GlobalPlanner/Algorithm/Astar.d \
+./Source/planner/implements/GlobalPlanner/Algorithm/Bidirectional.d \
 ./Source/planner/implements/GlobalPlanner/Algorithm/Dijkstra.d \
+./Source/planner/implements/GlobalPlanner/Algorithm/FixedPoint.d \
 ./Source/planner/implements/GlobalPlanner/Algorithm/GradientPath.d \
+./Source/planner/implements/GlobalPlanner/Algorithm/JumpPoint.d \
 ./Source/planner/implements/GlobalPlanner/Algorithm/OrientationFilter.d \
+./Source/planner/implements/GlobalPlanner/Algorithm/PathSimplifier.d \
 ./Source/planner/implements/GlobalPlanner/Algorithm/QuadraticCalculator.d 
 
 
@@ -7,31 +7,34 @@ CPP_SRCS += \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.cpp \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/FootprintHelper.cpp \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/GoalFunctions.cpp \
-../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapCell.cpp \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapGrid.cpp \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/OdometryHelper.cpp \
+../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/RolloutWorkers.cpp \
 ../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/Trajectory.cpp \
-../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.cpp 
+../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.cpp \
+../Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPrimitives.cpp 
 
 OBJS += \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.o \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/FootprintHelper.o \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/GoalFunctions.o \
-./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapCell.o \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapGrid.o \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/OdometryHelper.o \
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/RolloutWorkers.o \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/Trajectory.o \
-./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.o 
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.o \
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPrimitives.o 
 
 CPP_DEPS += \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.d \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/FootprintHelper.d \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/GoalFunctions.d \
-./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapCell.d \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/MapGrid.d \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/OdometryHelper.d \
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/RolloutWorkers.d \
 ./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/Trajectory.d \
-./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.d 
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.d \
+./Source/planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPrimitives.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -5,15 +5,18 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
 ../Source/Main.cpp \
-../Source/NavigationApplication.cpp 
+../Source/NavigationApplication.cpp \
+../Source/PlanMonitor.cpp 
 
 OBJS += \
 ./Source/Main.o \
-./Source/NavigationApplication.o 
+./Source/NavigationApplication.o \
+./Source/PlanMonitor.o 
 
 CPP_DEPS += \
 ./Source/Main.d \
-./Source/NavigationApplication.d 
+./Source/NavigationApplication.d \
+./Source/PlanMonitor.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -0,0 +1,233 @@
+/*
+ * Compares the fixed point potentials of FixedPointExpansion (uint16_t and
+ * uint32_t, as compact_potential 16 and 32 of GlobalPlanner) with the float
+ * DijkstraExpansion on synthetic maps of square obstacles.
+ * The error is measured against a float heap Dijkstra with the same order of
+ * updates as the fixed point expansion, and checked against the bound
+ * documented in FixedPoint.h. Reports the expansion latency, the path length
+ * and the bytes a cell costs in each mode.
+ *
+ * usage: FixedPointBenchmark [obstacles per 10000 cells], exits with 1 if
+ * an error is over its bound or a plan fails
+ */
+#include "planner/implements/GlobalPlanner/Algorithm/Dijkstra.h"
+#include "planner/implements/GlobalPlanner/Algorithm/FixedPoint.h"
+#include "planner/implements/GlobalPlanner/Algorithm/QuadraticCalculator.h"
+#include "planner/implements/GlobalPlanner/Algorithm/GradientPath.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <queue>
+
+using namespace NS_Planner;
+
+static const int LETHAL_COST = 253;
+static const int NEUTRAL_COST = 66;
+static const float COST_FACTOR = 0.55;
+
+static double milliseconds(clock_t begin)
+{
+  return (double)(clock() - begin) * 1000 / CLOCKS_PER_SEC;
+}
+
+/**
+ * float Dijkstra on a binary heap, seeded like FixedPointExpansion
+ */
+static void referencePotential(const std::vector< unsigned char >& costs,
+                               int nx, int ny, double start_x, double start_y,
+                               int goal, QuadraticCalculator& calculator,
+                               std::vector< float >& potential)
+{
+  typedef std::pair< float, int > Entry;
+  std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > > open;
+  potential.assign(nx * ny, POT_HIGH);
+
+  int k = (int)start_x + (int)start_y * nx;
+  double dx = floor((start_x - (int)start_x) * 100 + 0.5) / 100;
+  double dy = floor((start_y - (int)start_y) * 100 + 0.5) / 100;
+  double seed = 2 * NEUTRAL_COST;
+  int seeds[4] = {k, k + 1, k + nx, k + nx + 1};
+  float values[4] = {(float)(seed * dx * dy), (float)(seed * (1 - dx) * dy),
+      (float)(seed * dx * (1 - dy)), (float)(seed * (1 - dx) * (1 - dy))};
+  for(int i = 0; i < 4; i++)
+  {
+    potential[seeds[i]] = values[i];
+    open.push(Entry(values[i], seeds[i]));
+  }
+
+  while(!open.empty())
+  {
+    Entry top = open.top();
+    open.pop();
+    int n = top.second;
+    if(top.first != potential[n])
+      continue;
+    if(n == goal)
+      break;
+    int neighbours[4] = {n + 1, n - 1, n + nx, n - nx};
+    for(int i = 0; i < 4; i++)
+    {
+      int m = neighbours[i];
+      float cost = costs[m];
+      if(cost >= LETHAL_COST)
+        continue;
+      cost = std::min(cost * COST_FACTOR + NEUTRAL_COST, LETHAL_COST - 1.f);
+      float value = calculator.calculatePotential(&potential[0],
+                                                  (unsigned char)cost, m, -1);
+      if(value < potential[m])
+      {
+        potential[m] = value;
+        open.push(Entry(value, m));
+      }
+    }
+  }
+}
+
+static double pathLength(const std::vector< std::pair< float, float > >& path)
+{
+  double length = 0;
+  for(size_t i = 1; i < path.size(); i++)
+    length += hypot(path[i].first - path[i - 1].first,
+                    path[i].second - path[i - 1].second);
+  return length;
+}
+
+/**
+ * n x n map with a lethal border and square obstacles of an inflated ring,
+ * start and goal areas are kept free
+ */
+static void makeMap(int n, int obstacles, std::vector< unsigned char >& costs,
+                    double& start_x, double& start_y, double& goal_x,
+                    double& goal_y)
+{
+  costs.assign(n * n, 0);
+  srand(1);
+  for(int k = 0; k < obstacles; k++)
+  {
+    int x = rand() % n, y = rand() % n;
+    for(int j = -6; j <= 6; j++)
+    {
+      for(int i = -6; i <= 6; i++)
+      {
+        if(x + i < 0 || x + i >= n || y + j < 0 || y + j >= n)
+          continue;
+        int d = std::max(abs(i), abs(j));
+        int cost = d <= 3 ? 254 : d == 4 ? 253 : 200 - 20 * d;
+        unsigned char& cell = costs[x + i + (y + j) * n];
+        cell = std::max((int)cell, cost);
+      }
+    }
+  }
+  for(int i = 0; i < n; i++)
+  {
+    costs[i] = costs[i + (n - 1) * n] = 254;
+    costs[i * n] = costs[i * n + n - 1] = 254;
+  }
+  start_x = 20.3;
+  start_y = 20.4;
+  goal_x = n - 19.8;
+  goal_y = n - 29.3;
+  for(int j = -8; j <= 8; j++)
+  {
+    for(int i = -8; i <= 8; i++)
+    {
+      costs[(int)start_x + i + ((int)start_y + j) * n] = 0;
+      costs[(int)goal_x + i + ((int)goal_y + j) * n] = 0;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int density = argc > 1 ? atoi(argv[1]) : 20;
+  int sizes[] = {400, 1500};
+  int failures = 0;
+
+  for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    int n = sizes[s];
+    std::vector< unsigned char > costs;
+    double start_x, start_y, goal_x, goal_y;
+    makeMap(n, n * n / 10000 * density, costs, start_x, start_y, goal_x,
+            goal_y);
+    int goal = (int)goal_x + (int)goal_y * n;
+
+    QuadraticCalculator calculator(n, n);
+    GradientPath path_maker(&calculator);
+    path_maker.setCacheGradients(false);
+    path_maker.setSize(n, n);
+    path_maker.setLethalCost(LETHAL_COST);
+
+    //the float mode of GlobalPlanner, gradient cache on
+    std::vector< float > potential(n * n);
+    DijkstraExpansion dijkstra(&calculator, n, n);
+    dijkstra.setPreciseStart(true);
+    dijkstra.setSize(n, n);
+    dijkstra.setLethalCost(LETHAL_COST);
+    dijkstra.setNeutralCost(NEUTRAL_COST);
+    dijkstra.setFactor(COST_FACTOR);
+    clock_t begin = clock();
+    bool found = dijkstra.calculatePotentials(&costs[0], start_x, start_y,
+                                              goal_x, goal_y, n * n * 2,
+                                              &potential[0]);
+    double expand_ms = milliseconds(begin);
+    dijkstra.clearEndpoint(&costs[0], &potential[0], (int)goal_x, (int)goal_y,
+                           2);
+    std::vector< std::pair< float, float > > path;
+    found = found
+        && path_maker.getPath(&potential[0], start_x, start_y, goal_x, goal_y,
+                              path);
+    failures += !found;
+    printf("%dx%d float     %8.1f ms  path %7.2f cells  %2d bytes per cell"
+           " (potential, gradients, epoch)\n", n, n, expand_ms,
+           pathLength(path), (int)(sizeof(float) * 4));
+
+    std::vector< float > reference;
+    referencePotential(costs, n, n, start_x, start_y, goal, calculator,
+                       reference);
+
+    FixedPointExpansion< uint16_t > fixed16(n, n);
+    FixedPointExpansion< uint32_t > fixed32(n, n);
+    FixedPointExpander* expanders[2] = {&fixed16, &fixed32};
+    for(int e = 0; e < 2; e++)
+    {
+      FixedPointExpander* fixed = expanders[e];
+      fixed->setLethalCost(LETHAL_COST);
+      fixed->setNeutralCost(NEUTRAL_COST);
+      fixed->setFactor(COST_FACTOR);
+      begin = clock();
+      bool fixed_found = fixed->calculatePotentials(&costs[0], start_x,
+                                                    start_y, goal_x, goal_y,
+                                                    n * n * 2, NULL);
+      expand_ms = milliseconds(begin);
+      fixed->clearEndpoint(&costs[0], (int)goal_x, (int)goal_y, 2);
+      std::vector< std::pair< float, float > > fixed_path;
+      fixed_found = fixed_found
+          && fixed->getPath(&path_maker, start_x, start_y, goal_x, goal_y,
+                            fixed_path);
+      failures += !fixed_found;
+
+      //cells settled before the goal, away from the seed
+      double max_error = 0;
+      for(int i = 0; i < n * n; i++)
+      {
+        float value = fixed->potentialAt(i);
+        if(reference[i] < reference[goal] && reference[i] > 500
+            && value < POT_HIGH)
+          max_error = std::max(
+              max_error, (double)fabs(value - reference[i]) / reference[i]);
+      }
+      double bound = 1 / (0.704 * fixed->getAppliedScale() * NEUTRAL_COST)
+          + 0.0004;
+      failures += max_error > bound;
+      printf("%dx%d uint%d_t  %8.1f ms  path %7.2f cells  %2d bytes per cell"
+             "  scale %.3f  max error %.3f%% (bound %.3f%%)  %d saturated\n",
+             n, n, e ? 32 : 16, expand_ms, pathLength(fixed_path),
+             fixed->getBytesPerCell(), fixed->getAppliedScale(),
+             max_error * 100, bound * 100, fixed->getSaturated());
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
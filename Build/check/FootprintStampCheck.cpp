@@ -0,0 +1,113 @@
+/*
+ * Compares the footprint stamps of CostmapModel against the exact
+ * rasterization of the oriented footprint (the Point2D overload).
+ * For random poses a single lethal cell is put at every spot near the robot,
+ * a stamp may report extra edge cells but must never miss one.
+ *
+ * usage: FootprintStampCheck [poses], exits with 1 if a cell was missed
+ */
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.h"
+#include "costmap/costmap_2d/CostValues.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+using namespace NS_Planner;
+
+static double exactCost(CostmapModel& model, double x, double y, double theta,
+                        const std::vector< Point2D >& footprint)
+{
+  std::vector< Point2D > oriented;
+  for(size_t i = 0; i < footprint.size(); i++)
+  {
+    Point2D p;
+    p.x() = x + footprint[i].x() * cos(theta) - footprint[i].y() * sin(theta);
+    p.y() = y + footprint[i].x() * sin(theta) + footprint[i].y() * cos(theta);
+    oriented.push_back(p);
+  }
+  Point2D position;
+  position.x() = x;
+  position.y() = y;
+  return model.footprintCost(position, oriented, 0.15, 0.3);
+}
+
+static double uniform(double min, double max)
+{
+  return min + rand() / (double)RAND_MAX * (max - min);
+}
+
+int main(int argc, char** argv)
+{
+  int poses = argc > 1 ? atoi(argv[1]) : 30000;
+
+  NS_CostMap::Costmap2D map(200, 200, 0.05, 0, 0);
+  CostmapModel model(map);
+  //a pentagon, not symmetric about the robot center
+  double points[][2] = { {0.25, 0.15}, {0.25, -0.15}, {-0.2, -0.18}, {-0.25, 0},
+      {-0.2, 0.18}};
+  std::vector< Point2D > footprint;
+  for(size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+  {
+    Point2D p;
+    p.x() = points[i][0];
+    p.y() = points[i][1];
+    footprint.push_back(p);
+  }
+
+  clock_t begin = clock();
+  model.footprintCost(3, 3, 0, footprint);
+  printf("stamps built in %.1f ms\n",
+         (double)(clock() - begin) * 1000 / CLOCKS_PER_SEC);
+
+  srand(1);
+  long exact_cells = 0, missed = 0, extra = 0;
+  for(int k = 0; k < poses; k++)
+  {
+    double x = uniform(2, 8), y = uniform(2, 8);
+    double theta = uniform(-2 * M_PI, 2 * M_PI);
+    unsigned int cell_x = 0, cell_y = 0;
+    map.worldToMap(x, y, cell_x, cell_y);
+    for(int dy = -10; dy <= 10; dy++)
+    {
+      for(int dx = -10; dx <= 10; dx++)
+      {
+        map.setCost(cell_x + dx, cell_y + dy, NS_CostMap::LETHAL_OBSTACLE);
+        bool stamp = model.footprintCost(x, y, theta, footprint) < 0;
+        bool exact = exactCost(model, x, y, theta, footprint) < 0;
+        map.setCost(cell_x + dx, cell_y + dy, NS_CostMap::FREE_SPACE);
+        exact_cells += exact;
+        if(exact && !stamp)
+        {
+          missed++;
+          printf("missed cell %d , %d of the pose %.6f , %.6f , %.6f\n", dx,
+                 dy, x, y, theta);
+        }
+        else if(stamp && !exact)
+          extra++;
+      }
+    }
+  }
+  printf("%d poses: %ld exact cells, %ld missed, %ld extra\n", poses,
+         exact_cells, missed, extra);
+
+  //both on a map with some cost everywhere, nothing lethal
+  for(unsigned int i = 0; i < 200 * 200; i += 7)
+    map.setCost(i % 200, i / 200, (i * 13) % 200);
+  int queries = 200000;
+  volatile double sum = 0;
+  begin = clock();
+  for(int i = 0; i < queries; i++)
+    sum += model.footprintCost(3 + i % 1000 * 0.003, 4 + i % 777 * 0.003,
+                               i * 0.01, footprint);
+  double stamp_ns = (double)(clock() - begin) / CLOCKS_PER_SEC / queries * 1e9;
+  begin = clock();
+  for(int i = 0; i < queries; i++)
+    sum += exactCost(model, 3 + i % 1000 * 0.003, 4 + i % 777 * 0.003,
+                     i * 0.01, footprint);
+  double exact_ns = (double)(clock() - begin) / CLOCKS_PER_SEC / queries * 1e9;
+  printf("stamp %.0f ns per query, exact rasterization %.0f ns per query\n",
+         stamp_ns, exact_ns);
+
+  return missed == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+ * Times MapGrid::setTargetCells over the whole costmap, that is markBlocked
+ * plus the path distance wavefront, on random costmaps with about 6% blocked
+ * cells and a winding plan, and compares every distance with a plain breadth
+ * first search over a std::queue.
+ *
+ * usage: MapGridBenchmark [max size], exits with 1 if a distance differs
+ */
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/MapGrid.h"
+#include "costmap/costmap_2d/CostValues.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <queue>
+
+using namespace NS_Planner;
+
+/**
+ * distances from the plan cells, a blocked cell is reached but not left
+ */
+static void referenceDistance(const NS_CostMap::Costmap2D& costmap,
+                              const std::vector< Pose2D >& plan,
+                              float obstacle, float unreachable,
+                              std::vector< float >& dist)
+{
+  int size_x = costmap.getSizeInCellsX(), size_y = costmap.getSizeInCellsY();
+  dist.assign(size_x * size_y, unreachable);
+  std::vector< bool > visited(size_x * size_y, false);
+  std::queue< int > cells;
+  bool started_path = false;
+  for(size_t i = 0; i < plan.size(); i++)
+  {
+    unsigned int x, y;
+    if(costmap.worldToMap(plan[i].x(), plan[i].y(), x, y)
+        && costmap.getCost(x, y) != NS_CostMap::NO_INFORMATION)
+    {
+      int index = x + y * size_x;
+      if(!visited[index])
+      {
+        visited[index] = true;
+        dist[index] = 0;
+        cells.push(index);
+      }
+      started_path = true;
+    }
+    else if(started_path)
+      break;
+  }
+
+  while(!cells.empty())
+  {
+    int index = cells.front();
+    cells.pop();
+    int x = index % size_x, y = index / size_x;
+    int nx[4] = {x - 1, x + 1, x, x};
+    int ny[4] = {y, y, y - 1, y + 1};
+    for(int i = 0; i < 4; i++)
+    {
+      if(nx[i] < 0 || ny[i] < 0 || nx[i] >= size_x || ny[i] >= size_y)
+        continue;
+      int next = nx[i] + ny[i] * size_x;
+      if(visited[next])
+        continue;
+      visited[next] = true;
+      unsigned char cost = costmap.getCost(nx[i], ny[i]);
+      if(cost == NS_CostMap::LETHAL_OBSTACLE
+          || cost == NS_CostMap::INSCRIBED_INFLATED_OBSTACLE
+          || cost == NS_CostMap::NO_INFORMATION)
+      {
+        dist[next] = obstacle;
+        continue;
+      }
+      dist[next] = dist[index] + 1;
+      cells.push(next);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int max_size = argc > 1 ? atoi(argv[1]) : 1600;
+  double resolution = 0.05;
+
+  long mismatches = 0;
+  printf("     size    setTargetCells   reference bfs\n");
+  for(int n = 100; n <= max_size; n *= 2)
+  {
+    NS_CostMap::Costmap2D costmap(n, n, resolution, 0, 0);
+    srand(1);
+    for(int y = 0; y < n; y++)
+    {
+      for(int x = 0; x < n; x++)
+      {
+        int r = rand() % 100;
+        costmap.setCost(x, y, r < 3 ? NS_CostMap::LETHAL_OBSTACLE :
+                        r < 5 ? NS_CostMap::INSCRIBED_INFLATED_OBSTACLE :
+                        r < 6 ? NS_CostMap::NO_INFORMATION : rand() % 200);
+      }
+    }
+    std::vector< Pose2D > plan, adjusted;
+    for(int i = 0; i < n; i++)
+      plan.push_back(
+          Pose2D((i + 0.5) * resolution,
+                 n * resolution * (0.5 + 0.15 * sin(i * 0.03)), 0));
+    MapGrid::adjustPlanResolution(plan, adjusted, resolution);
+
+    MapGrid grid;
+    int repeats = std::max(3, 2000000 / (n * n));
+    clock_t begin = clock();
+    for(int r = 0; r < repeats; r++)
+    {
+      grid.setWindow(costmap);
+      grid.setTargetCells(costmap, adjusted, 0);
+    }
+    double grid_ms = (double)(clock() - begin) * 1000 / CLOCKS_PER_SEC
+        / repeats;
+
+    std::vector< float > dist;
+    begin = clock();
+    for(int r = 0; r < repeats; r++)
+      referenceDistance(costmap, adjusted, grid.obstacleCosts(),
+                        grid.unreachableCellCosts(), dist);
+    double reference_ms = (double)(clock() - begin) * 1000 / CLOCKS_PER_SEC
+        / repeats;
+
+    long size_mismatches = 0;
+    for(int y = 0; y < n; y++)
+      for(int x = 0; x < n; x++)
+        size_mismatches += grid.getTargetDist(x, y) != dist[x + y * n];
+    mismatches += size_mismatches;
+    printf("%4dx%-4d  %10.3f ms   %10.3f ms   %ld distances differ\n", n, n,
+           grid_ms, reference_ms, size_mismatches);
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*
+ * Times TrajectoryPlanner::findBestPath per control cycle for a number of
+ * rollout threads, the robot drives a winding plan between obstacles.
+ * Every thread count must pick the same velocities as one thread.
+ *
+ * usage: RolloutBenchmark [max threads] [cycles], max threads defaults to
+ * the cores of the host, exits with 1 if a command differs. The planner logs
+ * to stdout too, the results are the lines with "per cycle"
+ */
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPlanner.h"
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.h"
+#include "costmap/costmap_2d/CostValues.h"
+#include <boost/thread.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace NS_Planner;
+
+struct Command
+{
+  double linear, angular;
+};
+
+/**
+ * drive the plan for cycles control cycles, returns the wall time of a cycle in ms
+ */
+static double drive(const NS_CostMap::Costmap2D& costmap,
+                    const std::vector< Point2D >& footprint,
+                    const std::vector< Pose2D >& plan, int threads, int cycles,
+                    int vx_samples, int vtheta_samples,
+                    std::vector< Command >& commands)
+{
+  CostmapModel world_model(costmap);
+  TrajectoryPlanner planner(world_model, costmap, footprint, 2.5, 0, 3.2, 1.5,
+                            0.025, vx_samples, vtheta_samples, 0.75, 1.0, 0.01,
+                            1.0, 0.05, 0.1, M_PI_2, false, 0.5, 0.1, 1.0, -1.0,
+                            0.4, -0.1, true, true, 0.8, true, false,
+                            std::vector< double >(), 0.2, 0.2, 0.025, 0.22,
+                            0.15, threads);
+
+  Pose2D pose(1.0, 3.0, 0.2);
+  Velocity2D velocity;
+  velocity.linear = 0;
+  velocity.angular = 0;
+  commands.clear();
+  double total = 0;
+  for(int k = 0; k < cycles; k++)
+  {
+    std::chrono::steady_clock::time_point begin =
+        std::chrono::steady_clock::now();
+    planner.updatePlan(plan);
+    Velocity2D command;
+    planner.findBestPath(pose, velocity, command);
+    total += std::chrono::duration< double, std::milli >(
+        std::chrono::steady_clock::now() - begin).count();
+
+    Command c = {command.linear, command.angular};
+    commands.push_back(c);
+    double theta = pose.theta() + command.angular * 0.2;
+    pose = Pose2D(pose.x() + command.linear * cos(theta) * 0.2,
+                  pose.y() + command.linear * sin(theta) * 0.2, theta);
+    velocity = command;
+  }
+  return total / cycles;
+}
+
+int main(int argc, char** argv)
+{
+  int cores = boost::thread::hardware_concurrency();
+  int max_threads = argc > 1 ? atoi(argv[1]) : std::max(cores, 1);
+  int cycles = argc > 2 ? atoi(argv[2]) : 150;
+
+  //12 x 12 m, obstacles with an inflation ramp
+  double resolution = 0.05;
+  int n = 240;
+  NS_CostMap::Costmap2D costmap(n, n, resolution, 0, 0);
+  double obstacles[][2] = { {3.0, 2.85}, {5.0, 2.55}, {7.0, 3.6}, {4.2, 4.1},
+      {8.5, 2.3}};
+  for(int y = 0; y < n; y++)
+  {
+    for(int x = 0; x < n; x++)
+    {
+      double wx = (x + 0.5) * resolution, wy = (y + 0.5) * resolution;
+      double d = 1e9;
+      for(size_t i = 0; i < sizeof(obstacles) / sizeof(obstacles[0]); i++)
+        d = std::min(d, hypot(wx - obstacles[i][0], wy - obstacles[i][1]));
+      int cost = 0;
+      if(d < 0.15 || x == 0 || y == 0 || x == n - 1 || y == n - 1)
+        cost = NS_CostMap::LETHAL_OBSTACLE;
+      else if(d < 0.25)
+        cost = NS_CostMap::INSCRIBED_INFLATED_OBSTACLE;
+      else if(d < 0.8)
+        cost = int(252 * exp(-5 * (d - 0.25)));
+      costmap.setCost(x, y, cost);
+    }
+  }
+  std::vector< Point2D > footprint;
+  double points[][2] = { {0.15, 0.15}, {-0.15, 0.15}, {-0.15, -0.15}, {0.15,
+      -0.15}};
+  for(size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+  {
+    Point2D p;
+    p.x() = points[i][0];
+    p.y() = points[i][1];
+    footprint.push_back(p);
+  }
+  std::vector< Pose2D > plan;
+  for(int i = 0; i <= 200; i++)
+    plan.push_back(Pose2D(1.0 + i * 0.05, 3.0 + 0.4 * sin(i * 0.05), 0));
+
+  printf("%d cores, %d cycles\n", cores, cycles);
+  int samples[][2] = { {8, 20}, {20, 40}};
+  int differ = 0;
+  for(size_t s = 0; s < sizeof(samples) / sizeof(samples[0]); s++)
+  {
+    std::vector< Command > single, commands;
+    double single_ms = 0;
+    for(int threads = 1; threads <= max_threads; threads++)
+    {
+      double ms = drive(costmap, footprint, plan, threads, cycles,
+                        samples[s][0], samples[s][1],
+                        threads == 1 ? single : commands);
+      if(threads == 1)
+        single_ms = ms;
+      int cycle_differ = 0;
+      for(size_t k = 0; threads > 1 && k < commands.size(); k++)
+        cycle_differ += commands[k].linear != single[k].linear
+            || commands[k].angular != single[k].angular;
+      differ += cycle_differ;
+      printf("%2d x %2d samples  %d threads  %7.3f ms per cycle  speedup %.2f"
+             "  %d commands differ\n", samples[s][0], samples[s][1], threads,
+             ms, single_ms / ms, cycle_differ);
+    }
+  }
+
+  return differ == 0 ? 0 : 1;
+}
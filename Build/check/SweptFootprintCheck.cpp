@@ -0,0 +1,140 @@
+/*
+ * Compares the swept footprint of TrajectoryPrimitives against the exact
+ * rasterization of the oriented footprint (the Point2D overload of
+ * CostmapModel) at every pose of the primitive.
+ * For random primitives and start poses a single lethal cell is put at every
+ * spot near each pose that the swept points do not hit, the sweep may hit
+ * extra cells but must never miss one.
+ *
+ * usage: SweptFootprintCheck [primitives], exits with 1 if a cell was missed
+ */
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/CostmapModel.h"
+#include "planner/implements/TrajectoryLocalPlanner/Algorithm/TrajectoryPrimitives.h"
+#include "costmap/costmap_2d/CostValues.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <set>
+
+using namespace NS_Planner;
+
+static double exactCost(CostmapModel& model, double x, double y, double theta,
+                        const std::vector< Point2D >& footprint)
+{
+  std::vector< Point2D > oriented;
+  for(size_t i = 0; i < footprint.size(); i++)
+  {
+    Point2D p;
+    p.x() = x + footprint[i].x() * cos(theta) - footprint[i].y() * sin(theta);
+    p.y() = y + footprint[i].x() * sin(theta) + footprint[i].y() * cos(theta);
+    oriented.push_back(p);
+  }
+  Point2D position;
+  position.x() = x;
+  position.y() = y;
+  return model.footprintCost(position, oriented, 0.15, 0.3);
+}
+
+static double uniform(double min, double max)
+{
+  return min + rand() / (double)RAND_MAX * (max - min);
+}
+
+int main(int argc, char** argv)
+{
+  int trials = argc > 1 ? atoi(argv[1]) : 100;
+
+  double resolution = 0.05;
+  NS_CostMap::Costmap2D map(300, 300, resolution, 0, 0);
+  CostmapModel model(map);
+  //a pentagon, not symmetric about the robot center
+  double points[][2] = { {0.25, 0.15}, {0.25, -0.15}, {-0.2, -0.18}, {-0.25, 0},
+      {-0.2, 0.18}};
+  std::vector< Point2D > footprint;
+  for(size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+  {
+    Point2D p;
+    p.x() = points[i][0];
+    p.y() = points[i][1];
+    footprint.push_back(p);
+  }
+
+  TrajectoryPrimitives primitives;
+  primitives.setModel(0.01, 0.02, 1.7, 0.025, 0.1, false, 2.5, 3.2, footprint,
+                      resolution);
+
+  srand(1);
+  long swept_cells = 0, exact_cells = 0, missed = 0;
+  double sweep_ms = 0;
+  for(int k = 0; k < trials; k++)
+  {
+    TrajectoryPrimitive* primitive = primitives.add(uniform(0, 0.5),
+                                                    uniform(-1, 1),
+                                                    uniform(0, 0.6),
+                                                    uniform(-1.5, 1.5));
+    if(!primitive)
+      continue;
+    primitives.build(*primitive);
+    clock_t begin = clock();
+    primitives.sweep(*primitive);
+    sweep_ms += (double)(clock() - begin) * 1000 / CLOCKS_PER_SEC;
+
+    //the same transform as TrajectoryPlanner::generateTrajectory
+    double x = uniform(5, 10), y = uniform(5, 10);
+    double theta = uniform(-M_PI, M_PI);
+    double cos_th = cos(theta), sin_th = sin(theta);
+    double step = primitives.sweptStep();
+    std::set< std::pair< unsigned int, unsigned int > > swept;
+    for(size_t i = 0; i < primitive->swept_x.size(); i++)
+    {
+      double sx = primitive->swept_x[i] * step;
+      double sy = primitive->swept_y[i] * step;
+      unsigned int cell_x, cell_y;
+      if(map.worldToMap(x + sx * cos_th - sy * sin_th,
+                        y + sx * sin_th + sy * cos_th, cell_x, cell_y))
+        swept.insert(std::make_pair(cell_x, cell_y));
+    }
+    swept_cells += swept.size();
+
+    std::set< std::pair< unsigned int, unsigned int > > exact;
+    for(size_t i = 0; i < primitive->x.size(); i++)
+    {
+      double x_i = x + primitive->x[i] * cos_th - primitive->y[i] * sin_th;
+      double y_i = y + primitive->x[i] * sin_th + primitive->y[i] * cos_th;
+      double theta_i = theta + primitive->theta[i];
+      unsigned int cell_x = 0, cell_y = 0;
+      map.worldToMap(x_i, y_i, cell_x, cell_y);
+      for(int dy = -8; dy <= 8; dy++)
+      {
+        for(int dx = -8; dx <= 8; dx++)
+        {
+          std::pair< unsigned int, unsigned int > cell(cell_x + dx,
+                                                       cell_y + dy);
+          if(exact.count(cell))
+            continue;
+          map.setCost(cell.first, cell.second, NS_CostMap::LETHAL_OBSTACLE);
+          bool hit = exactCost(model, x_i, y_i, theta_i, footprint) < 0;
+          map.setCost(cell.first, cell.second, NS_CostMap::FREE_SPACE);
+          if(!hit)
+            continue;
+          exact.insert(cell);
+          if(!swept.count(cell))
+          {
+            missed++;
+            printf("missed cell %d , %d of pose %d of the primitive %.3f , %.3f"
+                   " -> %.3f , %.3f\n", dx, dy, (int)i, primitive->vx,
+                   primitive->vtheta, primitive->vx_samp,
+                   primitive->vtheta_samp);
+          }
+        }
+      }
+    }
+    exact_cells += exact.size();
+  }
+  printf("%d primitives: %ld exact cells, %ld swept cells, %ld missed,"
+         " %.2f ms per sweep\n", trials, exact_cells, swept_cells, missed,
+         sweep_ms / trials);
+
+  return missed == 0 ? 0 : 1;
+}
@@ -31,6 +31,7 @@ Source/costmap/utils \
 Source/planner/implements/FTCLocalPlanner \
 Source/planner/implements/GlobalPlanner/Algorithm \
 Source/planner/implements/GlobalPlanner \
+Source/planner/implements/LatticePlanner \
 Source/planner/implements/TrajectoryLocalPlanner/Algorithm \
 Source/planner/implements/TrajectoryLocalPlanner \
 
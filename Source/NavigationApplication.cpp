@@ -8,16 +8,22 @@
 #include "NavigationApplication.h"
 #include <Parameter/Parameter.h>
 #include "planner/implements/GlobalPlanner/GlobalPlanner.h"
+#include "planner/implements/LatticePlanner/LatticePlanner.h"
 #include "planner/implements/TrajectoryLocalPlanner/TrajectoryLocalPlanner.h"
 #include "planner/implements/FTCLocalPlanner/ftc_planner.h"
 #include <type/map2d.h>
 namespace NS_Navigation {
 
 NavigationApplication::NavigationApplication() :
-		new_global_plan_(false), runPlanner_(false) {
+		plan_monitor_(NULL), next_leg_monitor_(NULL), next_leg_ready_(false), next_leg_request_(
+				false), mission_active_(false), leg_waiting_(false), goal_seq_(0), new_global_plan_(
+				false), plan_splice_index_(-1), runPlanner_(false) {
 	// TODO Auto-generated constructor stub
 	goal_sub = new NS_DataSet::Subscriber<sgbot::Pose2D>("GOAL_FROM_APP",
 			boost::bind(&NavigationApplication::goal_callback, this, _1));
+	waypoint_sub = new NS_DataSet::Subscriber<sgbot::Pose2D>(
+			"WAYPOINT_FROM_APP",
+			boost::bind(&NavigationApplication::waypoint_callback, this, _1));
 	mapping_sub = new NS_DataSet::Subscriber<int>("MAP_READY",
 			boost::bind(&NavigationApplication::mappingCallback, this, _1));
 //	event_sub = new NS_DataSet::Subscriber<int>("SLAVE_EVENT",
@@ -37,6 +43,7 @@ NavigationApplication::NavigationApplication() :
 NavigationApplication::~NavigationApplication() {
 	// TODO Auto-generated destructor stub
 	delete goal_sub;
+	delete waypoint_sub;
 	delete goal_pub;
 	delete pose_cli;
 	delete event_sub;
@@ -46,6 +53,8 @@ NavigationApplication::~NavigationApplication() {
 	delete pose_theta_pub;
 	delete pose_distance_pub;
 	delete coverage_pub;
+	delete plan_monitor_;
+	delete next_leg_monitor_;
 }
 void NavigationApplication::loadParameters() {
 	NS_NaviCommon::Parameter parameter;
@@ -56,6 +65,16 @@ void NavigationApplication::loadParameters() {
 	local_planner_type_ = parameter.getParameter("local_planner_type",
 			"ftc_local_planner");
 	planner_frequency_ = parameter.getParameter("planner_frequency", 1.0f);
+	if (parameter.getParameter("plan_monitor", 1) == 1) {
+		use_plan_monitor_ = true;
+	} else {
+		use_plan_monitor_ = false;
+	}
+	plan_cost_degradation_ = parameter.getParameter("plan_cost_degradation",
+			0.3f);
+	plan_max_deviation_ = parameter.getParameter("plan_max_deviation", 0.5f);
+	replan_lookahead_ = parameter.getParameter("replan_lookahead", 1.0f);
+	planner_patience_ = parameter.getParameter("planner_patience", 5.0f);
 	controller_frequency_ = parameter.getParameter("controller_frequency",
 			5.0f);
 	back_to_begin_tolerance = parameter.getParameter("back_to_begin_tolerance",
@@ -86,6 +105,9 @@ void NavigationApplication::runRecovery() {
 void NavigationApplication::resetState() {
 	state = PLANNING;
 	publishZeroVelocity();
+	planner_mutex.lock();
+	endMission();
+	planner_mutex.unlock();
 }
 void NavigationApplication::publishZeroVelocity() {
 	logInfo<<"--------------->publishZeroVelocity------------------------>";
@@ -106,12 +128,49 @@ bool NavigationApplication::goal_callback(sgbot::Pose2D& goal_from_app) {
 	printf("goal_callback x = %.4f,y = %.4f, theta = %.4f\n", goal.x(),
 			goal.y(), goal.theta());
 	state = PLANNING;
+	///a new goal starts a new mission
+	waypoints_.clear();
+	next_leg_ready_ = false;
+	mission_active_ = true;
+	++goal_seq_;
+	///a plan to the old goal may still be running,don't wait for it
+	global_planner->cancelPlan();
 	planner_cond.notify_one();
 	runPlanner_ = true;
 	planner_mutex.unlock();
 
 	return true;
 }
+bool NavigationApplication::waypoint_callback(
+		sgbot::Pose2D& waypoint_from_app) {
+	queueWaypoint(goalToGlobalFrame(waypoint_from_app));
+	return true;
+}
+void NavigationApplication::queueWaypoint(const sgbot::Pose2D& waypoint) {
+	planner_mutex.lock();
+	printf("queue waypoint x = %.4f,y = %.4f, theta = %.4f\n", waypoint.x(),
+			waypoint.y(), waypoint.theta());
+	if (!mission_active_) {
+		///nothing to queue behind,drive to it right away
+		goal = waypoint;
+		++goal_seq_;
+		state = PLANNING;
+		mission_active_ = true;
+		runPlanner_ = true;
+	} else {
+		waypoints_.push_back(waypoint);
+		next_leg_request_ = true;
+	}
+	planner_cond.notify_one();
+	planner_mutex.unlock();
+}
+void NavigationApplication::clearWaypoints() {
+	planner_mutex.lock();
+	waypoints_.clear();
+	next_leg_ready_ = false;
+	next_leg_request_ = false;
+	planner_mutex.unlock();
+}
 sgbot::Pose2D NavigationApplication::goalToGlobalFrame(sgbot::Pose2D& goal) {
 	sgbot::Pose2D pose, target_pose;
 	if (pose_cli->call(pose)) {
@@ -284,24 +343,87 @@ void NavigationApplication::findFrontWall() {
 //need to search another area uncovered
 void NavigationApplication::fullCoverage() {
 	if (global_state == WALK_S) {
-		boost::shared_ptr<NS_CostMap::VisitedLayer> visited_layer =
-				get_visited_layer();
 		sgbot::Pose2D pose;
 		pose_cli->call(pose);
 		int result_idx;
-		visited_layer->nearestCell(result_idx, pose);
+		if (!selectCoverageTarget(pose, result_idx)) {
+			logInfo<< "full coveraged no uncovered cell left";
+			return;
+		}
 		int index_x = result_idx % global_costmap->getCostmap()->getSizeInCellsX();
 		int index_y = result_idx / global_costmap->getCostmap()->getSizeInCellsX();
 		logInfo<< "full coveraged search new area index x = "<<index_x <<" , "<<index_y;
-		logInfo<<"and now run planner";
 		float world_x,world_y;
 		global_costmap->getCostmap()->mapToWorld(index_x,index_y,world_x,world_y);
 		sgbot::Pose2D pose2d(world_x, world_y,0.f);
 		goal = pose2d;
-		state = PLANNING;
-		runPlanner_ = true;
-		planner_cond.notify_one();
+
+		///the field is already flooded from the robot,only trace back the chosen cell
+		///the traceback simplifies the plan against the costmap,so hold its lock
+		boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
+				*(global_costmap->getLayeredCostmap()->getCostmap()->getMutex()));
+		if (global_planner->getPlanFromField(goal, *latest_plan)) {
+			logInfo<<"plan extracted from cost field and now run controller";
+			if (plan_monitor_) {
+				plan_monitor_->setPlan(*latest_plan,
+						global_costmap->getLayeredCostmap());
+			}
+			lock.unlock();
+			controller_mutex.lock();
+			updateGlobalPlan(*latest_plan, -1);
+			state = CONTROLLING;
+			controller_cond.notify_one();
+			controller_mutex.unlock();
+		} else {
+			lock.unlock();
+			logInfo<<"and now run planner";
+			state = PLANNING;
+			runPlanner_ = true;
+			planner_cond.notify_one();
+		}
+	}
+}
+bool NavigationApplication::selectCoverageTarget(const sgbot::Pose2D& pose,
+		int& result_idx) {
+	boost::shared_ptr<NS_CostMap::VisitedLayer> visited_layer =
+			get_visited_layer();
+	NS_CostMap::Costmap2D* costmap = global_costmap->getCostmap();
+
+	boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
+			*(costmap->getMutex()));
+
+	unsigned int size_x = costmap->getSizeInCellsX();
+	unsigned int size_y = costmap->getSizeInCellsY();
+	///one copy of the field instead of taking the planner lock per cell
+	std::vector<float> field;
+	if (!global_planner->computeCostField(pose)
+			|| !global_planner->getFieldCosts(field)
+			|| field.size() != (size_t) size_x * size_y) {
+		///planners without the field api,e.g. lattice_planner,
+		///plan to the nearest uncovered cell as before
+		lock.unlock();
+		logInfo<< "no cost field from the global planner , search the nearest uncovered cell";
+		return visited_layer->nearestCell(result_idx, pose);
+	}
+	float best_cost = -1.f;
+	int candidates = 0;
+	for (unsigned int y = 0; y < size_y; ++y) {
+		for (unsigned int x = 0; x < size_x; ++x) {
+			float cost = field[x + y * size_x];
+			if (cost < 0 || visited_layer->isCovered(x, y)
+					|| costmap->getCost(x, y)
+							>= NS_CostMap::INSCRIBED_INFLATED_OBSTACLE) {
+				continue;
+			}
+			++candidates;
+			if (best_cost < 0 || cost < best_cost) {
+				best_cost = cost;
+				result_idx = x + y * size_x;
+			}
+		}
 	}
+	logInfo<< "coverage target ranked "<<candidates<<" reachable cells , best cost = "<<best_cost;
+	return best_cost >= 0;
 }
 void NavigationApplication::wolkSComplete() {
 	if (global_state == WALK_S) {
@@ -333,49 +455,204 @@ void NavigationApplication::wolkSComplete() {
 
 void NavigationApplication::planLoop() {
 	NS_NaviCommon::Rate rate(planner_frequency_);
+	///plans to the goal of failed_seq have failed since failed_since
+	unsigned int failed_seq = 0;
+	bool failing = false;
+	NS_NaviCommon::Time failed_since;
 
 	while (running) {
 		planner_mutex.lock();
-		while (new_goal_trigger && running && !runPlanner_) {
+		while (new_goal_trigger && running && !runPlanner_
+				&& !next_leg_request_) {
 			logInfo<< "planner_condition waiting all long ";
 			planner_cond.wait(planner_mutex);
 			new_goal_trigger = false;
 		}
+		bool leg_only = next_leg_request_ && !runPlanner_;
+		unsigned int plan_goal_seq = goal_seq_;
 		planner_mutex.unlock();
 
 		if (!running) {
 			console.message("Quit global planning loop...");
 			break;
 		}
+		///only woken to plan the next leg,the current plan is still good
+		if (leg_only) {
+			planNextLeg();
+			new_goal_trigger = true;
+			continue;
+		}
+		///the monitor's trigger is consumed by this plan
+		if (plan_monitor_) {
+			planner_mutex.lock();
+			runPlanner_ = false;
+			planner_mutex.unlock();
+		}
 		//&& state != PLANNING
-		if (!makePlan(goal, *latest_plan)) {
+		int splice_index;
+		if (!makePlan(goal, *latest_plan, splice_index)) {
 			console.error("Make plan failure!");
 //			goalCallbackExecutor->abort();
 //			is_walking = 0;
 			new_goal_trigger = true;
 			logInfo<< "global planner failed to make plan , maybe recovery should be triggered";
+			if (!failing || failed_seq != plan_goal_seq) {
+				failing = true;
+				failed_seq = plan_goal_seq;
+				failed_since = NS_NaviCommon::Time::now();
+			} else if (planner_patience_ > 0
+					&& NS_NaviCommon::Time::now()
+							> failed_since
+									+ NS_NaviCommon::Duration(planner_patience_)) {
+				///out of planner patience,give the goal up unless it was replaced
+				planner_mutex.lock();
+				bool give_up = goal_seq_ == plan_goal_seq;
+				if (give_up) {
+					runPlanner_ = false;
+					endMission();
+				}
+				planner_mutex.unlock();
+				if (give_up) {
+					logInfo<< "no plan within planner patience , the goal is given up";
+					failing = false;
+					state = PLANNING;
+					publishZeroVelocity();
+					continue;
+				}
+			}
+			if (plan_monitor_) {
+				///retry at planner frequency,unless a new goal cancelled this plan
+				planner_mutex.lock();
+				runPlanner_ = true;
+				bool new_goal = goal_seq_ != plan_goal_seq;
+				planner_mutex.unlock();
+				if (!new_goal)
+					rate.sleep();
+			}
 			continue;
 		}
+		failing = false;
 
 		controller_mutex.lock();
 		state = CONTROLLING;
-		new_global_plan_ = true;
-		global_planner_plan->clear();
-		global_planner_plan->assign(latest_plan->begin(), latest_plan->end());
+		updateGlobalPlan(*latest_plan, splice_index);
 		if (runPlanner_)
 			state = CONTROLLING;
 		controller_cond.notify_one();
 		controller_mutex.unlock();
 
-		if (planner_frequency_ <= 0.0f)
-			runPlanner_ = false;
-		else
-			rate.sleep();
+		if (leg_waiting_) {
+			leg_waiting_ = false;
+			logInfo<< "leg handover took "
+			<< (NS_NaviCommon::Time::now() - leg_reached_at_).toSec() * 1000
+			<< " ms";
+		}
+		///plan the next leg while this one is driven
+		planNextLeg();
+
+		///with the plan monitor the thread idles until it or a new goal wakes it
+		if (!plan_monitor_) {
+			if (planner_frequency_ <= 0.0f)
+				runPlanner_ = false;
+			else
+				rate.sleep();
+		}
 		new_goal_trigger = true;
 		logInfo<< "make plan done once";
 	}
 }
 
+void NavigationApplication::planNextLeg() {
+	planner_mutex.lock();
+	next_leg_request_ = false;
+	if (waypoints_.empty() || next_leg_ready_) {
+		planner_mutex.unlock();
+		return;
+	}
+	sgbot::Pose2D leg_start = goal;
+	sgbot::Pose2D leg_goal = waypoints_.front();
+	planner_mutex.unlock();
+
+	std::vector<sgbot::Pose2D> leg;
+	bool found;
+	{
+		boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
+				*(global_costmap->getLayeredCostmap()->getCostmap()->getMutex()));
+		///the robot is not at leg_start,leave its costmap cell alone
+		found = global_planner->makePlanFromPose(leg_start, leg_goal, leg)
+				&& !leg.empty();
+		if (found)
+			next_leg_monitor_->setPlan(leg, global_costmap->getLayeredCostmap());
+	}
+	if (!found) {
+		logInfo<< "next leg planning failed , it is planned from the robot when reached";
+		return;
+	}
+
+	planner_mutex.lock();
+	///the queue or the goal may have changed while planning
+	if (!waypoints_.empty()
+			&& sgbot::distance(waypoints_.front(), leg_goal) < 1e-3
+			&& sgbot::distance(goal, leg_start) < 1e-3) {
+		next_leg_plan_.swap(leg);
+		next_leg_ready_ = true;
+		logInfo<< "next leg planned , points = "<< next_leg_plan_.size();
+	}
+	planner_mutex.unlock();
+}
+
+bool NavigationApplication::startNextLeg() {
+	std::vector<sgbot::Pose2D> leg;
+	planner_mutex.lock();
+	if (waypoints_.empty()) {
+		mission_active_ = false;
+		planner_mutex.unlock();
+		return false;
+	}
+	leg_reached_at_ = NS_NaviCommon::Time::now();
+	goal = waypoints_.front();
+	++goal_seq_;
+	waypoints_.pop_front();
+	bool ready = next_leg_ready_;
+	if (ready)
+		leg.swap(next_leg_plan_);
+	next_leg_ready_ = false;
+	planner_mutex.unlock();
+
+	if (ready) {
+		if (plan_monitor_) {
+			boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
+					*(global_costmap->getLayeredCostmap()->getCostmap()->getMutex()));
+			plan_monitor_->setPlan(leg, global_costmap->getLayeredCostmap());
+		}
+		controller_mutex.lock();
+		updateGlobalPlan(leg, -1);
+		state = CONTROLLING;
+		controller_mutex.unlock();
+		logInfo<< "pre-planned leg handed over , waypoints left = "
+		<< waypoints_.size();
+	} else {
+		logInfo<< "next leg not ready , plan it from the robot";
+		state = PLANNING;
+	}
+
+	planner_mutex.lock();
+	leg_waiting_ = !ready;
+	runPlanner_ = !ready;
+	next_leg_request_ = ready && !waypoints_.empty();
+	planner_cond.notify_one();
+	planner_mutex.unlock();
+	return true;
+}
+
+void NavigationApplication::endMission() {
+	mission_active_ = false;
+	waypoints_.clear();
+	next_leg_ready_ = false;
+	next_leg_request_ = false;
+	leg_waiting_ = false;
+}
+
 void NavigationApplication::controlLoop() {
 	while (running) {
 		logInfo<< "control loop state ="<<state;
@@ -393,9 +670,19 @@ void NavigationApplication::controlLoop() {
 			console.message("Quit local planning loop...");
 			break;
 		}
+		controller_mutex.lock();
+		bool plan_updated = new_global_plan_, plan_set = true;
 		if (new_global_plan_) {
 			new_global_plan_ = false;
-			if (!local_planner->setPlan(*global_planner_plan)) {
+			///a spliced plan only hands over the replaced suffix
+			if (plan_splice_index_ < 0
+					|| !local_planner->replacePlanSuffix(*global_planner_plan,
+							plan_splice_index_))
+				plan_set = local_planner->setPlan(*global_planner_plan);
+		}
+		controller_mutex.unlock();
+		if (plan_updated) {
+			if (!plan_set) {
 				console.error("Set plan to local planner failure!");
 				resetState();
 				logInfo<< "local planner failed tp set plan,so disable plan thread ";
@@ -432,6 +719,7 @@ void NavigationApplication::controlLoop() {
 			planner_mutex.unlock();
 			break;
 			case CONTROLLING:
+			checkPlan(global_pose);
 			controlFunc();
 			break;
 			case CLEARING:
@@ -462,6 +750,40 @@ void NavigationApplication::controlLoop() {
 	}
 }
 
+void NavigationApplication::checkPlan(const sgbot::Pose2D& global_pose) {
+	planner_mutex.lock();
+	bool leg_ready = next_leg_ready_;
+	sgbot::Pose2D leg_start = goal;
+	planner_mutex.unlock();
+	PlanMonitor::Reason reason = PlanMonitor::VALID, leg_reason =
+			PlanMonitor::VALID;
+	{
+		boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
+				*(global_costmap->getLayeredCostmap()->getCostmap()->getMutex()));
+		if (plan_monitor_)
+			reason = plan_monitor_->check(global_costmap->getLayeredCostmap(),
+					global_pose);
+		///the robot is not on the next leg yet,it is held at the leg start
+		if (leg_ready)
+			leg_reason = next_leg_monitor_->check(
+					global_costmap->getLayeredCostmap(), leg_start);
+	}
+	if (leg_reason != PlanMonitor::VALID) {
+		planner_mutex.lock();
+		next_leg_ready_ = false;
+		next_leg_request_ = true;
+		planner_cond.notify_one();
+		planner_mutex.unlock();
+	}
+	if (reason == PlanMonitor::VALID)
+		return;
+
+	planner_mutex.lock();
+	runPlanner_ = true;
+	planner_cond.notify_one();
+	planner_mutex.unlock();
+}
+
 void NavigationApplication::controlFunc() {
 	logInfo<< "control func hold until control finished";
 //	while(running) {
@@ -469,6 +791,8 @@ void NavigationApplication::controlFunc() {
 	NS_NaviCommon::Time last_valid_control;
 	if (local_planner->isGoalReached()) {
 		console.message("The goal has reached!");
+		if (startNextLeg())
+			return;
 //			goalCallbackExecutor->done();
 		//             printf("continue exploring? = %d\n", isExploring);
 		//             publishIsExploring();
@@ -527,8 +851,38 @@ void NavigationApplication::controlFunc() {
 //	}
 }
 
+void NavigationApplication::updateGlobalPlan(
+		const std::vector<sgbot::Pose2D>& plan, int splice_index) {
+	///the plan may have been replaced since the spliced replan copied it
+	if (splice_index > 0 && splice_index <= (int) global_planner_plan->size()
+			&& splice_index < (int) plan.size()
+			&& sgbot::distance(global_planner_plan->front(), plan.front()) < 1e-6
+			&& sgbot::distance(global_planner_plan->at(splice_index - 1),
+					plan[splice_index - 1]) < 1e-6) {
+		global_planner_plan->resize(splice_index);
+		global_planner_plan->insert(global_planner_plan->end(),
+				plan.begin() + splice_index, plan.end());
+	} else {
+		splice_index = -1;
+		global_planner_plan->assign(plan.begin(), plan.end());
+	}
+	///the local planner may not have taken the last plan yet
+	if (new_global_plan_ && (plan_splice_index_ < 0 || splice_index < 0))
+		plan_splice_index_ = -1;
+	else if (new_global_plan_)
+		plan_splice_index_ = std::min(plan_splice_index_, splice_index);
+	else
+		plan_splice_index_ = splice_index;
+	new_global_plan_ = true;
+}
+
 bool NavigationApplication::makePlan(const sgbot::Pose2D& goal,
-		std::vector<sgbot::Pose2D>& plan) {
+		std::vector<sgbot::Pose2D>& plan, int& splice_index) {
+	///the control thread rewrites global_planner_plan,work on a copy
+	controller_mutex.lock();
+	std::vector<sgbot::Pose2D> current_plan(*global_planner_plan);
+	bool controlling = state == CONTROLLING;
+	controller_mutex.unlock();
 
 	boost::unique_lock<NS_CostMap::Costmap2D::mutex_t> lock(
 			*(global_costmap->getLayeredCostmap()->getCostmap()->getMutex()));
@@ -544,13 +898,54 @@ bool NavigationApplication::makePlan(const sgbot::Pose2D& goal,
 
 	sgbot::Pose2D start = global_pose;
 
+	///still following a plan to the same goal,replan around it first
+	bool found = false;
+	bool same_goal = controlling && current_plan.size() >= 2
+			&& sgbot::distance(current_plan.back(), goal) < 1e-3;
+	splice_index = -1;
+	if (same_goal && plan_monitor_ && replan_lookahead_ > 0) {
+		int lookahead = plan_monitor_->lookaheadPose(
+				global_costmap->getLayeredCostmap(), global_pose,
+				replan_lookahead_);
+		if (lookahead > 0 && lookahead < (int) current_plan.size()) {
+			///the robot keeps driving the plan up to the lookahead pose
+			std::vector<sgbot::Pose2D> suffix;
+			int tier;
+			if (global_planner->makePlanInCorridor(
+					current_plan[lookahead], goal,
+					current_plan, suffix, tier, false) && !suffix.empty()) {
+				plan.assign(current_plan.begin(),
+						current_plan.begin() + lookahead);
+				plan.insert(plan.end(), suffix.begin(), suffix.end());
+				splice_index = lookahead;
+				found = true;
+				logInfo<< "spliced replan from pose "<<lookahead<<" , tier = "<<tier
+				<<" , suffix size = "<<suffix.size();
+			} else {
+				logInfo<< "spliced replan failed , replan from the robot";
+			}
+		}
+	}
+	if (!found && same_goal) {
+		int tier;
+		found = global_planner->makePlanInCorridor(start, goal,
+				current_plan, plan, tier, true);
+		logInfo<< "corridor replan tier = "<<tier;
+	} else if (!found) {
+		found = global_planner->makePlan(start, goal, plan);
+	}
+
 	//if the planner fails or returns a zero length plan, planning failed
-	if (!global_planner->makePlan(start, goal, plan) || plan.empty()) {
+	if (!found || plan.empty()) {
 		console.warning("Failed to find a  plan to point (%.2f, %.2f)",
 				goal.x(), goal.y());
 		return false;
 	}
 
+	if (plan_monitor_)
+		plan_monitor_->setPlan(plan, global_costmap->getLayeredCostmap(),
+				splice_index >= 0 ? plan_monitor_->getProgress() : 0);
+
 	logInfo<< "Plans computed,  points to go... = " << plan.size();
 	global_plan.resize(plan.size());
 	for (size_t i = 0; i < plan.size(); i++) {
@@ -581,12 +976,34 @@ void NavigationApplication::run() {
 	//load global planner
 	if (global_planner_type_ == "global_planner") {
 		global_planner = new NS_Planner::GlobalPlanner();
+	} else if (global_planner_type_ == "lattice_planner") {
+		global_planner = new NS_Planner::LatticePlanner();
 	} else {
 		global_planner = new NS_Planner::GlobalPlanner();
 	}
 
 	global_planner->initialize(global_costmap);
 
+	if (use_plan_monitor_) {
+		plan_monitor_ = new PlanMonitor();
+		plan_monitor_->setThresholds(NS_CostMap::INSCRIBED_INFLATED_OBSTACLE,
+				plan_cost_degradation_, plan_max_deviation_);
+	}
+	next_leg_monitor_ = new PlanMonitor();
+	next_leg_monitor_->setThresholds(NS_CostMap::INSCRIBED_INFLATED_OBSTACLE,
+			plan_cost_degradation_, 0.f);
+
+	/*
+	 * 监控的路径代价和全局规划器用同一套 neutral_cost / cost_factor，
+	 * 规划器不提供时保留 PlanMonitor 的默认值
+	 */
+	float neutral_cost, cost_factor;
+	if (global_planner->getCostWeights(neutral_cost, cost_factor)) {
+		if (plan_monitor_)
+			plan_monitor_->setCostWeights(neutral_cost, cost_factor);
+		next_leg_monitor_->setCostWeights(neutral_cost, cost_factor);
+	}
+
 	//load local planner
 
 	if (local_planner_type_ == "trajectory_local_planner") {
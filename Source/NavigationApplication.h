@@ -20,6 +20,8 @@
 #include <Service/Server.h>
 #include <Service/Client.h>
 #include <Mission/Executor.h>
+#include "PlanMonitor.h"
+#include <deque>
 namespace NS_Navigation {
 
 enum NaviState {
@@ -58,6 +60,14 @@ public:
 	run();
 	virtual void
 	quit();
+
+	/**
+	 * queue a waypoint in global frame behind the current goal, the leg to
+	 * it is planned while the legs before it are driven
+	 */
+	void queueWaypoint(const sgbot::Pose2D& waypoint);
+
+	void clearWaypoints();
 private:
 	/**
 	 * 从文件加载参数
@@ -66,9 +76,19 @@ private:
 
 	/**
 	 * 全局规划器计算路径
+	 * 同一目标重规划时只从当前路径上的前视点开始规划，新的后半段接在
+	 * 保留的前半段之后，splice_index 为被替换的第一个路径点，-1 表示整条新路径
 	 */
 	bool
-	makePlan(const sgbot::Pose2D& goal, std::vector<sgbot::Pose2D>& plan);
+	makePlan(const sgbot::Pose2D& goal, std::vector<sgbot::Pose2D>& plan,
+			int& splice_index);
+
+	/**
+	 * hand a new plan (or the suffix from splice_index) to the local planner,
+	 * controller_mutex must be held
+	 */
+	void
+	updateGlobalPlan(const std::vector<sgbot::Pose2D>& plan, int splice_index);
 
 	void
 	planLoop();
@@ -76,8 +96,39 @@ private:
 	void
 	controlLoop();
 
+	/**
+	 * check the current plan against the changed costmap tiles and wake
+	 * the plan thread if it is no longer good
+	 */
+	void
+	checkPlan(const sgbot::Pose2D& global_pose);
+
 	void listenLoop();
 	bool goal_callback(sgbot::Pose2D& goal_from_app);
+	bool waypoint_callback(sgbot::Pose2D& waypoint_from_app);
+
+	/**
+	 * plan the leg from the current goal to the first queued waypoint,
+	 * run by the plan thread while the current leg is driven
+	 */
+	void
+	planNextLeg();
+
+	/**
+	 * goal reached: continue with the next waypoint, the pre-planned leg
+	 * is handed to the controller at once if it is still valid
+	 * @return false if there is no waypoint left
+	 */
+	bool
+	startNextLeg();
+
+	/**
+	 * the mission ended other than by reaching its last goal: drop the
+	 * queued waypoints so that the next waypoint starts a new mission,
+	 * called with planner_mutex held
+	 */
+	void
+	endMission();
 	//TODO not sure how to implement this
 	void visualizedGlobalGoal(sgbot::Pose2D& global_goal_);
 	//TODO not sure how to implement this
@@ -130,6 +181,12 @@ private:
 	void findFrontWall();
 
 	void fullCoverage();
+	/**
+	 * flood the cost field once from pose and pick the cheapest reachable
+	 * uncovered free cell, without a cost field from the global planner
+	 * fall back to the nearest uncovered cell of the visited layer
+	 */
+	bool selectCoverageTarget(const sgbot::Pose2D& pose, int& result_idx);
 
 	void wolkSComplete();
 ////
@@ -290,6 +347,13 @@ private:
 	std::string local_planner_type_;
 	/// 全局规划频率
 	float planner_frequency_;
+	/// replan on plan monitor triggers only, planner_frequency_ is then the
+	/// retry rate after a failed plan
+	bool use_plan_monitor_;
+	float plan_cost_degradation_, plan_max_deviation_;
+	/// replans to the same goal start this far ahead on the current plan,
+	/// <= 0 to always replan from the robot
+	float replan_lookahead_;
 	/// 控制频率
 	float controller_frequency_;
 
@@ -316,11 +380,30 @@ private:
 
 	NS_Planner::LocalPlannerBase* local_planner;
 
+	PlanMonitor* plan_monitor_;
+
+	///waypoints after the current goal
+	std::deque<sgbot::Pose2D> waypoints_;
+	///leg from goal to waypoints_.front(),valid while next_leg_ready_
+	std::vector<sgbot::Pose2D> next_leg_plan_;
+	///watches next_leg_plan_ on the costmap until it is handed over
+	PlanMonitor* next_leg_monitor_;
+	bool next_leg_ready_, next_leg_request_;
+	///a goal is being driven to,later waypoints are queued behind it
+	bool mission_active_;
+	///goal reached but the next leg was not ready
+	bool leg_waiting_;
+	NS_NaviCommon::Time leg_reached_at_;
+
 	sgbot::Pose2D goal;
+	///changes with goal,a plan that failed for an older goal is not retried late
+	unsigned int goal_seq_;
 
 	bool new_goal_trigger;
 /// for local planner set plan
 	bool new_global_plan_;
+///first pose of global_planner_plan the local planner does not have,-1 for a new plan
+	int plan_splice_index_;
 ///run plan thread or not
 	bool runPlanner_;
 
@@ -340,6 +423,8 @@ private:
 	NS_DataSet::Publisher<Velocity2D>* twist_pub;
 ///subscribe the goal from other
 	NS_DataSet::Subscriber<sgbot::Pose2D>* goal_sub;
+///subscribe waypoints queued behind the goal
+	NS_DataSet::Subscriber<sgbot::Pose2D>* waypoint_sub;
 ///event from controller
 	NS_DataSet::Subscriber<int>* event_sub;
 ///action pub and sub to controller
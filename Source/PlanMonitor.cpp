@@ -0,0 +1,261 @@
+/*
+ * PlanMonitor.cpp
+ *
+ *  Watches the current global plan on the costmap dirty tiles,
+ *  so the plan thread only runs when the plan is no longer good.
+ */
+
+#include "PlanMonitor.h"
+#include <Console/Console.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <time.h>
+
+namespace NS_Navigation {
+
+/// plan poses searched ahead of the last one the robot was closest to
+#define PLAN_MONITOR_WINDOW 40
+
+PlanMonitor::PlanMonitor() :
+		blocked_cost_(NS_CostMap::INSCRIBED_INFLATED_OBSTACLE), cost_degradation_(
+				0.3f), max_deviation_(0.5f), neutral_cost_(66), cost_factor_(
+				0.55f), nx_(0), tiles_x_(0), seen_count_(0), progress_(0), passed_(
+				0), remaining_base_(0), growth_(0), pending_(false), checks_(0), cells_checked_(
+				0) {
+	for (int i = 0; i < 4; i++)
+		triggers_[i] = 0;
+}
+
+void PlanMonitor::setThresholds(unsigned char blocked_cost,
+		float cost_degradation, float max_deviation) {
+	blocked_cost_ = blocked_cost;
+	cost_degradation_ = cost_degradation;
+	max_deviation_ = max_deviation;
+}
+
+void PlanMonitor::setCostWeights(float neutral_cost, float cost_factor) {
+	neutral_cost_ = neutral_cost;
+	cost_factor_ = cost_factor;
+}
+
+const char* PlanMonitor::reasonName(Reason reason) {
+	switch (reason) {
+	case INVALIDATED:
+		return "invalidated";
+	case DEGRADED:
+		return "degraded";
+	case DEVIATED:
+		return "deviated";
+	default:
+		return "valid";
+	}
+}
+
+void PlanMonitor::addCell(unsigned int index, int pose) {
+	if (!cells_.empty() && cells_.back().index == index)
+		return;
+	const unsigned int T = NS_CostMap::LayeredCostmap::DIRTY_TILE_SIZE;
+	unsigned int tile = (index / nx_) / T * tiles_x_ + (index % nx_) / T;
+	if (tile_cells_[tile].empty())
+		touched_tiles_.push_back(tile);
+	tile_cells_[tile].push_back(cells_.size());
+
+	PlanCell cell;
+	cell.index = index;
+	cell.pose = pose;
+	cells_.push_back(cell);
+}
+
+void PlanMonitor::setPlan(const std::vector<sgbot::Pose2D>& plan,
+		NS_CostMap::LayeredCostmap* layered, int progress) {
+	NS_CostMap::Costmap2D* costmap = layered->getCostmap();
+	const unsigned char* costs = costmap->getCharMap();
+
+	for (size_t i = 0; i < touched_tiles_.size(); i++)
+		tile_cells_[touched_tiles_[i]].clear();
+	touched_tiles_.clear();
+	cells_.clear();
+	poses_ = plan;
+
+	nx_ = costmap->getSizeInCellsX();
+	tiles_x_ = layered->getTilesX();
+	unsigned int tiles = tiles_x_ * layered->getTilesY();
+	if (tile_cells_.size() != tiles)
+		tile_cells_.assign(tiles, std::vector<int>());
+
+	/*
+	 * 相邻路径点之间按直线补齐栅格，保证路径经过的每个栅格都被记录
+	 */
+	int last_x = -1, last_y = -1;
+	for (size_t i = 0; i < plan.size(); i++) {
+		unsigned int mx, my;
+		if (!costmap->worldToMap(plan[i].x(), plan[i].y(), mx, my))
+			continue;
+		int x = mx, y = my;
+		if (last_x < 0) {
+			addCell(y * nx_ + x, i);
+		} else {
+			int dx = abs(x - last_x), dy = abs(y - last_y);
+			int sx = x > last_x ? 1 : -1, sy = y > last_y ? 1 : -1;
+			int err = dx - dy, cx = last_x, cy = last_y;
+			while (cx != x || cy != y) {
+				int e2 = 2 * err;
+				if (e2 > -dy) {
+					err -= dy;
+					cx += sx;
+				}
+				if (e2 < dx) {
+					err += dx;
+					cy += sy;
+				}
+				addCell(cy * nx_ + cx, i);
+			}
+		}
+		last_x = x;
+		last_y = y;
+	}
+
+	remaining_base_ = 0;
+	for (size_t i = 0; i < cells_.size(); i++) {
+		cells_[i].base = cells_[i].cost = costs[cells_[i].index];
+		remaining_base_ += weight(cells_[i].base);
+	}
+	growth_ = 0;
+	// the cells before progress are dropped by the next advance
+	progress_ = std::max(0, std::min(progress, (int) plan.size() - 1));
+	passed_ = 0;
+	seen_count_ = layered->getUpdateCount();
+
+	if (pending_) {
+		pending_ = false;
+		logInfo<< "plan monitor: detection to new plan "
+		<< (NS_NaviCommon::Time::now() - detected_at_).toSec() * 1000 << " ms";
+	}
+}
+
+void PlanMonitor::advance(const sgbot::Pose2D& robot, float& distance) {
+	int last = std::min((int) poses_.size(), progress_ + PLAN_MONITOR_WINDOW);
+	int best = progress_;
+	distance = sgbot::distance(robot, poses_[progress_]);
+	for (int i = progress_ + 1; i < last; i++) {
+		float d = sgbot::distance(robot, poses_[i]);
+		if (d < distance) {
+			distance = d;
+			best = i;
+		}
+	}
+	progress_ = best;
+
+	// cells behind the robot no longer count
+	while (passed_ < (int) cells_.size() && cells_[passed_].pose < progress_) {
+		remaining_base_ -= weight(cells_[passed_].base);
+		growth_ -= weight(cells_[passed_].cost) - weight(cells_[passed_].base);
+		passed_++;
+	}
+}
+
+int PlanMonitor::lookaheadPose(NS_CostMap::LayeredCostmap* layered,
+		const sgbot::Pose2D& robot, float lookahead) {
+	if (poses_.empty())
+		return -1;
+	NS_CostMap::Costmap2D* costmap = layered->getCostmap();
+	if (costmap->getSizeInCellsX() != nx_)
+		return -1;
+
+	float distance;
+	advance(robot, distance);
+	if (max_deviation_ > 0 && distance > max_deviation_)
+		return -1;
+
+	int pose = progress_;
+	float length = 0;
+	while (pose + 1 < (int) poses_.size() && length < lookahead) {
+		length += sgbot::distance(poses_[pose], poses_[pose + 1]);
+		pose++;
+	}
+	// keep at least one pose for the new suffix to replace
+	if (pose + 1 >= (int) poses_.size())
+		return -1;
+
+	/*
+	 * 机器人到前视点之间的路径会被保留，这一段必须仍然可以通行
+	 */
+	const unsigned char* costs = costmap->getCharMap();
+	for (int i = passed_; i < (int) cells_.size() && cells_[i].pose <= pose;
+			i++) {
+		unsigned char cost = costs[cells_[i].index];
+		if (cost >= blocked_cost_ && cost != NS_CostMap::NO_INFORMATION)
+			return -1;
+	}
+	return pose;
+}
+
+PlanMonitor::Reason PlanMonitor::check(NS_CostMap::LayeredCostmap* layered,
+		const sgbot::Pose2D& robot) {
+	if (poses_.empty())
+		return VALID;
+
+	clock_t start = clock();
+	checks_++;
+	Reason reason = VALID;
+
+	float distance;
+	advance(robot, distance);
+	if (max_deviation_ > 0 && distance > max_deviation_)
+		reason = DEVIATED;
+
+	NS_CostMap::Costmap2D* costmap = layered->getCostmap();
+	if (costmap->getSizeInCellsX() != nx_ || layered->getTilesX() != tiles_x_
+			|| tile_cells_.size() != tiles_x_ * layered->getTilesY()) {
+		// the plan cells do not index this map any more
+		reason = INVALIDATED;
+	} else {
+		const unsigned char* costs = costmap->getCharMap();
+		bool blocked = false;
+		for (size_t t = 0; t < touched_tiles_.size(); t++) {
+			unsigned int tile = touched_tiles_[t];
+			if (layered->getTileStamp(tile % tiles_x_, tile / tiles_x_)
+					<= seen_count_)
+				continue;
+			std::vector<int>& positions = tile_cells_[tile];
+			for (size_t i = 0; i < positions.size(); i++) {
+				if (positions[i] < passed_)
+					continue;
+				PlanCell& cell = cells_[positions[i]];
+				unsigned char cost = costs[cell.index];
+				cells_checked_++;
+				if (cost != cell.cost) {
+					growth_ += weight(cost) - weight(cell.cost);
+					cell.cost = cost;
+				}
+				if (cost >= blocked_cost_ && cost != NS_CostMap::NO_INFORMATION)
+					blocked = true;
+			}
+		}
+		seen_count_ = layered->getUpdateCount();
+
+		if (blocked)
+			reason = INVALIDATED;
+		else if (reason == VALID && cost_degradation_ > 0
+				&& growth_ > cost_degradation_ * remaining_base_)
+			reason = DEGRADED;
+	}
+
+	if (reason != VALID) {
+		triggers_[reason]++;
+		if (!pending_) {
+			pending_ = true;
+			detected_at_ = NS_NaviCommon::Time::now();
+			logInfo<< "plan monitor: plan " << reasonName(reason)
+			<< " at pose " << progress_ << "/" << poses_.size()
+			<< ", checks = " << checks_ << ", cells read = " << cells_checked_
+			<< ", triggers invalidated/degraded/deviated = "
+			<< triggers_[INVALIDATED] << "/" << triggers_[DEGRADED] << "/"
+			<< triggers_[DEVIATED] << ", check took "
+			<< (float) (clock() - start) / CLOCKS_PER_SEC * 1000 << " ms";
+		}
+	}
+	return reason;
+}
+
+} /* namespace NS_Navigation */
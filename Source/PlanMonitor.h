@@ -0,0 +1,114 @@
+/*
+ * PlanMonitor.h
+ *
+ *  Watches the current global plan on the costmap dirty tiles,
+ *  so the plan thread only runs when the plan is no longer good.
+ */
+
+#ifndef PLANMONITOR_H_
+#define PLANMONITOR_H_
+
+#include "costmap/costmap_2d/LayeredCostMap.h"
+#include <type/pose2d.h>
+#include <Time/Time.h>
+#include <log_tool.h>
+#include <vector>
+
+namespace NS_Navigation {
+
+class PlanMonitor {
+public:
+	enum Reason {
+		VALID = 0, INVALIDATED, DEGRADED, DEVIATED
+	};
+
+	PlanMonitor();
+
+	/**
+	 * blocked_cost: a plan cell at or above it (unknown excepted) invalidates
+	 * the plan. cost_degradation: relative growth of the remaining path cost
+	 * that triggers a replan, <= 0 off. max_deviation: metres between the
+	 * robot and the plan, <= 0 off
+	 */
+	void setThresholds(unsigned char blocked_cost, float cost_degradation,
+			float max_deviation);
+
+	/**
+	 * the path cost of a cell is neutral_cost + cost_factor * cost, the same
+	 * weights as the global planner, takes effect from the next setPlan
+	 */
+	void setCostWeights(float neutral_cost, float cost_factor);
+
+	/**
+	 * index the cells of a new plan by dirty tile and take their costs as
+	 * the baseline, progress is the pose the robot is at (a spliced plan
+	 * keeps the poses up to the robot), must be called with the costmap locked
+	 */
+	void setPlan(const std::vector<sgbot::Pose2D>& plan,
+			NS_CostMap::LayeredCostmap* layered, int progress = 0);
+
+	/**
+	 * only the plan cells in tiles changed since the last call are read,
+	 * must be called with the costmap locked
+	 */
+	Reason check(NS_CostMap::LayeredCostmap* layered,
+			const sgbot::Pose2D& robot);
+
+	/**
+	 * first plan pose at least lookahead metres ahead of the robot, -1 if
+	 * the robot is off the plan, the goal is closer or a cell on the way
+	 * there is blocked, must be called with the costmap locked
+	 */
+	int lookaheadPose(NS_CostMap::LayeredCostmap* layered,
+			const sgbot::Pose2D& robot, float lookahead);
+
+	int getProgress() {
+		return progress_;
+	}
+
+	void clear() {
+		cells_.clear();
+		poses_.clear();
+	}
+
+	static const char* reasonName(Reason reason);
+
+private:
+	struct PlanCell {
+		unsigned int index;
+		/// plan pose the cell is reached from
+		int pose;
+		unsigned char base, cost;
+	};
+
+	float weight(unsigned char cost) {
+		return neutral_cost_ + cost_factor_ * cost;
+	}
+	void addCell(unsigned int index, int pose);
+	void advance(const sgbot::Pose2D& robot, float& distance);
+
+	unsigned char blocked_cost_;
+	float cost_degradation_, max_deviation_;
+	float neutral_cost_, cost_factor_;
+
+	std::vector<sgbot::Pose2D> poses_;
+	/// in plan order
+	std::vector<PlanCell> cells_;
+	/// positions in cells_ per dirty tile
+	std::vector<std::vector<int> > tile_cells_;
+	std::vector<int> touched_tiles_;
+	unsigned int nx_, tiles_x_, seen_count_;
+
+	/// first pose / cell not yet passed by the robot
+	int progress_, passed_;
+	/// path cost of the cells ahead at plan time, and how much it grew
+	double remaining_base_, growth_;
+
+	bool pending_;
+	NS_NaviCommon::Time detected_at_;
+	int checks_, cells_checked_, triggers_[4];
+};
+
+} /* namespace NS_Navigation */
+
+#endif /* PLANMONITOR_H_ */
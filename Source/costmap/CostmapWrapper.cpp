@@ -9,6 +9,7 @@
 #include "layers/StaticLayer.h"
 #include "layers/InflationLayer.h"
 #include "layers/VisitedLayer.h"
+#include "layers/DistanceLayer.h"
 #include <Time/Rate.h>
 #include "utils/Footprint.h"
 #include "socket_tool.h"
@@ -171,6 +172,14 @@ void CostmapWrapper::initialize() {
 		layered_costmap->addPlugin(layer);
 	}
 
+	// last, it reads what the other layers wrote
+	if(layered_costmap)
+	{
+		DistanceLayer* distance_layer = new DistanceLayer();
+		boost::shared_ptr < CostmapLayer > layer(distance_layer);
+		layered_costmap->addPlugin(layer);
+	}
+
 	std::vector < boost::shared_ptr< CostmapLayer > > *layers = layered_costmap->getPlugins();
 	for(std::vector< boost::shared_ptr< CostmapLayer > >::iterator layer = layers->begin();
 			layer != layers->end(); ++layer)
@@ -0,0 +1,303 @@
+#include "FreeSpaceComponents.h"
+
+#include <algorithm>
+
+namespace NS_CostMap
+{
+
+  FreeSpaceComponents::FreeSpaceComponents()
+      : costs_(NULL), nx_(0), ny_(0), tiles_x_(0), tiles_y_(0), seen_count_(0),
+        lethal_cost_(INSCRIBED_INFLATED_OBSTACLE), allow_unknown_(true),
+        relabeled_tiles_(0), components_(0)
+  {
+  }
+
+  void FreeSpaceComponents::setThreshold(unsigned char lethal_cost,
+                                         bool allow_unknown)
+  {
+    lethal_cost_ = lethal_cost;
+    allow_unknown_ = allow_unknown;
+    // relabel everything on the next update
+    nx_ = ny_ = 0;
+  }
+
+  void FreeSpaceComponents::update(LayeredCostmap* layered)
+  {
+    Costmap2D* costmap = layered->getCostmap();
+    costs_ = costmap->getCharMap();
+    unsigned int nx = costmap->getSizeInCellsX(), ny = costmap->getSizeInCellsY();
+    const unsigned int T = LayeredCostmap::DIRTY_TILE_SIZE;
+
+    bool all = false;
+    if(nx != nx_ || ny != ny_)
+    {
+      nx_ = nx;
+      ny_ = ny;
+      tiles_x_ = (nx + T - 1) / T;
+      tiles_y_ = (ny + T - 1) / T;
+      label_.assign(nx * ny, 0);
+      tile_sizes_.assign(tiles_x_ * tiles_y_, std::vector< int >());
+      border_edges_.assign(tiles_x_ * tiles_y_,
+                           std::vector< std::pair< unsigned int, unsigned int > >());
+      all = true;
+    }
+    // stamps of another size (not resized through the layered costmap yet)
+    if(layered->getTilesX() != tiles_x_ || layered->getTilesY() != tiles_y_)
+      all = true;
+
+    relabeled_tiles_ = 0;
+    std::vector< bool > relabeled(tiles_x_ * tiles_y_, false);
+    for(unsigned int ty = 0; ty < tiles_y_; ty++)
+    {
+      for(unsigned int tx = 0; tx < tiles_x_; tx++)
+      {
+        if(all || layered->getTileStamp(tx, ty) > seen_count_)
+        {
+          labelTile(tx, ty);
+          relabeled[ty * tiles_x_ + tx] = true;
+          relabeled_tiles_++;
+        }
+      }
+    }
+    seen_count_ = layered->getUpdateCount();
+    if(relabeled_tiles_ == 0)
+      return;
+
+    // the borders of a tile reach into its 8 neighbours
+    for(unsigned int ty = 0; ty < tiles_y_; ty++)
+    {
+      for(unsigned int tx = 0; tx < tiles_x_; tx++)
+      {
+        bool touched = false;
+        for(unsigned int y = ty == 0 ? 0 : ty - 1;
+            y <= ty + 1 && y < tiles_y_ && !touched; y++)
+          for(unsigned int x = tx == 0 ? 0 : tx - 1;
+              x <= tx + 1 && x < tiles_x_ && !touched; x++)
+            touched = relabeled[y * tiles_x_ + x];
+        if(touched)
+          findBorderEdges(tx, ty);
+      }
+    }
+    link();
+  }
+
+  void FreeSpaceComponents::labelTile(unsigned int tx, unsigned int ty)
+  {
+    const unsigned int T = LayeredCostmap::DIRTY_TILE_SIZE;
+    unsigned int x0 = tx * T, y0 = ty * T;
+    unsigned int xn = std::min(x0 + T, nx_), yn = std::min(y0 + T, ny_);
+
+    for(unsigned int y = y0; y < yn; y++)
+      std::fill(label_.begin() + y * nx_ + x0, label_.begin() + y * nx_ + xn, 0);
+
+    std::vector< int >& sizes = tile_sizes_[ty * tiles_x_ + tx];
+    sizes.clear();
+    for(unsigned int y = y0; y < yn; y++)
+    {
+      for(unsigned int x = x0; x < xn; x++)
+      {
+        unsigned int seed = y * nx_ + x;
+        if(label_[seed] != 0 || !isFree(costs_[seed]))
+          continue;
+
+        // flood the new label inside the tile
+        uint16_t label = sizes.size() + 1;
+        int count = 0;
+        queue_.clear();
+        queue_.push_back(seed);
+        label_[seed] = label;
+        for(size_t head = 0; head < queue_.size(); head++)
+        {
+          unsigned int n = queue_[head];
+          unsigned int cx = n % nx_, cy = n / nx_;
+          count++;
+          for(int dy = -1; dy <= 1; dy++)
+          {
+            for(int dx = -1; dx <= 1; dx++)
+            {
+              unsigned int mx = cx + dx, my = cy + dy;
+              if(mx < x0 || mx >= xn || my < y0 || my >= yn)
+                continue;
+              unsigned int m = my * nx_ + mx;
+              if(label_[m] == 0 && isFree(costs_[m]))
+              {
+                label_[m] = label;
+                queue_.push_back(m);
+              }
+            }
+          }
+        }
+        sizes.push_back(count);
+      }
+    }
+  }
+
+  void FreeSpaceComponents::link()
+  {
+    int nodes = 0;
+    tile_base_.resize(tile_sizes_.size());
+    for(size_t t = 0; t < tile_sizes_.size(); t++)
+    {
+      tile_base_[t] = nodes;
+      nodes += tile_sizes_[t].size();
+    }
+    parent_.resize(nodes);
+    size_.resize(nodes);
+    for(size_t t = 0; t < tile_sizes_.size(); t++)
+    {
+      for(size_t l = 0; l < tile_sizes_[t].size(); l++)
+      {
+        parent_[tile_base_[t] + l] = tile_base_[t] + l;
+        size_[tile_base_[t] + l] = tile_sizes_[t][l];
+      }
+    }
+    components_ = nodes;
+
+    for(size_t t = 0; t < border_edges_.size(); t++)
+      for(size_t e = 0; e < border_edges_[t].size(); e++)
+        unite(nodeOf(border_edges_[t][e].first),
+              nodeOf(border_edges_[t][e].second));
+  }
+
+  void FreeSpaceComponents::findBorderEdges(unsigned int tx, unsigned int ty)
+  {
+    const unsigned int T = LayeredCostmap::DIRTY_TILE_SIZE;
+    unsigned int x0 = tx * T, y0 = ty * T;
+    unsigned int xn = std::min(x0 + T, nx_), yn = std::min(y0 + T, ny_);
+    std::vector< std::pair< unsigned int, unsigned int > >& edges =
+        border_edges_[ty * tiles_x_ + tx];
+    edges.clear();
+
+    // last column against the first column of the next tile
+    unsigned int x = xn - 1;
+    if(x + 1 < nx_)
+    {
+      for(unsigned int y = y0; y < yn; y++)
+      {
+        unsigned int a = y * nx_ + x;
+        if(label_[a] == 0)
+          continue;
+        for(int dy = -1; dy <= 1; dy++)
+        {
+          unsigned int my = y + dy;
+          if(my >= ny_)
+            continue;
+          addEdge(edges, a, my * nx_ + x + 1);
+        }
+      }
+    }
+    // last row against the first row of the tile below
+    unsigned int y = yn - 1;
+    if(y + 1 < ny_)
+    {
+      for(unsigned int x = x0; x < xn; x++)
+      {
+        unsigned int a = y * nx_ + x;
+        if(label_[a] == 0)
+          continue;
+        for(int dx = -1; dx <= 1; dx++)
+        {
+          unsigned int mx = x + dx;
+          if(mx >= nx_)
+            continue;
+          addEdge(edges, a, (y + 1) * nx_ + mx);
+        }
+      }
+    }
+  }
+
+  void FreeSpaceComponents::addEdge(
+      std::vector< std::pair< unsigned int, unsigned int > >& edges,
+      unsigned int a, unsigned int b)
+  {
+    if(label_[b] == 0)
+      return;
+    // runs along a border mostly join the same two labels
+    if(!edges.empty() && label_[edges.back().first] == label_[a]
+        && label_[edges.back().second] == label_[b]
+        && tileOf(edges.back().second) == tileOf(b))
+      return;
+    edges.push_back(std::make_pair(a, b));
+  }
+
+  unsigned int FreeSpaceComponents::tileOf(unsigned int index)
+  {
+    const unsigned int T = LayeredCostmap::DIRTY_TILE_SIZE;
+    return (index / nx_) / T * tiles_x_ + (index % nx_) / T;
+  }
+
+  int FreeSpaceComponents::nodeOf(unsigned int index)
+  {
+    if(label_[index] == 0)
+      return -1;
+    return tile_base_[tileOf(index)] + label_[index] - 1;
+  }
+
+  int FreeSpaceComponents::find(int node)
+  {
+    while(parent_[node] != node)
+    {
+      parent_[node] = parent_[parent_[node]];
+      node = parent_[node];
+    }
+    return node;
+  }
+
+  void FreeSpaceComponents::unite(int a, int b)
+  {
+    a = find(a);
+    b = find(b);
+    if(a == b)
+      return;
+    if(size_[a] < size_[b])
+      std::swap(a, b);
+    parent_[b] = a;
+    size_[a] += size_[b];
+    components_--;
+  }
+
+  int FreeSpaceComponents::componentOf(unsigned int mx, unsigned int my)
+  {
+    if(mx >= nx_ || my >= ny_)
+      return -1;
+    int node = nodeOf(my * nx_ + mx);
+    return node < 0 ? -1 : find(node);
+  }
+
+  void FreeSpaceComponents::collectRoots(unsigned int x, unsigned int y,
+                                         int radius, std::vector< int >& roots)
+  {
+    roots.clear();
+    for(int dy = -radius; dy <= radius; dy++)
+    {
+      for(int dx = -radius; dx <= radius; dx++)
+      {
+        int root = componentOf(x + dx, y + dy);
+        if(root >= 0 && std::find(roots.begin(), roots.end(), root) == roots.end())
+          roots.push_back(root);
+      }
+    }
+  }
+
+  bool FreeSpaceComponents::connected(unsigned int ax, unsigned int ay,
+                                      int a_radius, unsigned int bx,
+                                      unsigned int by, int b_radius,
+                                      int* a_size)
+  {
+    std::vector< int > a_roots, b_roots;
+    collectRoots(ax, ay, a_radius, a_roots);
+    collectRoots(bx, by, b_radius, b_roots);
+
+    if(a_size)
+    {
+      *a_size = 0;
+      for(size_t i = 0; i < a_roots.size(); i++)
+        *a_size += size_[a_roots[i]];
+    }
+    for(size_t i = 0; i < a_roots.size(); i++)
+      if(std::find(b_roots.begin(), b_roots.end(), a_roots[i]) != b_roots.end())
+        return true;
+    return false;
+  }
+
+}  // namespace NS_CostMap
@@ -0,0 +1,116 @@
+#ifndef _COSTMAP_FREE_SPACE_COMPONENTS_H_
+#define _COSTMAP_FREE_SPACE_COMPONENTS_H_
+
+#include "LayeredCostMap.h"
+#include <stdint.h>
+#include <vector>
+
+namespace NS_CostMap
+{
+
+  /**
+   * 8 连通的可通行区域编号，用来在规划前判断起点和终点是否连通
+   *
+   * every DIRTY_TILE_SIZE tile of the layered costmap is labelled on its
+   * own, a union-find over the tile labels joins them across tile borders.
+   * update() only relabels the tiles updateMap touched since the last call
+   * and rescans the borders next to them, the union-find is then rebuilt
+   * from the cached border edges, a query is a find on both cells.
+   * 8 connected, so any path a 4 or 8 neighbour planner can find stays
+   * inside one component.
+   */
+  class FreeSpaceComponents
+  {
+  public:
+    FreeSpaceComponents();
+
+    /**
+     * a cell is blocked if its cost is at least lethal_cost, unknown cells
+     * count as free if allow_unknown
+     */
+    void
+    setThreshold(unsigned char lethal_cost, bool allow_unknown);
+
+    /**
+     * must be called with the costmap locked
+     */
+    void
+    update(LayeredCostmap* layered);
+
+    /**
+     * -1 for a blocked cell
+     */
+    int
+    componentOf(unsigned int mx, unsigned int my);
+
+    /**
+     * true if a free cell within a_radius of a is in the same component as
+     * a free cell within b_radius of b. a_size (if not NULL) is set to the
+     * number of cells in the components around a, which is what a failed
+     * search from a would have expanded.
+     */
+    bool
+    connected(unsigned int ax, unsigned int ay, int a_radius, unsigned int bx,
+              unsigned int by, int b_radius, int* a_size = NULL);
+
+    /** tiles relabelled by the last update */
+    int getRelabeledTiles()
+    {
+      return relabeled_tiles_;
+    }
+
+    int getComponents()
+    {
+      return components_;
+    }
+
+  private:
+    bool isFree(unsigned char cost)
+    {
+      return cost < lethal_cost_ || (allow_unknown_ && cost == NO_INFORMATION);
+    }
+
+    void
+    labelTile(unsigned int tx, unsigned int ty);
+    void
+    findBorderEdges(unsigned int tx, unsigned int ty);
+    void
+    addEdge(std::vector< std::pair< unsigned int, unsigned int > >& edges,
+            unsigned int a, unsigned int b);
+    void
+    link();
+    int
+    find(int node);
+    void
+    unite(int a, int b);
+    unsigned int
+    tileOf(unsigned int index);
+    int
+    nodeOf(unsigned int index);
+    void
+    collectRoots(unsigned int x, unsigned int y, int radius,
+                 std::vector< int >& roots);
+
+    const unsigned char* costs_;
+    unsigned int nx_, ny_, tiles_x_, tiles_y_, seen_count_;
+    unsigned char lethal_cost_;
+    bool allow_unknown_;
+
+    /// local label of each cell inside its tile, 0 if blocked
+    std::vector< uint16_t > label_;
+    /// cells of each local label, per tile
+    std::vector< std::vector< int > > tile_sizes_;
+    /// pairs of touching free cells across the right and bottom border of
+    /// each tile, one per pair of labels that meet there
+    std::vector< std::vector< std::pair< unsigned int, unsigned int > > >
+        border_edges_;
+    /// first union-find node of each tile
+    std::vector< int > tile_base_;
+    std::vector< int > parent_, size_;
+    std::vector< int > queue_;
+    int relabeled_tiles_, components_;
+  };
+
+}  // namespace NS_CostMap
+
+#endif
@@ -13,7 +13,8 @@ namespace NS_CostMap
 {
 
   LayeredCostmap::LayeredCostmap(bool track_unknown)
-      : costmap_(), initialized_(false), size_locked_(false)
+      : costmap_(), update_count_(0), tiles_x_(0), tiles_y_(0),
+        initialized_(false), size_locked_(false)
   {
     if(track_unknown)
       costmap_.setDefaultValue(255);
@@ -35,6 +36,11 @@ namespace NS_CostMap
   {
     size_locked_ = size_locked;
     costmap_.resizeMap(size_x, size_y, resolution, origin_x, origin_y);
+
+    // every tile is new
+    tiles_x_ = (size_x + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+    tiles_y_ = (size_y + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+    tile_stamps_.assign(tiles_x_ * tiles_y_, ++update_count_);
     for(vector< boost::shared_ptr< CostmapLayer > >::iterator plugin = plugins_.begin();
         plugin != plugins_.end(); ++plugin)
     {
@@ -95,6 +101,16 @@ namespace NS_CostMap
       (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
     }
 
+    if(xn > x0 && yn > y0)
+    {
+      ++update_count_;
+      for(unsigned int ty = y0 / DIRTY_TILE_SIZE;
+          ty <= (yn - 1) / DIRTY_TILE_SIZE; ty++)
+        for(unsigned int tx = x0 / DIRTY_TILE_SIZE;
+            tx <= (xn - 1) / DIRTY_TILE_SIZE; tx++)
+          tile_stamps_[ty * tiles_x_ + tx] = update_count_;
+    }
+
     bx0_ = x0;
     bxn_ = xn;
     by0_ = y0;
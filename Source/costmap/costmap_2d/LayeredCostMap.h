@@ -97,6 +97,33 @@ namespace NS_CostMap
       return initialized_;
     }
 
+    /**
+     * 脏区块：地图按 DIRTY_TILE_SIZE 见方分块，每块记录最后一次被
+     * updateMap 或 resizeMap 改写时的更新序号，使用者保存自己看到的序号，
+     * 之后只处理序号更大的块
+     */
+    static const unsigned int DIRTY_TILE_SIZE = 32;
+
+    unsigned int getUpdateCount()
+    {
+      return update_count_;
+    }
+
+    unsigned int getTilesX()
+    {
+      return tiles_x_;
+    }
+
+    unsigned int getTilesY()
+    {
+      return tiles_y_;
+    }
+
+    unsigned int getTileStamp(unsigned int tx, unsigned int ty)
+    {
+      return tile_stamps_[ty * tiles_x_ + tx];
+    }
+
     /** @brief Update the footprint, circumstance radius
      * and inscribed radius, and calls onFootprintChanged() in all
      * layers. */
@@ -137,6 +164,9 @@ namespace NS_CostMap
     double minx_, miny_, maxx_, maxy_;
     unsigned int bx0_, bxn_, by0_, byn_;
 
+    unsigned int update_count_, tiles_x_, tiles_y_;
+    std::vector< unsigned int > tile_stamps_;
+
     std::vector< boost::shared_ptr< CostmapLayer > > plugins_;
 
     bool initialized_;
@@ -0,0 +1,179 @@
+#include "../layers/DistanceLayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Parameter/Parameter.h>
+#include <Console/Console.h>
+
+namespace NS_CostMap
+{
+
+  DistanceLayer::DistanceLayer()
+      : max_distance_param_(0), max_distance_(0), cell_max_distance_(0),
+        max_distance_cm_(0), window_x_(0), window_y_(0), window_size_x_(0),
+        need_recompute_(true)
+  {
+  }
+
+  void DistanceLayer::onInitialize()
+  {
+    current_ = true;
+    enabled_ = true;
+
+    NS_NaviCommon::Parameter parameter;
+
+    parameter.loadConfigurationFile("distance_layer.xml");
+
+    max_distance_param_ = parameter.getParameter("max_distance", 1.0f);
+
+    matchSize();
+  }
+
+  void DistanceLayer::matchSize()
+  {
+    Costmap2D* costmap = layered_costmap_->getCostmap();
+    size_x_ = costmap->getSizeInCellsX();
+    size_y_ = costmap->getSizeInCellsY();
+    origin_x_ = costmap->getOriginX();
+    origin_y_ = costmap->getOriginY();
+    resolution_ = costmap->getResolution();
+    setMaxDistance();
+  }
+
+  void DistanceLayer::onFootprintChanged()
+  {
+    setMaxDistance();
+  }
+
+  void DistanceLayer::setMaxDistance()
+  {
+    // a clearance check needs distances a few cells past the circumscribed radius
+    max_distance_ = std::max(
+        max_distance_param_,
+        layered_costmap_->getCircumscribedRadius() + 4 * resolution_);
+    max_distance_ = std::min(max_distance_, 600.0);
+    max_distance_cm_ = (unsigned short)(max_distance_ * 100);
+    cell_max_distance_ =
+        resolution_ > 0 ? (unsigned int)ceil(max_distance_ / resolution_) : 0;
+    distances_.assign(size_x_ * size_y_, max_distance_cm_);
+    need_recompute_ = true;
+  }
+
+  void DistanceLayer::updateCosts(Costmap2D& master_grid, int min_i, int min_j,
+                                  int max_i, int max_j)
+  {
+    if(!enabled_)
+      return;
+
+    unsigned char* master_array = master_grid.getCharMap();
+    int size_x = master_grid.getSizeInCellsX();
+    int size_y = master_grid.getSizeInCellsY();
+    if(distances_.size() != (size_t)size_x * size_y)
+    {
+      printf("DistanceLayer::updateCosts(): distance map size is wrong\n");
+      matchSize();
+    }
+
+    if(need_recompute_)
+    {
+      min_i = min_j = 0;
+      max_i = size_x;
+      max_j = size_y;
+      need_recompute_ = false;
+    }
+
+    /*
+     * 只有变化区域周围 max_distance 以内的距离会改变，这些栅格最近的障碍物
+     * 又都在变化区域周围 2 * max_distance 以内，只在这个窗口里重新传播
+     */
+    int r = cell_max_distance_;
+    int write_min_i = std::max(0, min_i - r), write_max_i = std::min(size_x,
+                                                                      max_i + r);
+    int write_min_j = std::max(0, min_j - r), write_max_j = std::min(size_y,
+                                                                      max_j + r);
+    if(write_max_i <= write_min_i || write_max_j <= write_min_j)
+      return;
+
+    window_x_ = std::max(0, min_i - 2 * r);
+    window_y_ = std::max(0, min_j - 2 * r);
+    int window_max_i = std::min(size_x, max_i + 2 * r);
+    int window_max_j = std::min(size_y, max_j + 2 * r);
+    window_size_x_ = window_max_i - window_x_;
+    seen_.assign(window_size_x_ * (window_max_j - window_y_), false);
+
+    for(int j = write_min_j; j < write_max_j; j++)
+      std::fill(distances_.begin() + j * size_x + write_min_i,
+                distances_.begin() + j * size_x + write_max_i,
+                max_distance_cm_);
+
+    for(int j = window_y_; j < window_max_j; j++)
+    {
+      for(int i = window_x_; i < window_max_i; i++)
+      {
+        int index = master_grid.getIndex(i, j);
+        unsigned char cost = master_array[index];
+        if(cost == LETHAL_OBSTACLE || cost == NO_INFORMATION)
+        {
+          enqueue(index, i, j, i, j);
+        }
+      }
+    }
+
+    while(!distance_queue_.empty())
+    {
+      const CellData& current_cell = distance_queue_.top();
+
+      unsigned int index = current_cell.index_;
+      unsigned int mx = current_cell.x_;
+      unsigned int my = current_cell.y_;
+      unsigned int sx = current_cell.src_x_;
+      unsigned int sy = current_cell.src_y_;
+      double distance = current_cell.distance_;
+
+      distance_queue_.pop();
+
+      int local = (my - window_y_) * window_size_x_ + mx - window_x_;
+      if(seen_[local])
+      {
+        continue;
+      }
+      seen_[local] = true;
+
+      if((int)mx >= write_min_i && (int)mx < write_max_i
+          && (int)my >= write_min_j && (int)my < write_max_j)
+      {
+        double cm = distance * resolution_ * 100;
+        distances_[index] =
+            cm < max_distance_cm_ ? (unsigned short)cm : max_distance_cm_;
+      }
+
+      if((int)mx > window_x_)
+        enqueue(index - 1, mx - 1, my, sx, sy);
+      if((int)my > window_y_)
+        enqueue(index - size_x, mx, my - 1, sx, sy);
+      if((int)mx < window_max_i - 1)
+        enqueue(index + 1, mx + 1, my, sx, sy);
+      if((int)my < window_max_j - 1)
+        enqueue(index + size_x, mx, my + 1, sx, sy);
+    }
+  }
+
+  inline void DistanceLayer::enqueue(unsigned int index, unsigned int mx,
+                                     unsigned int my, unsigned int src_x,
+                                     unsigned int src_y)
+  {
+    if(seen_[(my - window_y_) * window_size_x_ + mx - window_x_])
+      return;
+
+    double dx = (double)mx - src_x, dy = (double)my - src_y;
+    double distance = sqrt(dx * dx + dy * dy);
+
+    // one cell past the max distance so that the cells at it are still capped right
+    if(distance > cell_max_distance_ + 1)
+      return;
+
+    CellData data(distance, index, mx, my, src_x, src_y);
+    distance_queue_.push(data);
+  }
+
+}  // namespace NS_CostMap
@@ -0,0 +1,112 @@
+#ifndef _COSTMAP_DISTANCE_LAYER_H_
+#define _COSTMAP_DISTANCE_LAYER_H_
+
+#include "../costmap_2d/CostMapLayer.h"
+#include "../costmap_2d/LayeredCostMap.h"
+#include "InflationLayer.h"
+#include <vector>
+#include <queue>
+#include <log_tool.h>
+namespace NS_CostMap
+{
+  /**
+   * @class DistanceLayer
+   * @brief Keeps the distance from every cell to the nearest lethal or unknown
+   * cell of the master costmap, so that a clearance check is one lookup. It
+   * does not change the master costmap and has to be the last layer.
+   */
+  class DistanceLayer: public CostmapLayer
+  {
+  public:
+    DistanceLayer();
+
+    virtual ~DistanceLayer()
+    {
+    }
+
+    virtual void
+    onInitialize();
+
+    virtual void
+    updateBounds(double robot_x, double robot_y, double robot_yaw,
+                 double* min_x, double* min_y, double* max_x, double* max_y)
+    {
+    }
+
+    /**
+     * @brief Recompute the distances the changed cells can reach
+     */
+    virtual void
+    updateCosts(Costmap2D& master_grid, int min_i, int min_j, int max_i,
+                int max_j);
+
+    virtual void
+    matchSize();
+
+    virtual void activate()
+    {
+    }
+    ;
+
+    virtual void deactivate()
+    {
+    }
+    ;
+
+    virtual void reset()
+    {
+    }
+    ;
+
+    /**
+     * @brief Distance in meters between the centers of the cell and the nearest lethal or unknown cell,
+     * anything farther than getMaxDistance() reads as getMaxDistance()
+     */
+    float getDistance(unsigned int mx, unsigned int my) const
+    {
+      return distances_[my * size_x_ + mx] * 0.01f;
+    }
+
+    /**
+     * @brief The distances in centimeters, row major like the master costmap
+     */
+    const unsigned short* getDistanceMap() const
+    {
+      return distances_.empty() ? NULL : &distances_[0];
+    }
+
+    float getMaxDistance() const
+    {
+      return max_distance_;
+    }
+
+  protected:
+    virtual void
+    onFootprintChanged();
+
+  private:
+    inline void
+    enqueue(unsigned int index, unsigned int mx, unsigned int my,
+            unsigned int src_x, unsigned int src_y);
+
+    void
+    setMaxDistance();
+
+    /// what the parameter asks for, the layer keeps at least a bit more than the circumscribed radius
+    double max_distance_param_;
+    double max_distance_;
+    unsigned int cell_max_distance_;
+    unsigned short max_distance_cm_;
+
+    std::vector< unsigned short > distances_;
+    std::priority_queue< CellData > distance_queue_;
+    /// cells of the window being recomputed that are settled
+    std::vector< bool > seen_;
+    int window_x_, window_y_, window_size_x_;
+
+    bool need_recompute_; ///< Indicates that the whole map should be recomputed next time around.
+  };
+
+}  // namespace NS_CostMap
+
+#endif  // _COSTMAP_DISTANCE_LAYER_H_
@@ -48,7 +48,107 @@ namespace NS_Planner
                           double& cost)
     {
       cost = 0;
-      makePlan(start, goal, plan);
+      return makePlan(start, goal, plan);
+    }
+    ;
+
+    /**
+     * plan from a pose the robot is not at, e.g. the goal before the next
+     * waypoint, unlike makePlan the costmap is not cleared at start
+     */
+    virtual bool makePlanFromPose(const Pose2D& start,
+                                  const Pose2D& goal,
+                                  std::vector< Pose2D >& plan)
+    {
+      return makePlan(start, goal, plan);
+    }
+    ;
+
+    /**
+     * ask a plan running in another thread to give up as soon as possible,
+     * e.g. because the goal it is planning to has been replaced
+     */
+    virtual void cancelPlan()
+    {
+    }
+    ;
+
+    /**
+     * replan inside a band of cells around previous_plan, widening the band
+     * tier by tier when no path is found, tier is set to the band that
+     * succeeded (-1 if the full map had to be searched),
+     * clear_start as in makePlan / makePlanFromPose
+     */
+    virtual bool makePlanInCorridor(const Pose2D& start,
+                                    const Pose2D& goal,
+                                    const std::vector< Pose2D >& previous_plan,
+                                    std::vector< Pose2D >& plan,
+                                    int& tier,
+                                    bool clear_start)
+    {
+      tier = -1;
+      if (clear_start)
+        return makePlan(start, goal, plan);
+      return makePlanFromPose(start, goal, plan);
+    }
+    ;
+
+    /**
+     * cost-to-go field: flood the potential once from start and keep it,
+     * so that any number of candidate cells can be ranked without
+     * planning to each one of them
+     */
+    virtual bool computeCostField(const Pose2D& start)
+    {
+      return false;
+    }
+    ;
+
+    /**
+     * O(1) lookup in the last computed field,
+     * return false if the cell is not reachable from the field start
+     */
+    virtual bool getFieldCost(unsigned int mx, unsigned int my, float& cost)
+    {
+      return false;
+    }
+    ;
+
+    /**
+     * copy of the whole last computed field under one lock, row major,
+     * cells not reachable from the field start read as -1
+     */
+    virtual bool getFieldCosts(std::vector< float >& costs)
+    {
+      return false;
+    }
+    ;
+
+    bool isReachable(unsigned int mx, unsigned int my)
+    {
+      float cost;
+      return getFieldCost(mx, my, cost);
+    }
+    ;
+
+    /**
+     * extract the path to goal from the last computed field,
+     * only the chosen candidate pays for the traceback
+     */
+    virtual bool getPlanFromField(const Pose2D& goal,
+                                  std::vector< Pose2D >& plan)
+    {
+      return false;
+    }
+    ;
+
+    /**
+     * cost of a cell as the planner weighs it, neutral_cost + cost_factor *
+     * cost, return false if the planner does not weigh costs this way
+     */
+    virtual bool getCostWeights(float& neutral_cost, float& cost_factor)
+    {
+      return false;
     }
     ;
   protected:
@@ -47,6 +47,19 @@ namespace NS_Planner
     virtual bool
     setPlan(const std::vector< Pose2D >& plan) = 0;
 
+    /**
+     * the poses of the plan being followed from index on are replaced by
+     * those of plan, plan is the whole new plan and its poses before index
+     * are the ones the planner already has, so only the suffix is copied
+     * and the planner keeps its state, false if it can not do that and
+     * setPlan should be used instead
+     */
+    virtual bool
+    replacePlanSuffix(const std::vector< Pose2D >& plan, size_t index)
+    {
+      return false;
+    }
+
   protected:
     NS_CostMap::CostmapWrapper* costmap;
   };
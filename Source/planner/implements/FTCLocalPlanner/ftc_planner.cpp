@@ -85,6 +85,28 @@ namespace NS_Planner
         return true;
     }
 
+    bool FTCPlanner::replacePlanSuffix(const std::vector<sgbot::Pose2D>& plan, size_t index)
+    {
+        if(first_setPlan_ || plan.empty() || index > global_plan_.size() || index >= plan.size())
+        {
+            return false;
+        }
+        //A new goal starts the routine again, that is what setPlan does.
+        const sgbot::Pose2D& goal_pose = plan.back();
+        if(sgbot::distance(goal_pose_,goal_pose) >= position_accuracy
+        		|| fabs(angleDiff(goal_pose_.theta(),goal_pose.theta())) >= rotation_accuracy)
+        {
+            return false;
+        }
+
+        global_plan_.resize(index);
+        global_plan_.insert(global_plan_.end(), plan.begin() + index, plan.end());
+        goal_pose_ = goal_pose;
+        old_goal_pose_ = goal_pose_;
+        logInfo << "replace plan suffix from "<<index<<" , plan size = "<<global_plan_.size();
+        return true;
+    }
+
     bool FTCPlanner::computeVelocityCommands(sgbot::Velocity2D& cmd_vel)
     {
 
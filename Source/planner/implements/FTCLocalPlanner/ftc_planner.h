@@ -38,6 +38,14 @@ namespace NS_Planner
          */
         bool setPlan(const std::vector<sgbot::Pose2D>& plan);
 
+        /**
+         * @brief  Replace the plan from index on, keeping the routine state
+         * @param plan The whole new plan
+         * @param index First pose of plan that differs from the current one
+         * @return False if the goal changed, setPlan must be used then
+         */
+        bool replacePlanSuffix(const std::vector<sgbot::Pose2D>& plan, size_t index);
+
 //        /**
 //         * @brief Constructs the local planner
 //         * @param name The name to give this instance of the local planner
@@ -0,0 +1,189 @@
+#include "AnytimeAstar.h"
+
+
+namespace NS_Planner
+{
+
+  AnytimeAStarExpansion::AnytimeAStarExpansion (PotentialCalculator* p_calc,
+                                                int nx, int ny)
+      : Expander (p_calc, nx, ny), closed_ (NULL), round_ (0), weight_ (1.0),
+        initial_weight_ (3.0), weight_step_ (0.5), deadline_ (0),
+        check_interval_ (500)
+  {
+    setSize (nx, ny);
+  }
+
+  AnytimeAStarExpansion::~AnytimeAStarExpansion ()
+  {
+    if (closed_)
+      delete[] closed_;
+  }
+
+  void
+  AnytimeAStarExpansion::setSize (int nx, int ny)
+  {
+    Expander::setSize (nx, ny);
+    // stamps of older rounds stay invalid, a smaller grid keeps the buffer
+    if (ns_ <= capacity_)
+      return;
+    if (closed_)
+      delete[] closed_;
+    closed_ = new unsigned int[ns_];
+    memset (closed_, 0, ns_ * sizeof(unsigned int));
+    capacity_ = ns_;
+    round_ = 0;
+  }
+
+  float
+  AnytimeAStarExpansion::getCost (unsigned char* costs, int n)
+  {
+    float c = costs[n];
+    if (c >= lethal_cost_ && !(unknown_ && c == NS_CostMap::NO_INFORMATION))
+      return lethal_cost_;
+    c = c * factor_ + neutral_cost_;
+    if (c >= lethal_cost_)
+      c = lethal_cost_ - 1;
+    return c;
+  }
+
+  bool
+  AnytimeAStarExpansion::interrupted ()
+  {
+    if (cancel_requested_)
+      return true;
+    return deadline_ > 0 && NS_NaviCommon::Time::now () > deadline_time_;
+  }
+
+  bool
+  AnytimeAStarExpansion::calculatePotentials (unsigned char* costs,
+                                              double start_x, double start_y,
+                                              double end_x, double end_y,
+                                              int cycles, float* potential)
+  {
+    deadline_time_ = NS_NaviCommon::Time::now ()
+        + NS_NaviCommon::Duration (deadline_);
+    cells_visited_ = 0;
+
+    open_.clear ();
+    incons_.clear ();
+    std::fill (potential, potential + ns_, POT_HIGH);
+
+    // a fresh closed set per round without clearing the array
+    if (++round_ == 0)
+    {
+      memset (closed_, 0, capacity_ * sizeof(unsigned int));
+      round_ = 1;
+    }
+
+    int start_i = toIndex (start_x, start_y);
+    int goal_i = toIndex (end_x, end_y);
+    weight_ = initial_weight_;
+
+    potential[start_i] = 0;
+    open_.push_back (
+        Index (start_i, weight_ * heuristic (start_i, end_x, end_y)));
+
+    int cycle = 0;
+    int rounds = 0;
+    bool complete = true;
+    while (true)
+    {
+      complete = improvePath (costs, potential, goal_i, end_x, end_y, cycle,
+                              cycles);
+      ++rounds;
+      if (!complete || weight_ <= 1.0 || potential[goal_i] >= POT_HIGH)
+        break;
+
+      // next round with a smaller weight, OPEN = OPEN + INCONS re-keyed
+      weight_ = std::max (1.0f, weight_ - weight_step_);
+      for (size_t k = 0; k < incons_.size (); k++)
+        open_.push_back (Index (incons_[k], 0));
+      incons_.clear ();
+      for (size_t k = 0; k < open_.size (); k++)
+        open_[k].cost = potential[open_[k].i]
+            + weight_ * heuristic (open_[k].i, end_x, end_y);
+      std::make_heap (open_.begin (), open_.end (), greater1 ());
+
+      if (++round_ == 0)
+      {
+        memset (closed_, 0, capacity_ * sizeof(unsigned int));
+        round_ = 1;
+      }
+    }
+
+    logInfo << "anytime a* " << rounds << " rounds , weight " << weight_
+        << " , expansions " << cells_visited_ << (complete ? "" :
+        (cancel_requested_ ? " , cancelled" : " , deadline reached"));
+
+    // best path so far, the goal only has a potential once a round reached it
+    return !cancel_requested_ && potential[goal_i] < POT_HIGH;
+  }
+
+  bool
+  AnytimeAStarExpansion::improvePath (unsigned char* costs, float* potential,
+                                      int goal_i, int end_x, int end_y,
+                                      int& cycle, int cycles)
+  {
+    while (open_.size () > 0 && cycle < cycles)
+    {
+      if (++cycle % check_interval_ == 0 && interrupted ())
+        return false;
+
+      Index top = open_[0];
+      std::pop_heap (open_.begin (), open_.end (), greater1 ());
+      open_.pop_back ();
+
+      int i = top.i;
+      // stale duplicate of a cell already expanded this round
+      if (closed_[i] == round_)
+        continue;
+
+      if (i == goal_i)
+      {
+        // goal stays in OPEN for the next round
+        open_.push_back (top);
+        std::push_heap (open_.begin (), open_.end (), greater1 ());
+        return true;
+      }
+
+      closed_[i] = round_;
+      cells_visited_++;
+
+      add (costs, potential, i + 1, end_x, end_y);
+      add (costs, potential, i - 1, end_x, end_y);
+      add (costs, potential, i + nx_, end_x, end_y);
+      add (costs, potential, i - nx_, end_x, end_y);
+    }
+
+    return true;
+  }
+
+  void
+  AnytimeAStarExpansion::add (unsigned char* costs, float* potential,
+                              int next_i, int end_x, int end_y)
+  {
+    if (next_i < 0 || next_i >= ns_)
+      return;
+
+    float c = getCost (costs, next_i);
+    if (c >= lethal_cost_)
+      return;
+
+    float pot = p_calc_->calculatePotential (potential, c, next_i);
+    if (pot >= potential[next_i])
+      return;
+    potential[next_i] = pot;
+
+    // improved after being expanded in this round, reopen it in the next one
+    if (closed_[next_i] == round_)
+    {
+      incons_.push_back (next_i);
+      return;
+    }
+
+    open_.push_back (
+        Index (next_i, pot + weight_ * heuristic (next_i, end_x, end_y)));
+    std::push_heap (open_.begin (), open_.end (), greater1 ());
+  }
+
+} //end namespace global_planner
@@ -0,0 +1,95 @@
+#ifndef _ANYTIME_ASTAR_H_
+#define _ANYTIME_ASTAR_H_
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <Time/Time.h>
+#include "../../../../costmap/costmap_2d/CostValues.h"
+#include "Expander.h"
+#include "Astar.h"
+
+namespace NS_Planner
+{
+
+  /**
+   * ARA* style anytime expansion: a weighted A* search that is repaired with
+   * a smaller weight on every round until the weight reaches 1.0, the
+   * deadline passes or a cancel is requested.
+   * every potential stays reachable by descending from a lower neighbor, so
+   * whatever is in the array when it stops can be traced back.
+   */
+  class AnytimeAStarExpansion: public Expander
+  {
+  public:
+    AnytimeAStarExpansion (PotentialCalculator* p_calc, int nx, int ny);
+    ~AnytimeAStarExpansion ();
+
+    bool
+    calculatePotentials (unsigned char* costs, double start_x, double start_y,
+                         double end_x, double end_y, int cycles,
+                         float* potential);
+
+    void
+    setSize (int nx, int ny);
+
+    /**
+     * @param initial_weight heuristic inflation of the first round
+     * @param weight_step the weight is lowered by this much each round
+     */
+    void setWeights (float initial_weight, float weight_step)
+    {
+      initial_weight_ = std::max (1.0f, initial_weight);
+      weight_step_ = std::max (0.01f, weight_step);
+    }
+    /**
+     * @param deadline wall clock budget of one calculatePotentials in seconds,
+     * 0 for no deadline
+     */
+    void setDeadline (double deadline)
+    {
+      deadline_ = deadline;
+    }
+    /**
+     * @param check_interval expansions between two deadline/cancel checks
+     */
+    void setCheckInterval (int check_interval)
+    {
+      check_interval_ = std::max (1, check_interval);
+    }
+  private:
+    /**
+     * one ARA* round, returns false when interrupted by deadline or cancel
+     */
+    bool
+    improvePath (unsigned char* costs, float* potential, int goal_i,
+                 int end_x, int end_y, int& cycle, int cycles);
+    void
+    add (unsigned char* costs, float* potential, int next_i, int end_x,
+         int end_y);
+    bool
+    interrupted ();
+    float
+    getCost (unsigned char* costs, int n);
+    inline float heuristic (int i, int end_x, int end_y)
+    {
+      int dx = i % nx_ - end_x, dy = i / nx_ - end_y;
+      return sqrtf (dx * dx + dy * dy) * neutral_cost_;
+    }
+
+    std::vector<Index> open_;
+    std::vector<int> incons_;
+    /** round in which a cell was expanded, a cell is closed if it equals round_ */
+    unsigned int* closed_;
+    unsigned int round_;
+    float weight_;
+
+    float initial_weight_, weight_step_;
+    double deadline_;
+    int check_interval_;
+    NS_NaviCommon::Time deadline_time_;
+  };
+
+} //end namespace global_planner
+#endif
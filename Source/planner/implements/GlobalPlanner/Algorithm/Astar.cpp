@@ -17,6 +17,7 @@ namespace NS_Planner
   {
     
     queue_.clear ();
+    cells_visited_ = 0;
     
     int start_i = toIndex (start_x, start_y);
     
@@ -39,6 +40,7 @@ namespace NS_Planner
       int i = top.i;
       if (i == goal_i)
         return true;
+      cells_visited_++;
       
       add (costs, potential, potential[i], i + 1, end_x, end_y);
       add (costs, potential, potential[i], i - 1, end_x, end_y);
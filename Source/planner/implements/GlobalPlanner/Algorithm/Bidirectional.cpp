@@ -0,0 +1,256 @@
+#include "Bidirectional.h"
+
+
+namespace NS_Planner
+{
+
+  BidirectionalExpansion::BidirectionalExpansion (PotentialCalculator* p_calc,
+                                                  int nx, int ny)
+      : Expander (p_calc, nx, ny), backward_potential_ (NULL),
+        forward_settled_ (NULL), backward_settled_ (NULL), round_ (0),
+        batch_size_ (256), quit_ (false), barrier_ (NULL), batch_costs_ (NULL)
+  {
+    setSize (nx, ny);
+
+    threaded_ = boost::thread::hardware_concurrency () >= 2;
+    if (threaded_)
+    {
+      barrier_ = new boost::barrier (2);
+      worker_ = boost::thread (
+          boost::bind (&BidirectionalExpansion::workerLoop, this));
+    }
+  }
+
+  BidirectionalExpansion::~BidirectionalExpansion ()
+  {
+    if (threaded_)
+    {
+      quit_ = true;
+      barrier_->wait ();
+      worker_.join ();
+      delete barrier_;
+    }
+    if (backward_potential_)
+      delete[] backward_potential_;
+    if (forward_settled_)
+      delete[] forward_settled_;
+    if (backward_settled_)
+      delete[] backward_settled_;
+  }
+
+  void
+  BidirectionalExpansion::setSize (int nx, int ny)
+  {
+    Expander::setSize (nx, ny);
+    // stamps of older rounds stay invalid, a smaller grid keeps the buffers
+    if (ns_ <= capacity_)
+      return;
+    if (backward_potential_)
+      delete[] backward_potential_;
+    if (forward_settled_)
+      delete[] forward_settled_;
+    if (backward_settled_)
+      delete[] backward_settled_;
+    backward_potential_ = new float[ns_];
+    forward_settled_ = new unsigned int[ns_];
+    backward_settled_ = new unsigned int[ns_];
+    memset (forward_settled_, 0, ns_ * sizeof(unsigned int));
+    memset (backward_settled_, 0, ns_ * sizeof(unsigned int));
+    capacity_ = ns_;
+    round_ = 0;
+  }
+
+  void
+  BidirectionalExpansion::workerLoop ()
+  {
+    while (true)
+    {
+      barrier_->wait ();
+      if (quit_)
+        return;
+      expandBatch (backward_, batch_costs_);
+      barrier_->wait ();
+    }
+  }
+
+  float
+  BidirectionalExpansion::getCost (unsigned char* costs, int n)
+  {
+    float c = costs[n];
+    if (c >= lethal_cost_ && !(unknown_ && c == NS_CostMap::NO_INFORMATION))
+      return lethal_cost_;
+    c = c * factor_ + neutral_cost_;
+    if (c >= lethal_cost_)
+      c = lethal_cost_ - 1;
+    return c;
+  }
+
+  bool
+  BidirectionalExpansion::calculatePotentials (unsigned char* costs,
+                                               double start_x, double start_y,
+                                               double end_x, double end_y,
+                                               int cycles, float* potential)
+  {
+    cells_visited_ = 0;
+    if (++round_ == 0)
+    {
+      memset (forward_settled_, 0, capacity_ * sizeof(unsigned int));
+      memset (backward_settled_, 0, capacity_ * sizeof(unsigned int));
+      round_ = 1;
+    }
+
+    forward_.potential = potential;
+    forward_.settled = forward_settled_;
+    backward_.potential = backward_potential_;
+    backward_.settled = backward_settled_;
+    forward_.open.clear ();
+    backward_.open.clear ();
+    std::fill (potential, potential + ns_, POT_HIGH);
+    std::fill (backward_potential_, backward_potential_ + ns_, POT_HIGH);
+
+    int start_i = toIndex (start_x, start_y);
+    int goal_i = toIndex (end_x, end_y);
+    potential[start_i] = 0;
+    forward_.open.push_back (Index (start_i, 0));
+    backward_potential_[goal_i] = 0;
+    backward_.open.push_back (Index (goal_i, 0));
+
+    float mu = POT_HIGH;
+    int meet = -1;
+    while (true)
+    {
+      if (cancel_requested_ || cells_visited_ >= cycles)
+        return false;
+
+      // one batch on each side, at the same time when there is a worker
+      if (threaded_)
+      {
+        batch_costs_ = costs;
+        barrier_->wait ();
+        expandBatch (forward_, costs);
+        barrier_->wait ();
+      }
+      else
+      {
+        expandBatch (forward_, costs);
+        expandBatch (backward_, costs);
+      }
+      cells_visited_ += forward_.batch.size () + backward_.batch.size ();
+
+      // a settled cell labeled by the other side is a meeting candidate
+      for (size_t k = 0; k < forward_.batch.size (); k++)
+      {
+        int n = forward_.batch[k];
+        if (backward_potential_[n] < POT_HIGH
+            && potential[n] + backward_potential_[n] < mu)
+        {
+          mu = potential[n] + backward_potential_[n];
+          meet = n;
+        }
+      }
+      for (size_t k = 0; k < backward_.batch.size (); k++)
+      {
+        int n = backward_.batch[k];
+        if (potential[n] < POT_HIGH
+            && potential[n] + backward_potential_[n] < mu)
+        {
+          mu = potential[n] + backward_potential_[n];
+          meet = n;
+        }
+      }
+
+      // nothing left on either side can beat mu
+      if (meet >= 0 && topKey (forward_) + topKey (backward_) >= mu)
+        break;
+
+      if (forward_.open.empty () || backward_.open.empty ())
+      {
+        // the goal side closed off without meeting, finish the forward
+        // flood alone so the caller still gets the reachable potential
+        while (!forward_.open.empty () && !cancel_requested_)
+        {
+          expandBatch (forward_, costs);
+          cells_visited_ += forward_.batch.size ();
+        }
+        return false;
+      }
+    }
+
+    logInfo << "bidirectional met at (" << meet % nx_ << ", " << meet / nx_
+        << ") , cost " << mu << " , expansions " << cells_visited_
+        << (threaded_ ? " , threaded" : "");
+
+    paintBackwardPath (potential, meet, goal_i, mu);
+    return true;
+  }
+
+  void
+  BidirectionalExpansion::expandBatch (Side& side, unsigned char* costs)
+  {
+    side.batch.clear ();
+    while ((int) side.batch.size () < batch_size_ && !side.open.empty ())
+    {
+      Index top = side.open[0];
+      std::pop_heap (side.open.begin (), side.open.end (), greater1 ());
+      side.open.pop_back ();
+
+      int n = top.i;
+      if (side.settled[n] == round_)
+        continue;
+      side.settled[n] = round_;
+      side.batch.push_back (n);
+
+      relax (side, costs, n + 1);
+      relax (side, costs, n - 1);
+      relax (side, costs, n + nx_);
+      relax (side, costs, n - nx_);
+    }
+  }
+
+  void
+  BidirectionalExpansion::relax (Side& side, unsigned char* costs, int next)
+  {
+    if (next < 0 || next >= ns_ || side.settled[next] == round_)
+      return;
+    float c = getCost (costs, next);
+    if (c >= lethal_cost_)
+      return;
+
+    float pot = p_calc_->calculatePotential (side.potential, c, next);
+    if (pot >= side.potential[next])
+      return;
+    side.potential[next] = pot;
+    side.open.push_back (Index (next, pot));
+    std::push_heap (side.open.begin (), side.open.end (), greater1 ());
+  }
+
+  void
+  BidirectionalExpansion::paintBackwardPath (float* potential, int meet,
+                                             int goal_i, float mu)
+  {
+    // follow the backward potential down from the meeting cell to the goal,
+    // mu - backward potential rises along it and equals the forward one at
+    // the meeting cell
+    int c = meet;
+    for (int guard = 0; guard < ns_; guard++)
+    {
+      potential[c] = std::min (potential[c], mu - backward_potential_[c]);
+      if (c == goal_i)
+        break;
+
+      int best = c;
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+          int n = c + dx + dy * nx_;
+          if (n >= 0 && n < ns_
+              && backward_potential_[n] < backward_potential_[best])
+            best = n;
+        }
+      if (best == c)
+        break;
+      c = best;
+    }
+  }
+
+} //end namespace global_planner
@@ -0,0 +1,86 @@
+#ifndef _BIDIRECTIONAL_H_
+#define _BIDIRECTIONAL_H_
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include "../../../../costmap/costmap_2d/CostValues.h"
+#include <Console/Console.h>
+#include "Expander.h"
+#include "Astar.h"
+
+namespace NS_Planner
+{
+
+  /**
+   * Dijkstra grown from start and goal at the same time. both sides expand
+   * a batch of cells in lock step, the backward side on a worker thread when
+   * there is more than one core. between batches every newly settled cell
+   * that the other side has labeled updates the best meeting cost mu, and
+   * the search stops once top(forward) + top(backward) >= mu.
+   * the output is the forward potential plus the backward half of the path
+   * painted as mu - backward potential, so the traceback descends from the
+   * goal to the meeting cell and on to the start.
+   */
+  class BidirectionalExpansion: public Expander
+  {
+  public:
+    BidirectionalExpansion (PotentialCalculator* p_calc, int nx, int ny);
+    ~BidirectionalExpansion ();
+
+    bool
+    calculatePotentials (unsigned char* costs, double start_x, double start_y,
+                         double end_x, double end_y, int cycles,
+                         float* potential);
+
+    void
+    setSize (int nx, int ny);
+
+    void setBatchSize (int batch_size)
+    {
+      batch_size_ = std::max (1, batch_size);
+    }
+  private:
+    struct Side
+    {
+      float* potential;
+      /** round in which a cell was settled */
+      unsigned int* settled;
+      std::vector<Index> open;
+      /** cells settled in the last batch */
+      std::vector<int> batch;
+    };
+
+    void
+    expandBatch (Side& side, unsigned char* costs);
+    void
+    relax (Side& side, unsigned char* costs, int next);
+    float
+    getCost (unsigned char* costs, int n);
+    inline float topKey (Side& side)
+    {
+      return side.open.empty () ? POT_HIGH : side.open[0].cost;
+    }
+    void
+    paintBackwardPath (float* potential, int meet, int goal_i, float mu);
+    void
+    workerLoop ();
+
+    Side forward_, backward_;
+    float* backward_potential_;
+    unsigned int* forward_settled_;
+    unsigned int* backward_settled_;
+    unsigned int round_;
+    int batch_size_;
+
+    bool threaded_, quit_;
+    boost::barrier* barrier_;
+    boost::thread worker_;
+    unsigned char* batch_costs_;
+  };
+
+} //end namespace global_planner
+#endif
@@ -56,10 +56,13 @@ void DijkstraExpansion::pushOver(int n, unsigned char* costs) {
 //
 void DijkstraExpansion::setSize(int xs, int ys) {
 	Expander::setSize(xs, ys);
-	if (pending_)
-		delete[] pending_;
-
-	pending_ = new bool[ns_]; // ns_ = nx_ * ny_   protected
+	// windowed and full map plans alternate, a smaller grid keeps the buffer
+	if (ns_ > capacity_) {
+		if (pending_)
+			delete[] pending_;
+		pending_ = new bool[ns_]; // ns_ = nx_ * ny_   protected
+		capacity_ = ns_;
+	}
 	memset(pending_, 0, ns_ * sizeof(bool));
 }
 
@@ -83,6 +86,8 @@ float DijkstraExpansion::getCost(unsigned char* costs, int n)
 // runs for a specified number of cycles,
 //   or until it runs out of cells to update,
 //   or until the Start cell is found (atStart = true)
+// a negative end cell floods the whole reachable area,
+//   running out of cells is then the normal exit
 
 bool DijkstraExpansion::calculatePotentials(unsigned char* costs,
 		double start_x, double start_y, double end_x, double end_y, int cycles,
@@ -148,16 +153,22 @@ bool DijkstraExpansion::calculatePotentials(unsigned char* costs,
 	int cycle = 0;        // which cycle we're on
 
 	// set up start cell
-	int startCell = toIndex(end_x, end_y);
+	bool has_target = end_x >= 0 && end_y >= 0;
+	int startCell = has_target ? toIndex(end_x, end_y) : -1;
 
 	logInfo <<"Beforing for loop...\n";
 
 	for (; cycle < cycles; cycle++) // go for this many cycles, unless interrupted
 			{
+		if (cancel_requested_) {
+			logInfo <<"calculatePotentials cancelled";
+			return false;
+		}
+
 		if (currentEnd_ == 0 && nextEnd_ == 0) // priority blocks empty
 				{
 			logInfo <<"priority blocks empty\n";
-			return false;
+			return !has_target;
 		}
 
 		// stats
@@ -195,7 +206,7 @@ bool DijkstraExpansion::calculatePotentials(unsigned char* costs,
 		}
 
 		// check if we've hit the Start cell
-		if (potential[startCell] < POT_HIGH)
+		if (has_target && potential[startCell] < POT_HIGH)
 			break;
 	}
 
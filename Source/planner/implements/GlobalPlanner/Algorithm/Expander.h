@@ -5,6 +5,7 @@
 
 #include "PotentialCalculator.h"
 
+#include <atomic>
 #include <Console/Console.h>
 #include <log_tool.h>
 namespace NS_Planner
@@ -14,11 +15,14 @@ namespace NS_Planner
   {
   public:
     Expander(PotentialCalculator* p_calc, int nx, int ny)
-        : unknown_(true), lethal_cost_(253), neutral_cost_(50), factor_(3.0),
-          p_calc_(p_calc)
+        : capacity_(0), unknown_(true), lethal_cost_(253), neutral_cost_(50),
+          factor_(3.0), p_calc_(p_calc), cancel_requested_(false)
     {
       setSize(nx, ny);
     }
+    virtual ~Expander()
+    {
+    }
 
     virtual bool
     calculatePotentials(unsigned char* costs, double start_x, double start_y,
@@ -53,6 +57,31 @@ namespace NS_Planner
       unknown_ = unknown;
     }
 
+    /**
+     * cooperative cancellation, may be called from another thread while
+     * calculatePotentials is running, the expander polls it and gives up
+     */
+    void requestCancel()
+    {
+      cancel_requested_ = true;
+    }
+    void clearCancel()
+    {
+      cancel_requested_ = false;
+    }
+    bool isCancelRequested()
+    {
+      return cancel_requested_;
+    }
+
+    /**
+     * cells expanded by the last calculatePotentials
+     */
+    int getCellsVisited()
+    {
+      return cells_visited_;
+    }
+
     void clearEndpoint(unsigned char* costs, float* potential, int gx, int gy,
                        int s)
     {
@@ -89,11 +118,14 @@ namespace NS_Planner
 
     /*  */
     int nx_, ny_, ns_; /**< size of grid, in pixels */
+    /** cells the buffers of a subclass hold, a grid that fits reuses them */
+    int capacity_;
     bool unknown_;
     unsigned char lethal_cost_, neutral_cost_;
     int cells_visited_;
     float factor_;
     PotentialCalculator* p_calc_;
+    std::atomic< bool > cancel_requested_;
 
   };
 
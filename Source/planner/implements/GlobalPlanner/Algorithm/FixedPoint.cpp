@@ -0,0 +1,216 @@
+#include "FixedPoint.h"
+
+
+namespace NS_Planner
+{
+
+  template< typename T >
+  FixedPointExpansion< T >::FixedPointExpansion (int nx, int ny)
+      : FixedPointExpander (nx, ny), potential_ (NULL)
+  {
+    setSize (nx, ny);
+
+    for (int k = 0; k <= FIXED_POINT_LUT_SIZE; k++)
+    {
+      double d = (double) k / FIXED_POINT_LUT_SIZE;
+      double v = -0.2301 * d * d + 0.5307 * d + 0.7040;
+      lut_[k] = (uint16_t) (v * 32768 + 0.5);
+    }
+  }
+
+  template< typename T >
+  FixedPointExpansion< T >::~FixedPointExpansion ()
+  {
+    if (potential_)
+      delete[] potential_;
+  }
+
+  template< typename T >
+  void
+  FixedPointExpansion< T >::setSize (int nx, int ny)
+  {
+    Expander::setSize (nx, ny);
+    // windowed and full map plans alternate, a smaller grid keeps the buffer
+    if (ns_ > capacity_)
+    {
+      if (potential_)
+        delete[] potential_;
+      potential_ = new T[ns_];
+      capacity_ = ns_;
+    }
+    std::fill (potential_, potential_ + ns_, (T) high ());
+  }
+
+  template< typename T >
+  uint32_t
+  FixedPointExpansion< T >::getCost (unsigned char* costs, int n)
+  {
+    float c = costs[n];
+    if (c >= lethal_cost_ && !(unknown_ && c == NS_CostMap::NO_INFORMATION))
+      return 0;
+    c = c * factor_ + neutral_cost_;
+    if (c >= lethal_cost_)
+      c = lethal_cost_ - 1;
+    // whole cost units like the float expanders pass to the calculator
+    return std::max ((uint32_t) ((unsigned char) c * applied_scale_ + 0.5f),
+                     (uint32_t) 1);
+  }
+
+  template< typename T >
+  uint32_t
+  FixedPointExpansion< T >::calculatePotential (uint32_t hf, int n)
+  {
+    uint32_t l = potential_[n - 1], r = potential_[n + 1];
+    uint32_t u = potential_[n - nx_], d = potential_[n + nx_];
+
+    // lowest neighbor ta, difference to the lowest of the other axis dc
+    uint32_t tc = std::min (l, r), ta = std::min (u, d);
+    uint32_t dc;
+    if (tc < ta)
+    {
+      dc = ta - tc;
+      ta = tc;
+    }
+    else
+      dc = tc - ta;
+
+    if (dc >= hf)
+      return ta + hf;
+    // two-neighbor update, hf <= 252 * 64 keeps both products in 32 bits
+    uint32_t k = (dc * FIXED_POINT_LUT_SIZE + hf / 2) / hf;
+    return ta + ((hf * lut_[k] + (1 << 14)) >> 15);
+  }
+
+  template< typename T >
+  void
+  FixedPointExpansion< T >::push (int n, uint32_t pot)
+  {
+    if (n < 0 || n >= ns_ || pot >= potential_[n])
+      return;
+    if (pot >= high ())
+    {
+      saturated_++;
+      return;
+    }
+    potential_[n] = pot;
+    open_.push_back (Entry (n, pot));
+    std::push_heap (open_.begin (), open_.end (), greaterEntry ());
+  }
+
+  template< typename T >
+  bool
+  FixedPointExpansion< T >::calculatePotentials (unsigned char* costs,
+                                                 double start_x,
+                                                 double start_y, double end_x,
+                                                 double end_y, int cycles,
+                                                 float* potential)
+  {
+    cells_visited_ = 0;
+    saturated_ = 0;
+    open_.clear ();
+    std::fill (potential_, potential_ + ns_, (T) high ());
+
+    applied_scale_ = scale_;
+    if (applied_scale_ <= 0)
+      applied_scale_ = std::min (
+          16.0f, (float) (high () - 1) / (2.0f * neutral_cost_ * (nx_ + ny_)));
+    applied_scale_ = std::max (1.0f / 256, std::min (64.0f, applied_scale_));
+
+    // precise start, the four cells around it like DijkstraExpansion
+    int k = toIndex (start_x, start_y);
+    double dx = start_x - (int) start_x, dy = start_y - (int) start_y;
+    dx = floorf (dx * 100 + 0.5) / 100;
+    dy = floorf (dy * 100 + 0.5) / 100;
+    double seed = neutral_cost_ * 2 * applied_scale_;
+    push (k, seed * dx * dy + 0.5);
+    push (k + 1, seed * (1 - dx) * dy + 0.5);
+    push (k + nx_, seed * dx * (1 - dy) + 0.5);
+    push (k + nx_ + 1, seed * (1 - dx) * (1 - dy) + 0.5);
+
+    bool has_target = end_x >= 0 && end_y >= 0;
+    int goal_i = has_target ? toIndex (end_x, end_y) : -1;
+    bool found = !has_target;
+
+    int cycle = 0;
+    while (open_.size () > 0 && cycle++ < cycles)
+    {
+      if (cancel_requested_)
+        return false;
+
+      Entry top = open_[0];
+      std::pop_heap (open_.begin (), open_.end (), greaterEntry ());
+      open_.pop_back ();
+
+      int n = top.i;
+      // lowered after this entry was pushed
+      if (top.key != potential_[n])
+        continue;
+      cells_visited_++;
+
+      if (n == goal_i)
+      {
+        found = true;
+        break;
+      }
+
+      int next[4] = { n + 1, n - 1, n + nx_, n - nx_ };
+      for (int j = 0; j < 4; j++)
+      {
+        int m = next[j];
+        if (m < 0 || m >= ns_)
+          continue;
+        uint32_t hf = getCost (costs, m);
+        if (hf == 0)
+          continue;
+        push (m, calculatePotential (hf, m));
+      }
+    }
+
+    logInfo << "fixed point " << sizeof(T) * 8 << " bit , scale "
+        << applied_scale_ << " , expansions " << cells_visited_
+        << " , saturated " << saturated_;
+    if (!found && saturated_ > 0)
+      logInfo << "potential saturated before the goal , use a wider type "
+          "or a lower fixed_point_scale";
+    return found;
+  }
+
+  template< typename T >
+  void
+  FixedPointExpansion< T >::clearEndpoint (unsigned char* costs, int gx,
+                                           int gy, int s)
+  {
+    for (int i = -s; i <= s; i++)
+    {
+      for (int j = -s; j <= s; j++)
+      {
+        int x = gx + i, y = gy + j;
+        if (x < 1 || x >= nx_ - 1 || y < 1 || y >= ny_ - 1)
+          continue;
+        int n = toIndex (x, y);
+        if (potential_[n] < high ())
+          continue;
+        uint32_t hf = std::max (
+            (uint32_t) ((costs[n] + neutral_cost_) * applied_scale_ + 0.5f),
+            (uint32_t) 1);
+        uint32_t pot = calculatePotential (hf, n);
+        if (pot < high ())
+          potential_[n] = pot;
+      }
+    }
+  }
+
+  template< typename T >
+  bool
+  FixedPointExpansion< T >::getPath (
+      Traceback* path_maker, double start_x, double start_y, double end_x,
+      double end_y, std::vector< std::pair< float, float > >& path)
+  {
+    return path_maker->getPath (potential_, high (), start_x, start_y, end_x,
+                                end_y, path);
+  }
+
+  template class FixedPointExpansion< uint16_t > ;
+  template class FixedPointExpansion< uint32_t > ;
+
+} //end namespace global_planner
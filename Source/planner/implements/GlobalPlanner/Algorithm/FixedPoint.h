@@ -0,0 +1,170 @@
+#ifndef _FIXED_POINT_H_
+#define _FIXED_POINT_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../../../../costmap/costmap_2d/CostValues.h"
+#include "Expander.h"
+#include "Traceback.h"
+
+#define FIXED_POINT_LUT_SIZE 1024
+
+namespace NS_Planner
+{
+
+  /**
+   * Dijkstra on potentials stored as fixed point integers, for boards where
+   * a float potential plus two float gradient arrays per cell limit the map
+   * size. one unit is 1 / scale of a cost unit, values that would not fit
+   * saturate: the cell is left unassigned and counted.
+   * the quadratic update is done in integers, d = dc / hf is looked up in a
+   * table of FIXED_POINT_LUT_SIZE entries (Q15) instead of evaluating the
+   * polynomial.
+   *
+   * accuracy against the same expansion in float: the update is 1-Lipschitz
+   * in its neighbours, so errors only add up along the wave. each cell adds
+   * at most 0.5 / scale (rounding the cell cost, exact for whole scales)
+   * + 0.5 / scale (rounding the result) + 0.00026 * cost (table step), in
+   * cost units. the potential grows by at least 0.704 * neutral_cost per
+   * cell, so the relative error is below
+   *   1 / (0.704 * scale * neutral_cost) + 0.04%
+   * with neutral_cost 66: 0.2% at scale 16 (uint32_t, measured 0.025%),
+   * 3.5% at the uint16_t auto scale 0.62 of a 400 x 400 grid (measured 1.1%).
+   */
+  class FixedPointExpander: public Expander
+  {
+  public:
+    FixedPointExpander(int nx, int ny)
+        : Expander(NULL, nx, ny), scale_(0), applied_scale_(1), saturated_(0)
+    {
+    }
+
+    /**
+     * potential of cell n in cost units, POT_HIGH if unassigned
+     */
+    virtual float
+    potentialAt(int n) = 0;
+
+    /**
+     * the same as Expander::clearEndpoint on the fixed point potential
+     */
+    virtual void
+    clearEndpoint(unsigned char* costs, int gx, int gy, int s) = 0;
+
+    /**
+     * traceback on the fixed point potential of the last expansion
+     */
+    virtual bool
+    getPath(Traceback* path_maker, double start_x, double start_y,
+            double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path) = 0;
+
+    virtual int
+    getBytesPerCell() = 0;
+
+    /**
+     * units per cost unit, <= 0 picks the largest scale (up to 16) that still
+     * fits a path of twice the neutral cost across the whole grid
+     */
+    void setScale(float scale)
+    {
+      scale_ = scale;
+    }
+    float getAppliedScale()
+    {
+      return applied_scale_;
+    }
+    /**
+     * updates of the last expansion whose potential did not fit
+     */
+    int getSaturated()
+    {
+      return saturated_;
+    }
+  protected:
+    float scale_, applied_scale_;
+    int saturated_;
+  };
+
+  /**
+   * T is uint16_t or uint32_t. unassigned cells hold high(), for uint32_t
+   * that is INT32_MAX because the traceback keeps the lowest neighbour in
+   * an int.
+   */
+  template< typename T >
+  class FixedPointExpansion: public FixedPointExpander
+  {
+  public:
+    FixedPointExpansion(int nx, int ny);
+    ~FixedPointExpansion();
+
+    /**
+     * the float potential array is not touched, may be NULL
+     */
+    bool
+    calculatePotentials(unsigned char* costs, double start_x, double start_y,
+                        double end_x, double end_y, int cycles,
+                        float* potential);
+
+    void
+    setSize(int nx, int ny);
+
+    float potentialAt(int n)
+    {
+      return potential_[n] >= high() ? POT_HIGH : potential_[n] / applied_scale_;
+    }
+
+    void
+    clearEndpoint(unsigned char* costs, int gx, int gy, int s);
+
+    bool
+    getPath(Traceback* path_maker, double start_x, double start_y,
+            double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path);
+
+    int getBytesPerCell()
+    {
+      return sizeof(T);
+    }
+  private:
+    struct Entry
+    {
+      Entry(int index, uint32_t key)
+          : i(index), key(key)
+      {
+      }
+      int i;
+      uint32_t key;
+    };
+    struct greaterEntry
+    {
+      bool operator()(const Entry& a, const Entry& b) const
+      {
+        return a.key > b.key;
+      }
+    };
+
+    static inline uint32_t high()
+    {
+      return sizeof(T) >= 4 ? 0x7FFFFFFF : 0xFFFF;
+    }
+    /**
+     * cost of entering cell n in fixed point units, 0 if lethal
+     */
+    uint32_t
+    getCost(unsigned char* costs, int n);
+    uint32_t
+    calculatePotential(uint32_t hf, int n);
+    void
+    push(int n, uint32_t pot);
+
+    T* potential_;
+    std::vector< Entry > open_;
+    /** v(d) = -0.2301 d^2 + 0.5307 d + 0.7040 in Q15 */
+    uint16_t lut_[FIXED_POINT_LUT_SIZE + 1];
+  };
+
+} //end namespace global_planner
+#endif
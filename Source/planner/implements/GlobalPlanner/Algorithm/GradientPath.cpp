@@ -10,9 +10,12 @@ namespace NS_Planner
 {
 
   GradientPath::GradientPath(PotentialCalculator* p_calc)
-      : Traceback(p_calc), pathStep_(0.5)
+      : Traceback(p_calc), epoch_(0), capacity_(0), cache_gradients_(true),
+        pathStep_(0.5)
   {
+    xs_ = ys_ = 0;
     gradx_ = grady_ = NULL;
+    grad_epoch_ = NULL;
   }
 
   GradientPath::~GradientPath()
@@ -22,22 +25,77 @@ namespace NS_Planner
       delete[] gradx_;
     if(grady_)
       delete[] grady_;
+    if(grad_epoch_)
+      delete[] grad_epoch_;
   }
 
   void GradientPath::setSize(int xs, int ys)
   {
     Traceback::setSize(xs, ys);
+    // a smaller grid keeps the arrays, the next epoch drops what they cached
+    if(xs_ * ys_ > capacity_)
+      allocate();
+  }
+
+  void GradientPath::setCacheGradients(bool cache)
+  {
+    if(cache == cache_gradients_)
+      return;
+    cache_gradients_ = cache;
+    allocate();
+  }
+
+  void GradientPath::allocate()
+  {
     if(gradx_)
       delete[] gradx_;
     if(grady_)
       delete[] grady_;
-    gradx_ = new float[xs * ys];
-    grady_ = new float[xs * ys];
+    if(grad_epoch_)
+      delete[] grad_epoch_;
+    gradx_ = grady_ = NULL;
+    grad_epoch_ = NULL;
+    epoch_ = 0;
+
+    int ns = xs_ * ys_;
+    capacity_ = ns;
+    if(!cache_gradients_ || ns <= 0)
+      return;
+    gradx_ = new float[ns];
+    grady_ = new float[ns];
+    grad_epoch_ = new unsigned int[ns];
+    memset(grad_epoch_, 0, ns * sizeof(unsigned int));
   }
 
   bool GradientPath::getPath(float* potential, double start_x, double start_y,
                              double goal_x, double goal_y,
                              std::vector< std::pair< float, float > >& path)
+  {
+    return tracePath(potential, POT_HIGH, start_x, start_y, goal_x, goal_y,
+                     path);
+  }
+
+  bool GradientPath::getPath(const uint16_t* potential, uint32_t high,
+                             double start_x, double start_y, double goal_x,
+                             double goal_y,
+                             std::vector< std::pair< float, float > >& path)
+  {
+    return tracePath(potential, high, start_x, start_y, goal_x, goal_y, path);
+  }
+
+  bool GradientPath::getPath(const uint32_t* potential, uint32_t high,
+                             double start_x, double start_y, double goal_x,
+                             double goal_y,
+                             std::vector< std::pair< float, float > >& path)
+  {
+    return tracePath(potential, high, start_x, start_y, goal_x, goal_y, path);
+  }
+
+  template< typename T >
+  bool GradientPath::tracePath(const T* potential, double high,
+                               double start_x, double start_y, double goal_x,
+                               double goal_y,
+                               std::vector< std::pair< float, float > >& path)
   {
     std::pair< float, float > current;
     int stc = getIndex(goal_x, goal_y);
@@ -46,8 +104,12 @@ namespace NS_Planner
     float dx = goal_x - (int)goal_x;
     float dy = goal_y - (int)goal_y;
     int ns = xs_ * ys_;
-    memset(gradx_, 0, ns * sizeof(float));
-    memset(grady_, 0, ns * sizeof(float));
+    // a new epoch drops every cached gradient of the last call
+    if(cache_gradients_ && ++epoch_ == 0)
+    {
+      memset(grad_epoch_, 0, capacity_ * sizeof(unsigned int));
+      epoch_ = 1;
+    }
 
     int c = 0;
     while(c++ < ns * 4)
@@ -93,13 +155,13 @@ namespace NS_Planner
       int stcpx = stc - xs_;
 
       // check for potentials at eight positions near cell
-      if(potential[stc] >= POT_HIGH || potential[stc + 1] >= POT_HIGH || potential[stc - 1] >= POT_HIGH || potential[stcnx] >= POT_HIGH || potential[stcnx + 1] >= POT_HIGH || potential[stcnx - 1] >= POT_HIGH || potential[stcpx] >= POT_HIGH || potential[stcpx + 1] >= POT_HIGH || potential[stcpx - 1] >= POT_HIGH || oscillation_detected)
+      if(potential[stc] >= high || potential[stc + 1] >= high || potential[stc - 1] >= high || potential[stcnx] >= high || potential[stcnx + 1] >= high || potential[stcnx - 1] >= high || potential[stcpx] >= high || potential[stcpx + 1] >= high || potential[stcpx - 1] >= high || oscillation_detected)
       {
         // 错误提示
         //ROS_DEBUG("[Path] Pot fn boundary, following grid (%0.1f/%d)", potential[stc], (int) path.size());
         // check eight neighbors to find the lowest
         int minc = stc;
-        int minp = potential[stc];
+        T minp = potential[stc];
         int st = stcpx - 1;
         if(potential[st] < minp)
         {
@@ -155,7 +217,7 @@ namespace NS_Planner
         //ROS_DEBUG("[Path] Pot: %0.1f  pos: %0.1f,%0.1f",
         //    potential[stc], path[npath-1].first, path[npath-1].second);
 
-        if(potential[stc] >= POT_HIGH)
+        if(potential[stc] >= high)
         {
           // 错误提示
           //ROS_DEBUG("[PathCalc] No path found, high potential");
@@ -169,17 +231,18 @@ namespace NS_Planner
       {
 
         // get grad at four positions near cell
-        gradCell(potential, stc);
-        gradCell(potential, stc + 1);
-        gradCell(potential, stcnx);
-        gradCell(potential, stcnx + 1);
+        float gx[4], gy[4];
+        gradCell(potential, high, stc, gx[0], gy[0]);
+        gradCell(potential, high, stc + 1, gx[1], gy[1]);
+        gradCell(potential, high, stcnx, gx[2], gy[2]);
+        gradCell(potential, high, stcnx + 1, gx[3], gy[3]);
 
         // get interpolated gradient
-        float x1 = (1.0 - dx) * gradx_[stc] + dx * gradx_[stc + 1];
-        float x2 = (1.0 - dx) * gradx_[stcnx] + dx * gradx_[stcnx + 1];
+        float x1 = (1.0 - dx) * gx[0] + dx * gx[1];
+        float x2 = (1.0 - dx) * gx[2] + dx * gx[3];
         float x = (1.0 - dy) * x1 + dy * x2; // interpolated x
-        float y1 = (1.0 - dx) * grady_[stc] + dx * grady_[stc + 1];
-        float y2 = (1.0 - dx) * grady_[stcnx] + dx * grady_[stcnx + 1];
+        float y1 = (1.0 - dx) * gy[0] + dx * gy[1];
+        float y2 = (1.0 - dx) * gy[2] + dx * gy[3];
         float y = (1.0 - dy) * y1 + dy * y2; // interpolated y
 
         // show gradients
@@ -258,43 +321,50 @@ namespace NS_Planner
 //
 // calculate gradient at a cell
 // positive value are to the right and down
-  float GradientPath::gradCell(float* potential, int n)
+  template< typename T >
+  void GradientPath::gradCell(const T* potential, double high, int n,
+                              float& grad_x, float& grad_y)
   {
-    if(gradx_[n] + grady_[n] > 0.0)    // check this cell
-      return 1.0;
+    if(cache_gradients_ && grad_epoch_[n] == epoch_)    // check this cell
+    {
+      grad_x = gradx_[n];
+      grad_y = grady_[n];
+      return;
+    }
 
+    grad_x = grad_y = 0.0;
     if(n < xs_ || n > xs_ * ys_ - xs_)    // would be out of bounds
-      return 0.0;
+      return;
     float cv = potential[n];
     float dx = 0.0;
     float dy = 0.0;
 
     // check for in an obstacle
-    if(cv >= POT_HIGH)
+    if(cv >= high)
     {
-      if(potential[n - 1] < POT_HIGH)
+      if(potential[n - 1] < high)
         dx = -lethal_cost_;
-      else if(potential[n + 1] < POT_HIGH)
+      else if(potential[n + 1] < high)
         dx = lethal_cost_;
 
-      if(potential[n - xs_] < POT_HIGH)
+      if(potential[n - xs_] < high)
         dy = -lethal_cost_;
-      else if(potential[xs_ + 1] < POT_HIGH)
+      else if(potential[xs_ + 1] < high)
         dy = lethal_cost_;
     }
 
     else                // not in an obstacle
     {
       // dx calc, average to sides
-      if(potential[n - 1] < POT_HIGH)
+      if(potential[n - 1] < high)
         dx += potential[n - 1] - cv;
-      if(potential[n + 1] < POT_HIGH)
+      if(potential[n + 1] < high)
         dx += cv - potential[n + 1];
 
       // dy calc, average to sides
-      if(potential[n - xs_] < POT_HIGH)
+      if(potential[n - xs_] < high)
         dy += potential[n - xs_] - cv;
-      if(potential[n + xs_] < POT_HIGH)
+      if(potential[n + xs_] < high)
         dy += cv - potential[n + xs_];
     }
 
@@ -303,10 +373,15 @@ namespace NS_Planner
     if(norm > 0)
     {
       norm = 1.0 / norm;
-      gradx_[n] = norm * dx;
-      grady_[n] = norm * dy;
+      grad_x = norm * dx;
+      grad_y = norm * dy;
+    }
+    if(cache_gradients_)
+    {
+      gradx_[n] = grad_x;
+      grady_[n] = grad_y;
+      grad_epoch_[n] = epoch_;
     }
-    return norm;
   }
 
 } //end namespace global_planner
@@ -16,6 +16,15 @@ namespace NS_Planner
     void
     setSize(int xs, int ys);
 
+    /**
+     * true: gradients are cached per cell and the cache is invalidated by
+     * bumping an epoch instead of clearing it.
+     * false: no per cell arrays, the four gradients around each step are
+     * computed on the fly from the potential.
+     */
+    void
+    setCacheGradients(bool cache);
+
     //
     // Path construction
     // Find gradient at array points, interpolate path
@@ -29,16 +38,41 @@ namespace NS_Planner
     bool
     getPath(float* potential, double start_x, double start_y, double end_x,
             double end_y, std::vector< std::pair< float, float > >& path);
+    /**
+     * the same traceback on fixed point potentials, high marks unassigned
+     * cells, only differences of potentials are used so the scale drops out
+     */
+    bool
+    getPath(const uint16_t* potential, uint32_t high, double start_x,
+            double start_y, double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path);
+    bool
+    getPath(const uint32_t* potential, uint32_t high, double start_x,
+            double start_y, double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path);
   private:
     inline int getNearestPoint(int stc, float dx, float dy)
     {
       int pt = stc + (int)round(dx) + (int)(xs_ * round(dy));
       return std::max(0, std::min(xs_ * ys_ - 1, pt));
     }
-    float
-    gradCell(float* potential, int n);
+    template< typename T >
+    bool
+    tracePath(const T* potential, double high, double start_x,
+              double start_y, double end_x, double end_y,
+              std::vector< std::pair< float, float > >& path);
+    template< typename T >
+    void
+    gradCell(const T* potential, double high, int n, float& grad_x,
+             float& grad_y);
+    void
+    allocate();
 
     float *gradx_, *grady_; /**< gradient arrays, size of potential array */
+    unsigned int* grad_epoch_; /**< gradx_/grady_ of a cell valid if equal to epoch_ */
+    unsigned int epoch_;
+    int capacity_; /**< cells the arrays hold, a smaller grid reuses them */
+    bool cache_gradients_;
 
     float pathStep_; /**< step size for following gradient */
   };
@@ -0,0 +1,292 @@
+#include "JumpPoint.h"
+
+
+namespace NS_Planner
+{
+
+  JumpPointExpansion::JumpPointExpansion (PotentialCalculator* p_calc, int nx,
+                                          int ny)
+      : Expander (p_calc, nx, ny), g_ (NULL), parent_ (NULL), seen_ (NULL),
+        closed_ (NULL), round_ (0), tolerance_ (0)
+  {
+    setSize (nx, ny);
+  }
+
+  JumpPointExpansion::~JumpPointExpansion ()
+  {
+    if (g_)
+      delete[] g_;
+    if (parent_)
+      delete[] parent_;
+    if (seen_)
+      delete[] seen_;
+    if (closed_)
+      delete[] closed_;
+  }
+
+  void
+  JumpPointExpansion::setSize (int nx, int ny)
+  {
+    Expander::setSize (nx, ny);
+    // stamps of older rounds stay invalid, a smaller grid keeps the buffers
+    if (ns_ <= capacity_)
+      return;
+    if (g_)
+      delete[] g_;
+    if (parent_)
+      delete[] parent_;
+    if (seen_)
+      delete[] seen_;
+    if (closed_)
+      delete[] closed_;
+    g_ = new float[ns_];
+    parent_ = new int[ns_];
+    seen_ = new unsigned int[ns_];
+    closed_ = new unsigned int[ns_];
+    memset (seen_, 0, ns_ * sizeof(unsigned int));
+    memset (closed_, 0, ns_ * sizeof(unsigned int));
+    capacity_ = ns_;
+    round_ = 0;
+  }
+
+  float
+  JumpPointExpansion::getCost (unsigned char* costs, int n)
+  {
+    float c = costs[n];
+    if (c >= lethal_cost_ && !(unknown_ && c == NS_CostMap::NO_INFORMATION))
+      return lethal_cost_;
+    c = c * factor_ + neutral_cost_;
+    if (c >= lethal_cost_)
+      c = lethal_cost_ - 1;
+    return c;
+  }
+
+  bool
+  JumpPointExpansion::calculatePotentials (unsigned char* costs,
+                                           double start_x, double start_y,
+                                           double end_x, double end_y,
+                                           int cycles, float* potential)
+  {
+    cells_visited_ = 0;
+    open_.clear ();
+    std::fill (potential, potential + ns_, POT_HIGH);
+
+    if (++round_ == 0)
+    {
+      memset (seen_, 0, capacity_ * sizeof(unsigned int));
+      memset (closed_, 0, capacity_ * sizeof(unsigned int));
+      round_ = 1;
+    }
+
+    int start_i = toIndex (start_x, start_y);
+    int goal_i = toIndex (end_x, end_y);
+    int gx = end_x, gy = end_y;
+
+    g_[start_i] = 0;
+    parent_[start_i] = -1;
+    seen_[start_i] = round_;
+    open_.push_back (Index (start_i, heuristic (start_x, start_y, gx, gy)));
+
+    int cycle = 0;
+    while (open_.size () > 0 && cycle++ < cycles)
+    {
+      if (cancel_requested_)
+        return false;
+
+      Index top = open_[0];
+      std::pop_heap (open_.begin (), open_.end (), greater1 ());
+      open_.pop_back ();
+
+      int n = top.i;
+      if (closed_[n] == round_)
+        continue;
+      closed_[n] = round_;
+      cells_visited_++;
+
+      if (n == goal_i)
+      {
+        paintPath (potential, start_i, goal_i, start_x, start_y);
+        return true;
+      }
+
+      int x = n % nx_, y = n / nx_;
+      bool jumping = isUniform (costs, x, y) && !nearGoal (x, y, gx, gy);
+      int p = parent_[n];
+      if (!jumping || p < 0)
+      {
+        // plain expansion near obstacles, and all 8 directions from start
+        for (int dy = -1; dy <= 1; dy++)
+          for (int dx = -1; dx <= 1; dx++)
+            if (dx != 0 || dy != 0)
+              successor (costs, n, dx, dy, jumping, gx, gy);
+        continue;
+      }
+
+      // natural neighbors only, uniform cells have no forced ones
+      int px = p % nx_, py = p / nx_;
+      int dx = (x > px) - (x < px), dy = (y > py) - (y < py);
+      successor (costs, n, dx, dy, true, gx, gy);
+      if (dx != 0 && dy != 0)
+      {
+        successor (costs, n, dx, 0, true, gx, gy);
+        successor (costs, n, 0, dy, true, gx, gy);
+      }
+    }
+
+    // the goal is out of reach, the search already covered the tolerance
+    int nearest = nearestExpanded (gx, gy);
+    if (nearest >= 0 && !cancel_requested_)
+      paintPath (potential, start_i, nearest, start_x, start_y);
+    return false;
+  }
+
+  int
+  JumpPointExpansion::nearestExpanded (int end_x, int end_y)
+  {
+    int r = tolerance_, best = -1, best_d2 = r * r;
+    for (int dy = -r; dy <= r; dy++)
+    {
+      int y = end_y + dy;
+      if (y < 0 || y >= ny_)
+        continue;
+      for (int dx = -r; dx <= r; dx++)
+      {
+        int x = end_x + dx, d2 = dx * dx + dy * dy;
+        if (x < 0 || x >= nx_ || d2 > best_d2)
+          continue;
+        int n = toIndex (x, y);
+        if (closed_[n] != round_)
+          continue;
+        if (best < 0 || d2 < best_d2 || g_[n] < g_[best])
+        {
+          best = n;
+          best_d2 = d2;
+        }
+      }
+    }
+    return best;
+  }
+
+  void
+  JumpPointExpansion::successor (unsigned char* costs, int n, int dx, int dy,
+                                 bool jumping, int end_x, int end_y)
+  {
+    int x = n % nx_, y = n / nx_;
+    int next, steps = 1;
+    if (jumping)
+    {
+      next = jump (costs, x, y, dx, dy, end_x, end_y, steps);
+      if (next < 0)
+        return;
+    }
+    else
+    {
+      if (isBlocked (costs, x + dx, y + dy))
+        return;
+      // no cutting corners of lethal cells
+      if (dx != 0 && dy != 0
+          && (isBlocked (costs, x + dx, y) || isBlocked (costs, x, y + dy)))
+        return;
+      next = toIndex (x + dx, y + dy);
+    }
+    if (closed_[next] == round_)
+      return;
+
+    // cells walked over are free (neutral cost), the last one has its own
+    float length = (dx != 0 && dy != 0) ? M_SQRT2 : 1.0;
+    float g = g_[n]
+        + length * ((steps - 1) * neutral_cost_ + getCost (costs, next));
+    if (seen_[next] == round_ && g >= g_[next])
+      return;
+
+    g_[next] = g;
+    parent_[next] = n;
+    seen_[next] = round_;
+    open_.push_back (
+        Index (next, g + heuristic (next % nx_, next / nx_, end_x, end_y)));
+    std::push_heap (open_.begin (), open_.end (), greater1 ());
+  }
+
+  bool
+  JumpPointExpansion::hasForced (unsigned char* costs, int x, int y, int dx,
+                                 int dy)
+  {
+    if (dx != 0 && dy != 0)
+      return (!isFree (costs, x - dx, y) && isFree (costs, x - dx, y + dy))
+          || (!isFree (costs, x, y - dy) && isFree (costs, x + dx, y - dy));
+
+    // both sides, turning past an obstacle or around the end of one
+    for (int s = -1; s <= 1; s += 2)
+    {
+      int qx = x + s * dy, qy = y + s * dx;
+      if ((!isFree (costs, qx, qy) && isFree (costs, qx + dx, qy + dy))
+          || (!isFree (costs, qx - dx, qy - dy) && isFree (costs, qx, qy)))
+        return true;
+    }
+    return false;
+  }
+
+  int
+  JumpPointExpansion::jump (unsigned char* costs, int x, int y, int dx,
+                            int dy, int end_x, int end_y, int& steps)
+  {
+    steps = 0;
+    while (true)
+    {
+      // a dead end, nothing to turn to on the way
+      if (isBlocked (costs, x + dx, y + dy))
+        return -1;
+      if (dx != 0 && dy != 0
+          && (isBlocked (costs, x + dx, y) || isBlocked (costs, x, y + dy)))
+        return -1;
+      x += dx;
+      y += dy;
+      steps++;
+
+      // cells walked over are free, one with a cost of its own is expanded
+      if (nearGoal (x, y, end_x, end_y) || !isFree (costs, x, y)
+          || hasForced (costs, x, y, dx, dy))
+        return toIndex (x, y);
+
+      if (dx != 0 && dy != 0)
+      {
+        int s;
+        if (jump (costs, x, y, dx, 0, end_x, end_y, s) >= 0
+            || jump (costs, x, y, 0, dy, end_x, end_y, s) >= 0)
+          return toIndex (x, y);
+      }
+    }
+  }
+
+  void
+  JumpPointExpansion::paintPath (float* potential, int start_i, int goal_i,
+                                 double start_x, double start_y)
+  {
+    // jump points from goal back to start, then walk each straight segment
+    std::vector<int> points;
+    for (int n = goal_i; n >= 0; n = parent_[n])
+      points.push_back (n);
+
+    potential[goal_i] = g_[goal_i];
+    for (size_t k = 0; k + 1 < points.size (); k++)
+    {
+      int a = points[k + 1], b = points[k];
+      int ax = a % nx_, ay = a / nx_, bx = b % nx_, by = b / nx_;
+      int dx = (bx > ax) - (bx < ax), dy = (by > ay) - (by < ay);
+      int steps = std::max (abs (bx - ax), abs (by - ay));
+      for (int s = 0; s < steps; s++)
+      {
+        int c = toIndex (ax + s * dx, ay + s * dy);
+        potential[c] = g_[a] + (g_[b] - g_[a]) * s / steps;
+      }
+    }
+
+    // the traceback ends on the cell nearest to the precise start,
+    // make it the lowest one of the start block
+    int nearest = toIndex (start_x + 0.5, start_y + 0.5);
+    if (nearest != start_i)
+      potential[start_i] = 1;
+    potential[nearest] = 0;
+  }
+
+} //end namespace global_planner
@@ -0,0 +1,132 @@
+#ifndef _JUMP_POINT_H_
+#define _JUMP_POINT_H_
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../../../../costmap/costmap_2d/CostValues.h"
+#include "Expander.h"
+#include "Astar.h"
+
+namespace NS_Planner
+{
+
+  /**
+   * Jump Point Search on the 8-connected grid.
+   * jumps only walk over FREE_SPACE cells, any other cost counts as an
+   * obstacle for the forced neighbor rules. a jump stops on the goal (or
+   * next to it), at a forced neighbor or on a cell with a cost of its own,
+   * and gives up (-1) on lethal cells and the map edge. jump points that
+   * are not "uniform" (own cost and all 8 neighbors FREE_SPACE) are
+   * expanded like plain A*, all 8 neighbors with their real cost.
+   * the search only visits jump points, so the found path is painted into
+   * the potential array for the traceback to follow, every other cell
+   * stays POT_HIGH.
+   * with a goal tolerance, jumps also stop on the cells within it and those
+   * are expanded like plain A*, so a failed search has seen every reachable
+   * cell there and paints the path to the one nearest to the goal instead.
+   */
+  class JumpPointExpansion: public Expander
+  {
+  public:
+    JumpPointExpansion (PotentialCalculator* p_calc, int nx, int ny);
+    ~JumpPointExpansion ();
+
+    bool
+    calculatePotentials (unsigned char* costs, double start_x, double start_y,
+                         double end_x, double end_y, int cycles,
+                         float* potential);
+
+    void
+    setSize (int nx, int ny);
+
+    /**
+     * radius in cells around the goal a failed search falls back to, 0 for none
+     */
+    void
+    setGoalTolerance (int cells)
+    {
+      tolerance_ = cells;
+    }
+  private:
+    inline bool isBlocked (unsigned char* costs, int x, int y)
+    {
+      return x < 0 || x >= nx_ || y < 0 || y >= ny_
+          || getCost (costs, toIndex (x, y)) >= lethal_cost_;
+    }
+    inline bool isFree (unsigned char* costs, int x, int y)
+    {
+      return x >= 0 && x < nx_ && y >= 0 && y < ny_
+          && costs[toIndex (x, y)] == NS_CostMap::FREE_SPACE;
+    }
+    inline bool nearGoal (int x, int y, int end_x, int end_y)
+    {
+      int dx = x - end_x, dy = y - end_y;
+      return (abs (dx) <= 1 && abs (dy) <= 1)
+          || dx * dx + dy * dy <= tolerance_ * tolerance_;
+    }
+    inline bool isUniform (unsigned char* costs, int x, int y)
+    {
+      if (x < 1 || x >= nx_ - 1 || y < 1 || y >= ny_ - 1)
+        return false;
+      unsigned char* c = costs + toIndex (x, y);
+      return c[0] == NS_CostMap::FREE_SPACE && c[-1] == NS_CostMap::FREE_SPACE
+          && c[1] == NS_CostMap::FREE_SPACE
+          && c[-nx_ - 1] == NS_CostMap::FREE_SPACE
+          && c[-nx_] == NS_CostMap::FREE_SPACE
+          && c[-nx_ + 1] == NS_CostMap::FREE_SPACE
+          && c[nx_ - 1] == NS_CostMap::FREE_SPACE
+          && c[nx_] == NS_CostMap::FREE_SPACE
+          && c[nx_ + 1] == NS_CostMap::FREE_SPACE;
+    }
+    inline float heuristic (int x, int y, int end_x, int end_y)
+    {
+      int dx = abs (x - end_x), dy = abs (y - end_y);
+      return (std::max (dx, dy) + (M_SQRT2 - 1) * std::min (dx, dy))
+          * neutral_cost_;
+    }
+    float
+    getCost (unsigned char* costs, int n);
+
+    /**
+     * true if moving through (x, y) in direction (dx, dy) may have to turn
+     * there
+     */
+    bool
+    hasForced (unsigned char* costs, int x, int y, int dx, int dy);
+    /**
+     * walk from (x, y) in direction (dx, dy), return the index of the next
+     * jump point or -1, steps is the number of cells walked
+     */
+    int
+    jump (unsigned char* costs, int x, int y, int dx, int dy, int end_x,
+          int end_y, int& steps);
+    /**
+     * single step or jump from n in direction (dx, dy)
+     */
+    void
+    successor (unsigned char* costs, int n, int dx, int dy, bool jumping,
+               int end_x, int end_y);
+    void
+    paintPath (float* potential, int start_i, int goal_i, double start_x,
+               double start_y);
+    /**
+     * the expanded cell within tolerance_ of the goal nearest to it (lowest g
+     * among equals), -1 if there is none
+     */
+    int
+    nearestExpanded (int end_x, int end_y);
+
+    std::vector<Index> open_;
+    float* g_;
+    int* parent_;
+    /** round stamps, g_/parent_ are valid if seen_ equals round_ */
+    unsigned int* seen_;
+    unsigned int* closed_;
+    unsigned int round_;
+    int tolerance_;
+  };
+
+} //end namespace global_planner
+#endif
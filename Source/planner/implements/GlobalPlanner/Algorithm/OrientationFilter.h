@@ -23,6 +23,10 @@ namespace NS_Planner
     {
     }
 
+    virtual ~OrientationFilter()
+    {
+    }
+
     virtual void
     processPath(const Pose2D& start,
                 std::vector< Pose2D >& path);
@@ -0,0 +1,191 @@
+#include "PathSimplifier.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace NS_Planner
+{
+
+  void PathSimplifier::simplify(
+      const unsigned char* costs, int nx, int ny,
+      std::vector< std::pair< double, double > >& path)
+  {
+    if(path.size() < 3)
+      return;
+    costs_ = costs;
+    nx_ = nx;
+    ny_ = ny;
+
+    std::vector< unsigned char > segment_cost;
+    shortcut(path, segment_cost);
+
+    if(path.size() > 2 && tolerance_ > 0)
+    {
+      std::vector< bool > keep(path.size(), false);
+      keep.front() = true;
+      keep.back() = true;
+      douglasPeucker(path, segment_cost, 0, path.size() - 1, keep);
+
+      size_t n = 0;
+      for(size_t i = 0; i < path.size(); i++)
+      {
+        if(keep[i])
+          path[n++] = path[i];
+      }
+      path.resize(n);
+    }
+
+    if(step_ > 0)
+      resample(path);
+  }
+
+  unsigned char PathSimplifier::pointCost(
+      const std::pair< double, double >& p)
+  {
+    int x = (int) floor(p.first + 0.5), y = (int) floor(p.second + 0.5);
+    if(x < 0 || x >= nx_ || y < 0 || y >= ny_)
+      return NS_CostMap::LETHAL_OBSTACLE;
+    return costs_[x + y * nx_];
+  }
+
+  bool PathSimplifier::lineCost(const std::pair< double, double >& a,
+                                const std::pair< double, double >& b,
+                                unsigned char& line_cost)
+  {
+    // cell traversal (Amanatides-Woo), shifted so cell i covers [i, i + 1)
+    double x0 = a.first + 0.5, y0 = a.second + 0.5;
+    double x1 = b.first + 0.5, y1 = b.second + 0.5;
+    int cx = (int) floor(x0), cy = (int) floor(y0);
+    int n = abs((int) floor(x1) - cx) + abs((int) floor(y1) - cy);
+
+    double dx = x1 - x0, dy = y1 - y0;
+    int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+    double tdx = dx != 0 ? fabs(1.0 / dx) : HUGE_VAL;
+    double tdy = dy != 0 ? fabs(1.0 / dy) : HUGE_VAL;
+    double tmx = dx != 0 ? (sx > 0 ? cx + 1 - x0 : x0 - cx) * tdx : HUGE_VAL;
+    double tmy = dy != 0 ? (sy > 0 ? cy + 1 - y0 : y0 - cy) * tdy : HUGE_VAL;
+
+    line_cost = 0;
+    for(int k = 0;; k++)
+    {
+      if(cx < 0 || cx >= nx_ || cy < 0 || cy >= ny_)
+        return false;
+      unsigned char c = costs_[cx + cy * nx_];
+      if(c >= max_cost_)
+        return false;
+      line_cost = std::max(line_cost, c);
+      if(k >= n)
+        break;
+      if(tmx < tmy)
+      {
+        tmx += tdx;
+        cx += sx;
+      }
+      else
+      {
+        tmy += tdy;
+        cy += sy;
+      }
+    }
+    return true;
+  }
+
+  void PathSimplifier::shortcut(
+      std::vector< std::pair< double, double > >& path,
+      std::vector< unsigned char >& segment_cost)
+  {
+    std::vector< std::pair< double, double > > out;
+    segment_cost.clear();
+    out.push_back(path[0]);
+
+    // path[anchor..j - 1] is replaced by one straight segment, replaced is
+    // its highest point cost and anchor_line the cost of that segment
+    size_t anchor = 0;
+    unsigned char replaced = pointCost(path[0]);
+    unsigned char anchor_line = replaced;
+    for(size_t j = 1; j < path.size(); j++)
+    {
+      unsigned char c = std::max(replaced, pointCost(path[j]));
+      unsigned char line = c;
+      if(j > anchor + 1 && !(lineCost(path[anchor], path[j], line) && line <= c))
+      {
+        // out of sight, the previous point becomes a corner
+        out.push_back(path[j - 1]);
+        segment_cost.push_back(anchor_line);
+        anchor = j - 1;
+        c = std::max(pointCost(path[anchor]), pointCost(path[j]));
+        line = c;
+      }
+      replaced = c;
+      anchor_line = line;
+    }
+    out.push_back(path.back());
+    segment_cost.push_back(anchor_line);
+    path.swap(out);
+  }
+
+  void PathSimplifier::douglasPeucker(
+      const std::vector< std::pair< double, double > >& path,
+      const std::vector< unsigned char >& segment_cost, int first, int last,
+      std::vector< bool >& keep)
+  {
+    if(last <= first + 1)
+      return;
+
+    const std::pair< double, double >& a = path[first];
+    const std::pair< double, double >& b = path[last];
+    double vx = b.first - a.first, vy = b.second - a.second;
+    double len2 = vx * vx + vy * vy;
+
+    double dmax = -1;
+    int index = first;
+    for(int i = first + 1; i < last; i++)
+    {
+      double wx = path[i].first - a.first, wy = path[i].second - a.second;
+      double t = len2 > 0 ? std::max(0.0, std::min(1.0, (wx * vx + wy * vy) / len2)) : 0;
+      double d = hypot(wx - t * vx, wy - t * vy);
+      if(d > dmax)
+      {
+        dmax = d;
+        index = i;
+      }
+    }
+
+    if(dmax <= tolerance_)
+    {
+      unsigned char replaced = 0;
+      for(int i = first; i < last; i++)
+        replaced = std::max(replaced, segment_cost[i]);
+      unsigned char line;
+      if(lineCost(a, b, line) && line <= replaced)
+        return;
+      // close enough but not free, split anyway
+    }
+
+    keep[index] = true;
+    douglasPeucker(path, segment_cost, first, index, keep);
+    douglasPeucker(path, segment_cost, index, last, keep);
+  }
+
+  void PathSimplifier::resample(
+      std::vector< std::pair< double, double > >& path)
+  {
+    std::vector< std::pair< double, double > > out;
+    out.push_back(path[0]);
+    for(size_t i = 1; i < path.size(); i++)
+    {
+      const std::pair< double, double >& a = path[i - 1];
+      const std::pair< double, double >& b = path[i];
+      int n = (int) ceil(hypot(b.first - a.first, b.second - a.second) / step_);
+      for(int k = 1; k < n; k++)
+      {
+        double t = (double) k / n;
+        out.push_back(std::make_pair(a.first + t * (b.first - a.first),
+                                     a.second + t * (b.second - a.second)));
+      }
+      out.push_back(b);
+    }
+    path.swap(out);
+  }
+
+} //end namespace global_planner
@@ -0,0 +1,77 @@
+#ifndef _PATH_SIMPLIFIER_H_
+#define _PATH_SIMPLIFIER_H_
+
+#include <vector>
+#include <utility>
+#include "../../../../costmap/costmap_2d/CostValues.h"
+
+namespace NS_Planner
+{
+
+  /**
+   * shrinks the dense traceback output (a point every half cell) before the
+   * orientation filter:
+   * 1. line of sight shortcut, the path is pulled straight between the
+   *    points that can still see each other on the costmap
+   * 2. Ramer-Douglas-Peucker with a tolerance in cells
+   * 3. resampling so no two points are further apart than the step
+   * a straight segment is only accepted if none of its cells reaches
+   * max_cost_ and its highest cost is not above the highest cost of the
+   * part of the path it replaces, so clearance from obstacles is kept.
+   * all coordinates are in map cells, cell centres at whole numbers.
+   */
+  class PathSimplifier
+  {
+  public:
+    PathSimplifier()
+        : tolerance_(1.0), step_(0.0),
+          max_cost_(NS_CostMap::INSCRIBED_INFLATED_OBSTACLE)
+    {
+    }
+
+    void
+    simplify(const unsigned char* costs, int nx, int ny,
+             std::vector< std::pair< double, double > >& path);
+
+    void setTolerance(double tolerance)
+    {
+      tolerance_ = tolerance;
+    }
+    /** <= 0 keeps only the corner points */
+    void setResampleStep(double step)
+    {
+      step_ = step;
+    }
+    void setMaxCost(unsigned char max_cost)
+    {
+      max_cost_ = max_cost;
+    }
+  private:
+    /**
+     * walks every cell the segment touches, false if one of them is off the
+     * grid or at least max_cost_, line_cost is the highest cost on it
+     */
+    bool
+    lineCost(const std::pair< double, double >& a,
+             const std::pair< double, double >& b, unsigned char& line_cost);
+    unsigned char
+    pointCost(const std::pair< double, double >& p);
+
+    void
+    shortcut(std::vector< std::pair< double, double > >& path,
+             std::vector< unsigned char >& segment_cost);
+    void
+    douglasPeucker(const std::vector< std::pair< double, double > >& path,
+                   const std::vector< unsigned char >& segment_cost,
+                   int first, int last, std::vector< bool >& keep);
+    void
+    resample(std::vector< std::pair< double, double > >& path);
+
+    const unsigned char* costs_;
+    int nx_, ny_;
+    double tolerance_, step_;
+    unsigned char max_cost_;
+  };
+
+} //end namespace global_planner
+#endif
@@ -16,6 +16,10 @@ namespace NS_Planner
       setSize(nx, ny);
     }
 
+    virtual ~PotentialCalculator()
+    {
+    }
+
     virtual float calculatePotential(float* potential, unsigned char cost,
                                      int n, float prev_potential = -1)
     {
@@ -1,6 +1,7 @@
 #ifndef _TRACEBACK_H_
 #define _TRACEBACK_H_
 #include <vector>
+#include <stdint.h>
 #include "PotentialCalculator.h"
 
 namespace NS_Planner
@@ -14,10 +15,32 @@ namespace NS_Planner
     {
     }
 
+    virtual ~Traceback()
+    {
+    }
+
     virtual bool
     getPath(float* potential, double start_x, double start_y, double end_x,
             double end_y, std::vector< std::pair< float, float > >& path) = 0;
 
+    /**
+     * fixed point potentials, a traceback that only follows floats says no
+     */
+    virtual bool
+    getPath(const uint16_t* potential, uint32_t high, double start_x,
+            double start_y, double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path)
+    {
+      return false;
+    }
+    virtual bool
+    getPath(const uint32_t* potential, uint32_t high, double start_x,
+            double start_y, double end_x, double end_y,
+            std::vector< std::pair< float, float > >& path)
+    {
+      return false;
+    }
+
     virtual void setSize(int xs, int ys)
     {
       xs_ = xs;
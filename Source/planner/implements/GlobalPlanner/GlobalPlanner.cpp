@@ -12,10 +12,16 @@
 
 #include "Algorithm/Dijkstra.h"
 #include "Algorithm/Astar.h"
+#include "Algorithm/AnytimeAstar.h"
+#include "Algorithm/JumpPoint.h"
+#include "Algorithm/Bidirectional.h"
 #include <Parameter/Parameter.h>
 #include <Console/Console.h>
 
 #include <iostream>
+#include <time.h>
+#include <string.h>
+#include <algorithm>
 using namespace std;
 
 /*
@@ -23,10 +29,39 @@ using namespace std;
  */
 namespace NS_Planner {
 
-GlobalPlanner::GlobalPlanner() {
+GlobalPlanner::GlobalPlanner() :
+		initialized_(false), p_calc_(NULL), planner_(NULL), path_maker_(NULL), orientation_filter_(
+				NULL), path_simplifier_(NULL), potential_array_(NULL), compact_(
+				NULL), jump_point_(NULL), grid_nx_(0), grid_ny_(0), grid_ox_(0), grid_oy_(
+				0), grid_capacity_(0), window_costs_(NULL), window_nx_(0), window_ny_(
+				0), corridor_width_(0), corridor_tiers_(0), corridor_costs_(NULL), corridor_capacity_(
+				0), corridor_nx_(0), corridor_ny_(0), last_plan_cost_(0), tolerance_triggered_(
+				0), tolerance_resolved_(0), components_(NULL), unreachable_rejected_(
+				0), unreachable_saved_ms_(0), ms_per_cell_(0), field_expander_(
+				NULL), lethal_cost_(253), neutral_cost_(66), cost_factor_(0.55), field_potential_(
+				NULL), field_nx_(0), field_ny_(0), field_valid_(false) {
 }
 
+/*
+ * compact_、jump_point_ 以及 dijkstra 模式下的 field_expander_ 和 planner_
+ * 是同一个对象，只删一次；p_calc_ 被各个 expander 和 path_maker_ 引用，最后删
+ */
 GlobalPlanner::~GlobalPlanner() {
+	if (field_expander_ != planner_)
+		delete field_expander_;
+	delete planner_;
+	for (size_t i = 0; i < benchmark_expanders_.size(); i++)
+		delete benchmark_expanders_[i];
+	delete path_maker_;
+	delete orientation_filter_;
+	delete path_simplifier_;
+	delete components_;
+	delete p_calc_;
+
+	delete[] potential_array_;
+	delete[] window_costs_;
+	delete[] corridor_costs_;
+	delete[] field_potential_;
 }
 
 /*
@@ -65,11 +100,48 @@ void GlobalPlanner::onInitialize() {
 		//use quadratic directly
 		p_calc_ = new QuadraticCalculator(cx, cy);
 
+		/*
+		 * compact_potential 为 16 或 32 时 potential 用定点整数保存，
+		 * 配合 gradient_cache = 0 每个格子只占 2 或 4 字节
+		 */
+		int compact_potential = parameter.getParameter("compact_potential", 0);
+		if (compact_potential == 16 || compact_potential == 32) {
+			if (compact_potential == 16) {
+				compact_ = new FixedPointExpansion<uint16_t>(cx, cy);
+			} else {
+				compact_ = new FixedPointExpansion<uint32_t>(cx, cy);
+			}
+			compact_->setScale(parameter.getParameter("fixed_point_scale", 0.0f));
+			planner_ = compact_;
+			logInfo<< "compact potential "<<compact_potential<<" bit , "
+			<<compact_->getBytesPerCell()<<" bytes per cell";
+		}
+		//anytime weighted a*, bounded by a deadline and cancellable
+		else if (parameter.getParameter("use_anytime", 0) == 1) {
+			AnytimeAStarExpansion* ae = new AnytimeAStarExpansion(p_calc_, cx,
+					cy);
+			ae->setWeights(parameter.getParameter("anytime_initial_weight", 3.0f),
+					parameter.getParameter("anytime_weight_step", 0.5f));
+			ae->setDeadline(parameter.getParameter("planner_deadline", 0.2f));
+			ae->setCheckInterval(
+					parameter.getParameter("cancel_check_interval", 500));
+			planner_ = ae;
+		}
+		//jump point search through free space, plain a* near obstacles
+		else if (parameter.getParameter("use_jps", 0) == 1) {
+			jump_point_ = new JumpPointExpansion(p_calc_, cx, cy);
+			planner_ = jump_point_;
+		}
+		//dijkstra from start and goal at once, the goal side on a second thread
+		else if (parameter.getParameter("use_bidirectional", 0) == 1) {
+			planner_ = new BidirectionalExpansion(p_calc_, cx, cy);
+		}
 		//use dijkstra directly
-		if (parameter.getParameter("use_dijkstra", 1) == 1) {
+		else if (parameter.getParameter("use_dijkstra", 1) == 1) {
 			DijkstraExpansion* de = new DijkstraExpansion(p_calc_, cx, cy);
 			de->setPreciseStart(true);
 			planner_ = de;
+			field_expander_ = de;
 //			planner_ = new DijkstraExpansion(p_calc_, cx, cy);
 //					planner_->setPreciseStart(true);
 		}else{
@@ -81,7 +153,11 @@ void GlobalPlanner::onInitialize() {
 		 * 获取 use_grid_path 参数值，根据参数值创建 path_maker_ 实例，用 GridPath 还是 GradientPath
 		 * Traceback、GridPath、GradientPath
 		 */
-		path_maker_ = new GradientPath(p_calc_);
+		GradientPath* gradient_path = new GradientPath(p_calc_);
+		//0: no full map gradient arrays, gradients computed per traceback step
+		gradient_path->setCacheGradients(
+				parameter.getParameter("gradient_cache", compact_ ? 0 : 1) == 1);
+		path_maker_ = gradient_path;
 
 		orientation_filter_ = new OrientationFilter();
 
@@ -97,18 +173,61 @@ void GlobalPlanner::onInitialize() {
 		planner_window_x_ = parameter.getParameter("planner_window_x", 0.0f); // float 0.0f 指明调用参数为 float
 		planner_window_y_ = parameter.getParameter("planner_window_y", 0.0f);
 		default_tolerance_ = parameter.getParameter("default_tolerance", 0.0f);
+		corridor_width_ = parameter.getParameter("corridor_width", 0.2f);
+		corridor_tiers_ = parameter.getParameter("corridor_tiers", 3);
 
-		int lethal_cost = parameter.getParameter("lethal_cost", 253);
-		int neutral_cost = parameter.getParameter("neutral_cost", 66);
-		double cost_factor = parameter.getParameter("cost_factor", 0.55f);
+		lethal_cost_ = parameter.getParameter("lethal_cost", 253);
+		neutral_cost_ = parameter.getParameter("neutral_cost", 66);
+		cost_factor_ = parameter.getParameter("cost_factor", 0.55f);
 		int orientation_mode = parameter.getParameter("orientation_mode", 1);
 
-		planner_->setLethalCost(lethal_cost);
-		path_maker_->setLethalCost(lethal_cost);
-		planner_->setNeutralCost(neutral_cost);
-		planner_->setFactor(cost_factor);
+		planner_->setLethalCost(lethal_cost_);
+		path_maker_->setLethalCost(lethal_cost_);
+		planner_->setNeutralCost(neutral_cost_);
+		planner_->setFactor(cost_factor_);
+
+		//run every expander on each full map plan and log expansions and latency
+		if (parameter.getParameter("expander_benchmark", 0) == 1) {
+			DijkstraExpansion* de = new DijkstraExpansion(p_calc_, cx, cy);
+			de->setPreciseStart(true);
+			benchmark_names_.push_back("dijkstra");
+			benchmark_expanders_.push_back(de);
+			benchmark_names_.push_back("astar");
+			benchmark_expanders_.push_back(new AStarExpansion(p_calc_, cx, cy));
+			benchmark_names_.push_back("jps");
+			benchmark_expanders_.push_back(
+					new JumpPointExpansion(p_calc_, cx, cy));
+			benchmark_names_.push_back("bidirectional");
+			benchmark_expanders_.push_back(
+					new BidirectionalExpansion(p_calc_, cx, cy));
+			for (size_t i = 0; i < benchmark_expanders_.size(); i++) {
+				benchmark_expanders_[i]->setHasUnknown(allow_unknown_);
+				benchmark_expanders_[i]->setLethalCost(lethal_cost_);
+				benchmark_expanders_[i]->setNeutralCost(neutral_cost_);
+				benchmark_expanders_[i]->setFactor(cost_factor_);
+			}
+		}
 		orientation_filter_->setMode(orientation_mode);
 
+		//plan_simplify_tolerance and plan_resample_step in metres
+		if (parameter.getParameter("simplify_plan", 1) == 1) {
+			double resolution =
+			costmap->getLayeredCostmap()->getCostmap()->getResolution();
+			path_simplifier_ = new PathSimplifier();
+			path_simplifier_->setTolerance(
+					parameter.getParameter("plan_simplify_tolerance", 0.05f)
+					/ resolution);
+			path_simplifier_->setResampleStep(
+					parameter.getParameter("plan_resample_step", 0.1f)
+					/ resolution);
+		}
+
+		//check that start and goal share a free space component before expanding
+		if (parameter.getParameter("reject_unreachable", 1) == 1) {
+			components_ = new NS_CostMap::FreeSpaceComponents();
+			components_->setThreshold(lethal_cost_, allow_unknown_);
+		}
+
 		initialized_ = true;
 	} else {
 		printf("onInitialize has been called before\n");
@@ -117,6 +236,16 @@ void GlobalPlanner::onInitialize() {
 
 bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
 		std::vector<Pose2D>& plan) {
+	return planFrom(start, goal, plan, true);
+}
+
+bool GlobalPlanner::makePlanFromPose(const Pose2D& start, const Pose2D& goal,
+		std::vector<Pose2D>& plan) {
+	return planFrom(start, goal, plan, false);
+}
+
+bool GlobalPlanner::planFrom(const Pose2D& start, const Pose2D& goal,
+		std::vector<Pose2D>& plan, bool clear_start) {
 	logInfo<< "global planner start make plan";
 	boost::mutex::scoped_lock lock(mutex_);
 
@@ -141,6 +270,7 @@ bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
 	}
 	// 先把 plan 清空
 	plan.clear();
+	planner_->clearCancel();
 
 	double wx = start.x();
 	double wy = start.y();
@@ -183,68 +313,140 @@ bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
 
 	logInfo << "goal_x_i = "<< goal_x_i<<" goal_y_i = "<< goal_y_i;
 
-	///clear current pose of robot at the beginning
-	clearRobotCell(start_x_i, start_y_i);
+	if (components_ != NULL
+			&& !goalConnected(start_x_i, start_y_i, goal_x_i, goal_y_i)) {
+		return false;
+	}
 
-//	int nx = costmap->getLayeredCostmap()->getCostmap()->getSizeInCellsX(), ny =
-//	costmap->getLayeredCostmap()->getCostmap()->getSizeInCellsY();
-//	double resolution =
-//	costmap->getLayeredCostmap()->getCostmap()->getResolution();
-//	double inscribe_radius = costmap->getLayeredCostmap()->getInscribedRadius();
-//	double circumscribed_radius =
-//	costmap->getLayeredCostmap()->getCircumscribedRadius();
-//
-//	logInfo << "size in cell x "<< nx<<" , ny = "<<ny << " , resolution = " << resolution
-//	<< " , inscribed_radius = " << inscribe_radius
-//	<< " ,circumscribed_radius = " << circumscribed_radius << "\n";
-//	logInfo << "origin x = "<< costmap->getLayeredCostmap()->getCostmap()->getOriginX()<<", y = "
-//	<< costmap->getLayeredCostmap()->getCostmap()->getOriginY();
-	//make sure to resize the underlying array that Navfn uses
-	p_calc_->setSize(nx, ny);// PotentialCalculator* p_calc_;
-	planner_->setSize(nx, ny);// Expander* planner_;
-	path_maker_->setSize(nx, ny);// Traceback* path_maker_;
-	potential_array_ = new float[nx * ny];// float* potential_array_;
+	///clear current pose of robot at the beginning
+	if (clear_start)
+		clearRobotCell(start_x_i, start_y_i);
 
 	unsigned char* char_map =
 	costmap->getLayeredCostmap()->getCostmap()->getCharMap();
 
-	///update the boundary of costmap
-	outlineMap(costmap->getLayeredCostmap()->getCostmap()->getCharMap(), nx, ny,
-			NS_CostMap::LETHAL_OBSTACLE);
+	/*
+	 * 起点和终点都落在 planner window 内时只在窗口内扩展，找不到路径再退回整张地图
+	 */
+	bool found_plan = false;
+	if (fitPlannerWindow(start_x_i, start_y_i, goal_x_i, goal_y_i, nx, ny)) {
+		for (int j = 0; j < window_ny_; ++j) {
+			memcpy(window_costs_ + j * window_nx_,
+					char_map + (grid_oy_ + j) * nx + grid_ox_, window_nx_);
+		}
+		///sentinel border of the window
+		outlineMap(window_costs_, window_nx_, window_ny_,
+				NS_CostMap::LETHAL_OBSTACLE);
+		logInfo<< "plan inside window "<<window_nx_<<" x "<<window_ny_
+		<<" at "<<grid_ox_<<" , "<<grid_oy_;
+		found_plan = planOnGrid(window_costs_, window_nx_, window_ny_, start_x,
+				start_y, goal_x, goal_y, goal_x_i, goal_y_i, goal, plan, false);
+		if (!found_plan) {
+			logInfo<< "no plan inside planner window , fall back to the full map";
+		}
+	}
+
+	if (!found_plan) {
+		grid_ox_ = 0;
+		grid_oy_ = 0;
+		///update the boundary of costmap
+		outlineMap(char_map, nx, ny, NS_CostMap::LETHAL_OBSTACLE);
+		planOnGrid(char_map, nx, ny, start_x, start_y, goal_x, goal_y, goal_x_i,
+				goal_y_i, goal, plan, true);
+	}
+
+	simplifyPlan(plan);
+	// add orientations if needed
+	orientation_filter_->processPath(start, plan);
+	FILE * file;
+	file = fopen("/tmp/plan.log", "w");
+	if (!plan.empty()) {
+		for (size_t i = 0; i < plan.size(); i++) {
+//        console.debug("[%d] x = %lf, y = %lf", (i + 1), plan[i].pose.position.x,
+//                      plan[i].pose.position.y);
+			printf("%lf,%lf,\n", plan[i].x(),
+					plan[i].y());
+			double map_x, map_y;
+			worldToMap(plan[i].x(), plan[i].y(), map_x,
+					map_y);
+			fprintf(file, "%lf %lf\n", map_x, map_y);
+		}
+	}
+	fclose(file);
+	return !plan.empty(); // plan 非空即制订了 plan，返回 true
+}
+
+/*
+ * 在 costs 表示的网格上（planner window 或整张地图）扩展 potential 并提取路径，
+ * start 和 goal 是整张地图的坐标，网格原点在 grid_ox_, grid_oy_
+ */
+bool GlobalPlanner::planOnGrid(unsigned char* costs, int nx, int ny,
+		double start_x, double start_y, double goal_x, double goal_y,
+		unsigned int goal_x_i, unsigned int goal_y_i, const Pose2D& goal,
+		std::vector<Pose2D>& plan, bool use_tolerance) {
+	//make sure to resize the underlying array that Navfn uses
+	setGridSize(nx, ny);
+
+	start_x -= grid_ox_;
+	start_y -= grid_oy_;
+	goal_x -= grid_ox_;
+	goal_y -= grid_oy_;
+	goal_x_i -= grid_ox_;
+	goal_y_i -= grid_oy_;
+
+	/*
+	 * jps 只在找到的路径上写 potential，终点不可达时由它自己在 default_tolerance_
+	 * 范围内展开每个格子，并画出到最近可达格子的路径，不用再泛洪一次
+	 */
+	if (jump_point_ != NULL) {
+		double resolution =
+		costmap->getLayeredCostmap()->getCostmap()->getResolution();
+		jump_point_->setGoalTolerance(
+				use_tolerance ? (int) (default_tolerance_ / resolution) : 0);
+	}
 
-//	FILE* map_file = fopen("/tmp/before_costmap.log", "w+");
-//	int index = 0;
-//	for (unsigned int i = 0; i < ny; ++i) {
-//		for (unsigned int j = 0; j < nx; ++j) {
-//			fprintf(map_file, "%d %d %d\n",j,i, char_map[index] );
-//			++index;
-//		}
-//
-//	}
-//	fclose(map_file);
 	/*
 	 * 此处开始调用算法
 	 */
-	bool found_legal = planner_->calculatePotentials(
-			costmap->getLayeredCostmap()->getCostmap()->getCharMap(), start_x,
-			start_y, goal_x, goal_y, nx * ny * 2, potential_array_);
-
-
-//	FILE* after_map_file = fopen("/tmp/after_costmap.log", "w+");
-//		index = 0;
-//		for (unsigned int i = 0; i < ny; ++i) {
-//			for (unsigned int j = 0; j < nx; ++j) {
-//				fprintf(after_map_file, "%d %d %d\n",j,i, char_map[index] );
-//				++index;
-//			}
-//
-//		}
-//		fclose(after_map_file);
+	clock_t begin = clock();
+	bool found_legal = planner_->calculatePotentials(costs, start_x, start_y,
+			goal_x, goal_y, nx * ny * 2, potential_array_);
+	double expand_ms = (double) (clock() - begin) * 1000 / CLOCKS_PER_SEC;
+	logInfo<< "expanded "<<planner_->getCellsVisited()<<" cells in "
+	<<expand_ms<<" ms";
+	if (planner_->getCellsVisited() > 0) {
+		double ms = expand_ms / planner_->getCellsVisited();
+		ms_per_cell_ = ms_per_cell_ > 0 ? 0.9 * ms_per_cell_ + 0.1 * ms : ms;
+	}
+
+	if (use_tolerance && !benchmark_expanders_.empty()) {
+		benchmarkExpanders(costs, nx, ny, start_x, start_y, goal_x, goal_y);
+	}
 
 	///计算终点周围方圆2个像素的点的potential值，防止值为POT_HIGH
-	planner_->clearEndpoint(
-			costmap->getLayeredCostmap()->getCostmap()->getCharMap(),
-			potential_array_, goal_x_i, goal_y_i, 2);
+	if (compact_ != NULL) {
+		compact_->clearEndpoint(costs, goal_x_i, goal_y_i, 2);
+	} else {
+		planner_->clearEndpoint(costs, potential_array_, goal_x_i, goal_y_i, 2);
+	}
+
+	Pose2D goal_copy = goal;
+	/*
+	 * 终点不可达时扩展已经跑完了整个可达区域，
+	 * 直接在这份 potential 里找 default_tolerance_ 内最近的可达格子
+	 */
+	if (!found_legal && use_tolerance && default_tolerance_ > 0
+			&& !planner_->isCancelRequested()
+			&& nearestReachableGoal(nx, ny, goal_x_i, goal_y_i)) {
+		goal_x = goal_x_i;
+		goal_y = goal_y_i;
+		double world_x, world_y;
+		mapToWorld(goal_x + grid_ox_, goal_y + grid_oy_, world_x, world_y);
+		goal_copy = Pose2D(world_x, world_y, goal.theta());
+		found_legal = true;
+	}
+
+	last_plan_cost_ = gridPotential(goal_x_i + goal_y_i * nx);
 
 	if (found_legal) {
 		//extract the plan
@@ -253,8 +455,6 @@ bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
 			//make sure the goal we push on has the same timestamp as the rest of the plan
 			//geometry_msgs::PoseStamped goal_copy = goal;
 
-			Pose2D goal_copy = goal;
-
 //			goal_copy.header.stamp = NS_NaviCommon::Time::now();
 			plan.push_back(goal_copy);
 		} else {
@@ -266,26 +466,488 @@ bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
 		// 错误提示
 		printf("Failed to get a plan.\n");
 	}
+	return !plan.empty();
+}
 
-	// add orientations if needed
-	orientation_filter_->processPath(start, plan);
-	FILE * file;
-	file = fopen("/tmp/plan.log", "w");
-	if (!plan.empty()) {
-		for (size_t i = 0; i < plan.size(); i++) {
-//        console.debug("[%d] x = %lf, y = %lf", (i + 1), plan[i].pose.position.x,
-//                      plan[i].pose.position.y);
-			printf("%lf,%lf,\n", plan[i].x(),
-					plan[i].y());
-			double map_x, map_y;
-			worldToMap(plan[i].x(), plan[i].y(), map_x,
-					map_y);
-			fprintf(file, "%lf %lf\n", map_x, map_y);
+/*
+ * 同一个查询交给每个 expander 跑一遍，结果写到临时数组，不影响本次规划
+ */
+void GlobalPlanner::benchmarkExpanders(unsigned char* costs, int nx, int ny,
+		double start_x, double start_y, double goal_x, double goal_y) {
+	float* scratch = new float[nx * ny];
+	for (size_t i = 0; i < benchmark_expanders_.size(); i++) {
+		Expander* expander = benchmark_expanders_[i];
+		expander->setSize(nx, ny);
+		clock_t begin = clock();
+		bool found = expander->calculatePotentials(costs, start_x, start_y,
+				goal_x, goal_y, nx * ny * 2, scratch);
+		logInfo<< "expander benchmark "<<benchmark_names_[i]<<" : found = "<<found
+		<<" , expansions = "<<expander->getCellsVisited()<<" , time = "
+		<<(double) (clock() - begin) * 1000 / CLOCKS_PER_SEC<<" ms , goal potential = "
+		<<scratch[(int) goal_x + (int) goal_y * nx];
+	}
+	delete[] scratch;
+}
+
+/*
+ * 在 goal 周围 default_tolerance_ 范围内找离 goal 最近（同距离取 potential 小）的
+ * 可达格子，只扫一遍这个范围，不重新扩展
+ */
+bool GlobalPlanner::nearestReachableGoal(int nx, int ny,
+		unsigned int& goal_x_i, unsigned int& goal_y_i) {
+	++tolerance_triggered_;
+
+	int r = default_tolerance_
+			/ costmap->getLayeredCostmap()->getCostmap()->getResolution();
+	int r2 = r * r;
+	int best_x = -1, best_y = -1, best_d2 = r2;
+	float best_pot = POT_HIGH;
+	for (int dy = -r; dy <= r; dy++) {
+		int y = (int) goal_y_i + dy;
+		// keep off the sentinel border
+		if (y < 1 || y >= ny - 1)
+			continue;
+		for (int dx = -r; dx <= r; dx++) {
+			int x = (int) goal_x_i + dx;
+			int d2 = dx * dx + dy * dy;
+			if (x < 1 || x >= nx - 1 || d2 > best_d2)
+				continue;
+			float pot = gridPotential(x + y * nx);
+			if (pot >= POT_HIGH)
+				continue;
+			if (d2 < best_d2 || pot < best_pot) {
+				best_d2 = d2;
+				best_pot = pot;
+				best_x = x;
+				best_y = y;
+			}
 		}
 	}
-	fclose(file);
-	delete potential_array_;
-	return !plan.empty(); // plan 非空即制订了 plan，返回 true
+
+	if (best_x < 0) {
+		logInfo<< "no reachable cell within default tolerance "<<default_tolerance_
+		<<" , tolerance used "<<tolerance_resolved_<<" / "<<tolerance_triggered_;
+		return false;
+	}
+	++tolerance_resolved_;
+	logInfo<< "goal unreachable , use cell "<<best_x<<" , "<<best_y
+	<<" within default tolerance , tolerance used "<<tolerance_resolved_
+	<<" / "<<tolerance_triggered_;
+	goal_x_i = best_x;
+	goal_y_i = best_y;
+	return true;
+}
+
+/*
+ * 起点周围 1 格和终点周围 clearEndpoint 及 default_tolerance_ 范围内没有
+ * 同一个连通区域的格子时，扩展注定失败，直接拒绝
+ */
+bool GlobalPlanner::goalConnected(unsigned int start_x, unsigned int start_y,
+		unsigned int goal_x, unsigned int goal_y) {
+	clock_t begin = clock();
+	components_->update(costmap->getLayeredCostmap());
+	int tolerance = default_tolerance_
+			/ costmap->getLayeredCostmap()->getCostmap()->getResolution();
+	int reachable;
+	bool connected = components_->connected(start_x, start_y, 1, goal_x,
+			goal_y, std::max(2, tolerance), &reachable);
+	double ms = (double) (clock() - begin) * 1000 / CLOCKS_PER_SEC;
+
+	// nothing free around the robot, leave it to the expander
+	if (connected || reachable == 0) {
+		logInfo<< "free space components: "<<components_->getComponents()
+		<<" , relabeled "<<components_->getRelabeledTiles()<<" tiles in "<<ms<<" ms";
+		return true;
+	}
+	++unreachable_rejected_;
+	// a failed expansion floods every cell connected to the robot
+	unreachable_saved_ms_ += std::max(0.0, reachable * ms_per_cell_ - ms);
+	logInfo<< "goal is not connected to the robot , rejected "<<unreachable_rejected_
+	<<" goals , saved about "<<unreachable_saved_ms_<<" ms of expansion";
+	return false;
+}
+
+/*
+ * 以起点和终点的中点为中心放置 planner window，
+ * 两点离窗口边界都足够远才使用窗口，否则用整张地图
+ */
+bool GlobalPlanner::fitPlannerWindow(unsigned int start_x,
+		unsigned int start_y, unsigned int goal_x, unsigned int goal_y, int nx,
+		int ny) {
+	if (planner_window_x_ <= 0 || planner_window_y_ <= 0)
+		return false;
+
+	double resolution =
+			costmap->getLayeredCostmap()->getCostmap()->getResolution();
+	int window_nx = planner_window_x_ / resolution;
+	int window_ny = planner_window_y_ / resolution;
+	if (window_nx >= nx || window_ny >= ny)
+		return false;
+
+	if (window_costs_ == NULL || window_nx != window_nx_
+			|| window_ny != window_ny_) {
+		if (window_costs_)
+			delete[] window_costs_;
+		window_costs_ = new unsigned char[window_nx * window_ny];
+		window_nx_ = window_nx;
+		window_ny_ = window_ny;
+	}
+
+	// sentinel border plus the cells touched by precise start and clearEndpoint
+	const int margin = 3;
+	int ox = ((int) start_x + (int) goal_x) / 2 - window_nx_ / 2;
+	int oy = ((int) start_y + (int) goal_y) / 2 - window_ny_ / 2;
+	ox = std::max(0, std::min(ox, nx - window_nx_));
+	oy = std::max(0, std::min(oy, ny - window_ny_));
+
+	if ((int) start_x < ox + margin || (int) start_x >= ox + window_nx_ - margin
+			|| (int) goal_x < ox + margin
+			|| (int) goal_x >= ox + window_nx_ - margin
+			|| (int) start_y < oy + margin
+			|| (int) start_y >= oy + window_ny_ - margin
+			|| (int) goal_y < oy + margin
+			|| (int) goal_y >= oy + window_ny_ - margin)
+		return false;
+
+	grid_ox_ = ox;
+	grid_oy_ = oy;
+	return true;
+}
+
+/*
+ * 不加锁，makePlan 持有 mutex_ 期间也要能打断它
+ */
+void GlobalPlanner::cancelPlan() {
+	if (initialized_) {
+		planner_->requestCancel();
+	}
+}
+
+/*
+ * 沿上一条路径先在窄走廊内重新规划，失败后逐级加宽，都失败才搜索整张地图；
+ * 起点不是机器人位置时（clear_start 为 false）不能清除代价地图中的起点格子
+ */
+bool GlobalPlanner::makePlanInCorridor(const Pose2D& start, const Pose2D& goal,
+		const std::vector<Pose2D>& previous_plan, std::vector<Pose2D>& plan,
+		int& tier, bool clear_start) {
+	tier = -1;
+	if (initialized_ && corridor_tiers_ > 0 && corridor_width_ > 0
+			&& previous_plan.size() >= 2) {
+		boost::mutex::scoped_lock lock(mutex_);
+		plan.clear();
+		planner_->clearCancel();
+
+		NS_CostMap::Costmap2D* cm = costmap->getLayeredCostmap()->getCostmap();
+		int nx = cm->getSizeInCellsX(), ny = cm->getSizeInCellsY();
+
+		unsigned int start_x_i, start_y_i, goal_x_i, goal_y_i;
+		double start_x, start_y, goal_x, goal_y;
+		if (cm->worldToMap(start.x(), start.y(), start_x_i, start_y_i)
+				&& cm->worldToMap(goal.x(), goal.y(), goal_x_i, goal_y_i)
+				&& worldToMap(start.x(), start.y(), start_x, start_y)
+				&& worldToMap(goal.x(), goal.y(), goal_x, goal_y)) {
+			if (clear_start)
+				clearRobotCell(start_x_i, start_y_i);
+
+			int width = std::max(1, (int) (corridor_width_ / cm->getResolution()));
+			for (int t = 0;
+					t < corridor_tiers_ && !planner_->isCancelRequested();
+					++t, width *= 2) {
+				if (!fillCorridor(previous_plan, start_x_i, start_y_i, goal_x_i,
+						goal_y_i, width, nx, ny))
+					break;
+				if (planOnGrid(corridor_costs_, corridor_nx_, corridor_ny_,
+						start_x, start_y, goal_x, goal_y, goal_x_i, goal_y_i, goal,
+						plan, false)) {
+					tier = t;
+					logInfo<< "corridor replan succeeded at tier "<<t<<" , width "
+					<<width<<" cells , grid "<<corridor_nx_<<" x "<<corridor_ny_;
+					simplifyPlan(plan);
+					orientation_filter_->processPath(start, plan);
+					return true;
+				}
+			}
+		}
+		if (planner_->isCancelRequested()) {
+			logInfo<< "corridor replan cancelled";
+			return false;
+		}
+		logInfo<< "corridor replan failed at every tier , search the full map";
+	}
+	return planFrom(start, goal, plan, clear_start);
+}
+
+/*
+ * 在上一条路径、起点和终点的包围盒内，只保留距路径点 width 个格子以内的代价，
+ * 其余格子设为 LETHAL_OBSTACLE
+ */
+bool GlobalPlanner::fillCorridor(const std::vector<Pose2D>& previous_plan,
+		unsigned int start_x, unsigned int start_y, unsigned int goal_x,
+		unsigned int goal_y, int width, int nx, int ny) {
+	NS_CostMap::Costmap2D* cm = costmap->getLayeredCostmap()->getCostmap();
+	unsigned char* char_map = cm->getCharMap();
+
+	std::vector<std::pair<unsigned int, unsigned int> > cells;
+	cells.push_back(std::make_pair(start_x, start_y));
+	for (size_t i = 0; i < previous_plan.size(); i++) {
+		unsigned int mx, my;
+		if (!cm->worldToMap(previous_plan[i].x(), previous_plan[i].y(), mx, my))
+			continue;
+		if (mx == cells.back().first && my == cells.back().second)
+			continue;
+		cells.push_back(std::make_pair(mx, my));
+	}
+	cells.push_back(std::make_pair(goal_x, goal_y));
+
+	// sentinel border plus the cells touched by precise start and clearEndpoint
+	const int margin = 3;
+	int x0 = nx, y0 = ny, xn = 0, yn = 0;
+	for (size_t i = 0; i < cells.size(); i++) {
+		x0 = std::min(x0, (int) cells[i].first);
+		y0 = std::min(y0, (int) cells[i].second);
+		xn = std::max(xn, (int) cells[i].first);
+		yn = std::max(yn, (int) cells[i].second);
+	}
+	x0 = std::max(0, x0 - width - margin);
+	y0 = std::max(0, y0 - width - margin);
+	xn = std::min(nx - 1, xn + width + margin);
+	yn = std::min(ny - 1, yn + width + margin);
+
+	corridor_nx_ = xn - x0 + 1;
+	corridor_ny_ = yn - y0 + 1;
+	if (corridor_nx_ >= nx && corridor_ny_ >= ny)
+		return false;   // as big as the map, nothing to gain
+
+	if (corridor_capacity_ < corridor_nx_ * corridor_ny_) {
+		if (corridor_costs_)
+			delete[] corridor_costs_;
+		corridor_capacity_ = corridor_nx_ * corridor_ny_;
+		corridor_costs_ = new unsigned char[corridor_capacity_];
+	}
+	memset(corridor_costs_, NS_CostMap::LETHAL_OBSTACLE,
+			corridor_nx_ * corridor_ny_);
+
+	int w2 = width * width;
+	for (size_t i = 0; i < cells.size(); i++) {
+		int cx = cells[i].first, cy = cells[i].second;
+		for (int dy = -width; dy <= width; dy++) {
+			int y = cy + dy;
+			if (y < y0 || y > yn)
+				continue;
+			for (int dx = -width; dx <= width; dx++) {
+				int x = cx + dx;
+				if (x < x0 || x > xn || dx * dx + dy * dy > w2)
+					continue;
+				corridor_costs_[(x - x0) + (y - y0) * corridor_nx_] = char_map[x
+						+ y * nx];
+			}
+		}
+	}
+	outlineMap(corridor_costs_, corridor_nx_, corridor_ny_,
+			NS_CostMap::LETHAL_OBSTACLE);
+
+	grid_ox_ = x0;
+	grid_oy_ = y0;
+	return true;
+}
+
+/*
+ * 只有网格尺寸变化时才重新分配 expander、traceback 和 potential 数组
+ */
+void GlobalPlanner::setGridSize(int nx, int ny) {
+	if (nx == grid_nx_ && ny == grid_ny_)
+		return;
+	// the buffers only grow, windowed and full map plans alternate
+	p_calc_->setSize(nx, ny);
+	planner_->setSize(nx, ny);
+	path_maker_->setSize(nx, ny);
+	// the fixed point expander keeps its own potential
+	if (!compact_ && nx * ny > grid_capacity_) {
+		if (potential_array_)
+			delete[] potential_array_;
+		potential_array_ = new float[nx * ny];
+		grid_capacity_ = nx * ny;
+	}
+	grid_nx_ = nx;
+	grid_ny_ = ny;
+}
+
+/*
+ * 当前网格上 cell n 的 potential，定点模式下换算回 float
+ */
+float GlobalPlanner::gridPotential(int n) {
+	return compact_ ? compact_->potentialAt(n) : potential_array_[n];
+}
+
+bool GlobalPlanner::makePlan(const Pose2D& start, const Pose2D& goal,
+		std::vector<Pose2D>& plan, double& cost) {
+	bool found = makePlan(start, goal, plan);
+	// potential of the goal cell, the same units the expander accumulates
+	cost = found ? last_plan_cost_ : 0;
+	return found;
+}
+
+/*
+ * 从 start 出发不设终点地扩展一次 potential，保留结果供多个候选点查询
+ */
+bool GlobalPlanner::computeCostField(const Pose2D& start) {
+	boost::mutex::scoped_lock lock(mutex_);
+	if (!initialized_) {
+		printf(
+				"This planner has not been initialized yet, but it is being used, please call initialize() before use\n");
+		return false;
+	}
+	field_valid_ = false;
+
+	int nx = costmap->getLayeredCostmap()->getCostmap()->getSizeInCellsX(), ny =
+	costmap->getLayeredCostmap()->getCostmap()->getSizeInCellsY();
+
+	unsigned int start_x_i, start_y_i;
+	double start_x, start_y;
+	if (!costmap->getLayeredCostmap()->getCostmap()->worldToMap(start.x(),
+					start.y(), start_x_i, start_y_i)
+			|| !worldToMap(start.x(), start.y(), start_x, start_y)) {
+		printf(
+				"The cost field start position is off the global costmap.\n");
+		return false;
+	}
+
+	clearRobotCell(start_x_i, start_y_i);
+
+	if (field_potential_ == NULL || field_nx_ != nx || field_ny_ != ny) {
+		if (field_potential_)
+			delete[] field_potential_;
+		field_potential_ = new float[nx * ny];
+		field_nx_ = nx;
+		field_ny_ = ny;
+	}
+	setGridSize(nx, ny);
+	grid_ox_ = 0;
+	grid_oy_ = 0;
+
+	outlineMap(costmap->getLayeredCostmap()->getCostmap()->getCharMap(), nx, ny,
+			NS_CostMap::LETHAL_OBSTACLE);
+
+	clock_t begin = clock();
+	if (!fieldExpander(nx, ny)->calculatePotentials(
+					costmap->getLayeredCostmap()->getCostmap()->getCharMap(),
+					start_x, start_y, -1, -1, nx * ny * 2, field_potential_)) {
+		printf("Failed to flood the cost field.\n");
+		return false;
+	}
+	logInfo<< "cost field computed in "
+	<< (double) (clock() - begin) / CLOCKS_PER_SEC << " s";
+
+	field_start_ = start;
+	field_start_x_ = start_x;
+	field_start_y_ = start_y;
+	field_valid_ = true;
+	return true;
+}
+
+/*
+ * 只有代价场用 field_expander_，第一次用到时才创建，
+ * compact_potential 等模式平时不为它分配整张地图的缓冲区
+ */
+DijkstraExpansion* GlobalPlanner::fieldExpander(int nx, int ny) {
+	if (field_expander_ == NULL) {
+		field_expander_ = new DijkstraExpansion(p_calc_, nx, ny);
+		field_expander_->setPreciseStart(true);
+		field_expander_->setHasUnknown(allow_unknown_);
+		field_expander_->setLethalCost(lethal_cost_);
+		field_expander_->setNeutralCost(neutral_cost_);
+		field_expander_->setFactor(cost_factor_);
+	}
+	// planner_ is sized by setGridSize, a separate one follows the map size
+	if (field_expander_ != planner_)
+		field_expander_->setSize(nx, ny);
+	return field_expander_;
+}
+
+bool GlobalPlanner::getFieldCost(unsigned int mx, unsigned int my,
+		float& cost) {
+	boost::mutex::scoped_lock lock(mutex_);
+	if (!field_valid_ || mx >= (unsigned int) field_nx_
+			|| my >= (unsigned int) field_ny_)
+		return false;
+	cost = field_potential_[mx + my * field_nx_];
+	return cost < POT_HIGH;
+}
+
+bool GlobalPlanner::getFieldCosts(std::vector<float>& costs) {
+	boost::mutex::scoped_lock lock(mutex_);
+	if (!field_valid_)
+		return false;
+	costs.resize(field_nx_ * field_ny_);
+	for (size_t i = 0; i < costs.size(); ++i)
+		costs[i] = field_potential_[i] < POT_HIGH ? field_potential_[i] : -1.f;
+	return true;
+}
+
+bool GlobalPlanner::getPlanFromField(const Pose2D& goal,
+		std::vector<Pose2D>& plan) {
+	boost::mutex::scoped_lock lock(mutex_);
+	plan.clear();
+	if (!field_valid_) {
+		printf("No cost field to extract a plan from.\n");
+		return false;
+	}
+
+	double goal_x, goal_y;
+	if (!worldToMap(goal.x(), goal.y(), goal_x, goal_y)) {
+		printf("The goal is off the cost field.\n");
+		return false;
+	}
+	if (field_potential_[(int) goal_x + (int) goal_y * field_nx_] >= POT_HIGH) {
+		printf("The goal is not reachable in the cost field.\n");
+		return false;
+	}
+
+	setGridSize(field_nx_, field_ny_);
+	if (!extractPlan(field_potential_, 0, 0, field_start_x_, field_start_y_,
+			goal_x, goal_y, plan)) {
+		return false;
+	}
+	plan.push_back(goal);
+	simplifyPlan(plan);
+	orientation_filter_->processPath(field_start_, plan);
+	return true;
+}
+
+bool GlobalPlanner::getCostWeights(float& neutral_cost, float& cost_factor) {
+	neutral_cost = neutral_cost_;
+	cost_factor = cost_factor_;
+	return true;
+}
+
+/*
+ * traceback 每半个格子一个点，在 orientation filter 之前做视线拉直、
+ * Douglas-Peucker 简化并按 plan_resample_step 重新采样，终点的朝向保持不变
+ */
+void GlobalPlanner::simplifyPlan(std::vector<Pose2D>& plan) {
+	if (path_simplifier_ == NULL || plan.size() < 3) {
+		return;
+	}
+	NS_CostMap::Costmap2D* cm = costmap->getLayeredCostmap()->getCostmap();
+
+	std::vector<std::pair<double, double> > points(plan.size());
+	for (size_t i = 0; i < plan.size(); i++) {
+		worldToMap(plan[i].x(), plan[i].y(), points[i].first,
+				points[i].second);
+	}
+	path_simplifier_->simplify(cm->getCharMap(), cm->getSizeInCellsX(),
+			cm->getSizeInCellsY(), points);
+
+	Pose2D goal = plan.back();
+	size_t dense = plan.size();
+	plan.clear();
+	for (size_t i = 0; i + 1 < points.size(); i++) {
+		double world_x, world_y;
+		mapToWorld(points[i].first, points[i].second, world_x, world_y);
+		plan.push_back(Pose2D(world_x, world_y, 0));
+	}
+	plan.push_back(goal);
+	logInfo<< "simplified plan from "<<dense<<" to "<<plan.size()<<" poses";
 }
 
 void GlobalPlanner::clearRobotCell(unsigned int mx, unsigned int my) {
@@ -310,24 +972,55 @@ bool GlobalPlanner::getPlanFromPotential(double start_x, double start_y,
 				"This planner has not been initialized yet, but it is being used, please call initialize() before use\n");
 		return false;
 	}
+	if (compact_ != NULL) {
+		plan.clear();
+		std::vector<std::pair<float, float> > path;
+		if (!compact_->getPath(path_maker_, start_x, start_y, goal_x, goal_y,
+				path)) {
+			printf("NO PATH!\n");
+			return false;
+		}
+		appendPath(path, grid_ox_, grid_oy_, plan);
+		return !plan.empty();
+	}
+	return extractPlan(potential_array_, grid_ox_, grid_oy_, start_x, start_y,
+			goal_x, goal_y, plan);
+}
+
+/*
+ * potential 所在网格的原点在整张地图的 (ox, oy)
+ */
+bool GlobalPlanner::extractPlan(float* potential, int ox, int oy,
+		double start_x, double start_y, double goal_x, double goal_y,
+		std::vector<Pose2D>& plan) {
 	//clear the plan, just in case
 	plan.clear();
 
 	std::vector<std::pair<float, float> > path;
 
-	if (!path_maker_->getPath(potential_array_, start_x, start_y, goal_x,
+	if (!path_maker_->getPath(potential, start_x, start_y, goal_x,
 			goal_y, path)) {
 		// 错误提示
 		printf("NO PATH!\n");
 		return false;
 	}
+	appendPath(path, ox, oy, plan);
+	return !plan.empty();
+}
+
+/*
+ * traceback 的结果从终点到起点，倒序转换成世界坐标加入 plan
+ */
+void GlobalPlanner::appendPath(
+		const std::vector<std::pair<float, float> >& path, int ox, int oy,
+		std::vector<Pose2D>& plan) {
 	logInfo<< "path maker get path size = "<<path.size();
 	NS_NaviCommon::Time plan_time = NS_NaviCommon::Time::now();
 	for (int i = path.size() - 1; i >= 0; i--) {
 		std::pair<float, float> point = path[i];
 		//convert the plan to world coordinates
 		double world_x, world_y;
-		mapToWorld(point.first, point.second, world_x, world_y);
+		mapToWorld(point.first + ox, point.second + oy, world_x, world_y);
 		logInfo<< point.first<<","<<point.second;
 
 //		pose.header.stamp = plan_time;
@@ -342,8 +1035,6 @@ bool GlobalPlanner::getPlanFromPotential(double start_x, double start_y,
 		Pose2D pose(world_x, world_y, 0.f);
 		plan.push_back(pose);
 	}
-
-	return !plan.empty();
 }
 
 void GlobalPlanner::mapToWorld(double mx, double my, double& wx, double& wy) {
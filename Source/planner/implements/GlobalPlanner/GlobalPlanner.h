@@ -6,8 +6,12 @@
 #include "Algorithm/PotentialCalculator.h"
 #include "Algorithm/Expander.h"
 #include "Algorithm/Dijkstra.h"
+#include "Algorithm/JumpPoint.h"
 #include "Algorithm/Traceback.h"
 #include "Algorithm/OrientationFilter.h"
+#include "Algorithm/PathSimplifier.h"
+#include "Algorithm/FixedPoint.h"
+#include "../../../costmap/costmap_2d/FreeSpaceComponents.h"
 
 namespace NS_Planner
 {
@@ -30,6 +34,43 @@ namespace NS_Planner
              const Pose2D& goal,
              std::vector< Pose2D >& plan);
 
+    bool
+    makePlan(const Pose2D& start,
+             const Pose2D& goal,
+             std::vector< Pose2D >& plan,
+             double& cost);
+
+    bool
+    makePlanFromPose(const Pose2D& start,
+                     const Pose2D& goal,
+                     std::vector< Pose2D >& plan);
+
+    void
+    cancelPlan();
+
+    bool
+    makePlanInCorridor(const Pose2D& start,
+                       const Pose2D& goal,
+                       const std::vector< Pose2D >& previous_plan,
+                       std::vector< Pose2D >& plan,
+                       int& tier,
+                       bool clear_start);
+
+    bool
+    computeCostField(const Pose2D& start);
+
+    bool
+    getFieldCost(unsigned int mx, unsigned int my, float& cost);
+
+    bool
+    getFieldCosts(std::vector< float >& costs);
+
+    bool
+    getPlanFromField(const Pose2D& goal, std::vector< Pose2D >& plan);
+
+    bool
+    getCostWeights(float& neutral_cost, float& cost_factor);
+
     bool
     getPlanFromPotential(double start_x, double start_y, double end_x,
                          double end_y, const Pose2D& goal,
@@ -46,6 +87,46 @@ namespace NS_Planner
     worldToMap(double wx, double wy, double& mx, double& my);
     void
     clearRobotCell(unsigned int mx, unsigned int my);
+    /// makePlan, the start cell is only cleared in the costmap if clear_start
+    bool
+    planFrom(const Pose2D& start, const Pose2D& goal,
+             std::vector< Pose2D >& plan, bool clear_start);
+    bool
+    extractPlan(float* potential, int ox, int oy, double start_x,
+                double start_y, double goal_x, double goal_y,
+                std::vector< Pose2D >& plan);
+    void
+    appendPath(const std::vector< std::pair< float, float > >& path, int ox,
+               int oy, std::vector< Pose2D >& plan);
+    float
+    gridPotential(int n);
+    bool
+    planOnGrid(unsigned char* costs, int nx, int ny, double start_x,
+               double start_y, double goal_x, double goal_y,
+               unsigned int goal_x_i, unsigned int goal_y_i,
+               const Pose2D& goal, std::vector< Pose2D >& plan,
+               bool use_tolerance);
+    bool
+    fitPlannerWindow(unsigned int start_x, unsigned int start_y,
+                     unsigned int goal_x, unsigned int goal_y, int nx, int ny);
+    void
+    setGridSize(int nx, int ny);
+    void
+    benchmarkExpanders(unsigned char* costs, int nx, int ny, double start_x,
+                       double start_y, double goal_x, double goal_y);
+    bool
+    nearestReachableGoal(int nx, int ny, unsigned int& goal_x_i,
+                         unsigned int& goal_y_i);
+    void
+    simplifyPlan(std::vector< Pose2D >& plan);
+    bool
+    goalConnected(unsigned int start_x, unsigned int start_y,
+                  unsigned int goal_x, unsigned int goal_y);
+    bool
+    fillCorridor(const std::vector< Pose2D >& previous_plan,
+                 unsigned int start_x, unsigned int start_y,
+                 unsigned int goal_x, unsigned int goal_y, int width, int nx,
+                 int ny);
 
     double planner_window_x_, planner_window_y_, default_tolerance_;
 
@@ -56,6 +137,8 @@ namespace NS_Planner
 //    DijkstraExpansion* planner_;
     Traceback* path_maker_;
     OrientationFilter* orientation_filter_;
+    /// shortcut, simplify and resample the traceback output, NULL if off
+    PathSimplifier* path_simplifier_;
     bool publish_potential_;
     int publish_scale_;
 
@@ -63,8 +146,58 @@ namespace NS_Planner
     outlineMap(unsigned char* costarr, int nx, int ny, unsigned char value);
     unsigned char* cost_array_;
     float* potential_array_;
+    /// compact_potential: fixed point planner_, potential_array_ stays NULL
+    FixedPointExpander* compact_;
+    /// planner_ when it is jps, only writes potentials along the path it finds
+    JumpPointExpansion* jump_point_;
     unsigned int start_x_, start_y_, end_x_, end_y_;
 
+    /// size and origin (in full map cells) of the grid potential_array_ covers
+    int grid_nx_, grid_ny_, grid_ox_, grid_oy_;
+    /// cells potential_array_ holds, kept at the largest grid so far
+    int grid_capacity_;
+    /// costs copied out of the planner window
+    unsigned char* window_costs_;
+    int window_nx_, window_ny_;
+
+    /// corridor around the previous plan, base width in metres doubled per tier
+    float corridor_width_;
+    int corridor_tiers_;
+    unsigned char* corridor_costs_;
+    int corridor_capacity_, corridor_nx_, corridor_ny_;
+
+    /// potential of the goal cell from the last makePlan
+    float last_plan_cost_;
+
+    /// expander_benchmark: the same query is timed on each of these
+    std::vector< Expander* > benchmark_expanders_;
+    std::vector< std::string > benchmark_names_;
+
+    /// how often the goal was unreachable and default_tolerance_ was tried / helped
+    int tolerance_triggered_, tolerance_resolved_;
+
+    /// free space components, goals outside the robot's one are rejected
+    /// before any expansion, NULL if reject_unreachable is off
+    NS_CostMap::FreeSpaceComponents* components_;
+    int unreachable_rejected_;
+    /// estimated from the cells a failed flood would have expanded
+    double unreachable_saved_ms_;
+    /// running average of the expansion time per cell
+    double ms_per_cell_;
+
+    /// cost-to-go field, flooded from field_start_ without a target
+    DijkstraExpansion*
+    fieldExpander(int nx, int ny);
+    /// created on first use unless planner_ is dijkstra itself
+    DijkstraExpansion* field_expander_;
+    int lethal_cost_, neutral_cost_;
+    double cost_factor_;
+    float* field_potential_;
+    int field_nx_, field_ny_;
+    bool field_valid_;
+    Pose2D field_start_;
+    double field_start_x_, field_start_y_;
+
     float convert_offset_;
   };
 
@@ -0,0 +1,460 @@
+/*
+ * LatticePlanner.cpp
+ *
+ *  Search over (x, y, heading bin) with precomputed motion primitives.
+ */
+
+#include "LatticePlanner.h"
+#include "../../../costmap/costmap_2d/CostValues.h"
+#include <Parameter/Parameter.h>
+#include <Console/Console.h>
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <algorithm>
+
+#define POT_HIGH 1.0e10        // unassigned cell potential
+
+namespace NS_Planner {
+
+LatticePlanner::LatticePlanner() :
+		initialized_(false), allow_unknown_(true), cancel_requested_(false), num_angles_(
+				0), lethal_cost_(253), neutral_cost_(66), cost_factor_(0.55), heuristic_weight_(
+				1), max_expansions_(0), nx_(0), goal_x_(0), goal_y_(0), goal_angle_(
+				0), free_start_(-1), distance_costs_(NULL), distance_(NULL), distance_nx_(
+				0), distance_ny_(0), distance_goal_(-1), distance_start_(-1), distance_stamp_(
+				0), distance_stamped_(false), distance_settled_(
+				0), distance_reused_(0), free_radius_(0), last_plan_cost_(0), components_(NULL), unreachable_rejected_(
+				0) {
+}
+
+LatticePlanner::~LatticePlanner() {
+	if (distance_)
+		delete[] distance_;
+	if (components_)
+		delete components_;
+}
+
+void LatticePlanner::onInitialize() {
+	if (initialized_) {
+		printf("onInitialize has been called before\n");
+		return;
+	}
+	NS_NaviCommon::Parameter parameter;
+	parameter.loadConfigurationFile("lattice_planner.xml");
+
+	allow_unknown_ = parameter.getParameter("allow_unknown", 1) == 1;
+	lethal_cost_ = parameter.getParameter("lethal_cost", 253);
+	neutral_cost_ = parameter.getParameter("neutral_cost", 66);
+	cost_factor_ = parameter.getParameter("cost_factor", 0.55f);
+	//> 1 trades optimality for fewer expansions
+	heuristic_weight_ = parameter.getParameter("heuristic_weight", 1.2f);
+	max_expansions_ = parameter.getParameter("max_expansions", 200000);
+
+	/*
+	 * 从 primitive_file 读取 motion primitives（sbpl 的 .mprim 格式），
+	 * 没有配置或与 costmap 分辨率不符时使用内置的差速底盘 primitives
+	 */
+	double resolution =
+			costmap->getLayeredCostmap()->getCostmap()->getResolution();
+	std::string file = parameter.getParameter("primitive_file",
+			std::string(""));
+	if (file.empty() || !primitives_.load(file, resolution)) {
+		primitives_.generateDefault(parameter.getParameter("num_angles", 16),
+				parameter.getParameter("turn_in_place_cost", 5.0f));
+		logInfo<< "lattice planner uses the default primitives";
+	}
+	num_angles_ = primitives_.getNumAngles();
+
+	computeFreeSpaceTable(parameter.getParameter("free_heuristic_radius", 12));
+
+	if (parameter.getParameter("reject_unreachable", 1) == 1) {
+		components_ = new NS_CostMap::FreeSpaceComponents();
+		components_->setThreshold(lethal_cost_, allow_unknown_);
+	}
+
+	int count = 0;
+	for (int a = 0; a < num_angles_; a++)
+		count += primitives_.forAngle(a).size();
+	logInfo << "lattice planner , " << num_angles_ << " angles , " << count
+	<< " primitives , free space table radius " << free_radius_;
+
+	initialized_ = true;
+}
+
+float LatticePlanner::cellWeight(unsigned char cost) {
+	if (cost >= lethal_cost_
+			&& !(allow_unknown_ && cost == NS_CostMap::NO_INFORMATION))
+		return -1;
+	return neutral_cost_ + cost_factor_ * cost;
+}
+
+float LatticePlanner::primitiveCost(const unsigned char* costs, int nx, int ny,
+		int x, int y, const MotionPrimitive& p) {
+	// turning in place, the robot cell itself is not checked
+	if (p.cells.empty()) {
+		float w = cellWeight(costs[y * nx + x]);
+		return (w < 0 ? neutral_cost_ : w) * p.cost_mult;
+	}
+
+	float sum = 0;
+	for (size_t i = 0; i < p.cells.size(); i++) {
+		int cx = x + p.cells[i].first, cy = y + p.cells[i].second;
+		if (cx < 0 || cx >= nx || cy < 0 || cy >= ny)
+			return -1;
+		int n = cy * nx + cx;
+		float w = n == free_start_ ? neutral_cost_ : cellWeight(costs[n]);
+		if (w < 0)
+			return -1;
+		sum += w;
+	}
+	return sum * p.length / p.cells.size() * p.cost_mult;
+}
+
+/*
+ * 以 goal 为源的 2d dijkstra，按需扩展：只扩展到查询的格子确定为止。
+ * goal、当作空闲的起点和 costmap 的脏区块序号都没变时保留上一次的结果
+ */
+void LatticePlanner::prepareDistanceField(const unsigned char* costs, int nx,
+		int ny, int goal_x, int goal_y) {
+	unsigned int stamp = 0;
+	bool stamped = costmapStamp(nx, ny, stamp);
+
+	int goal = goal_y * nx + goal_x;
+	distance_costs_ = costs;
+	if (distance_ && distance_stamped_ && stamped && distance_nx_ == nx
+			&& distance_ny_ == ny && distance_goal_ == goal
+			&& distance_start_ == free_start_ && distance_stamp_ == stamp) {
+		distance_reused_++;
+		return;
+	}
+
+	if (!distance_ || distance_nx_ != nx || distance_ny_ != ny) {
+		if (distance_)
+			delete[] distance_;
+		distance_ = new float[nx * ny];
+		distance_nx_ = nx;
+		distance_ny_ = ny;
+	}
+	std::fill(distance_, distance_ + nx * ny, (float) POT_HIGH);
+	distance_goal_ = goal;
+	distance_start_ = free_start_;
+	distance_stamp_ = stamp;
+	distance_stamped_ = stamped;
+	distance_settled_ = 0;
+	distance_open_.clear();
+	distance_[goal] = 0;
+	distance_open_.push_back(Entry(goal, 0, 0));
+}
+
+bool LatticePlanner::costmapStamp(int nx, int ny, unsigned int& stamp) {
+	NS_CostMap::LayeredCostmap* layered = costmap->getLayeredCostmap();
+	unsigned int tile = NS_CostMap::LayeredCostmap::DIRTY_TILE_SIZE;
+	unsigned int tiles_x = layered->getTilesX(), tiles_y = layered->getTilesY();
+	//stamps of another size (not resized through the layered costmap yet)
+	if (tiles_x != (nx + tile - 1) / tile || tiles_y != (ny + tile - 1) / tile)
+		return false;
+
+	stamp = 0;
+	for (unsigned int ty = 0; ty < tiles_y; ty++)
+		for (unsigned int tx = 0; tx < tiles_x; tx++)
+			stamp = std::max(stamp, layered->getTileStamp(tx, ty));
+	return true;
+}
+
+float LatticePlanner::distanceTo(int n) {
+	// a tentative value is final once no open entry is below it
+	while (!distance_open_.empty() && distance_open_[0].f < distance_[n]) {
+		Entry top = distance_open_[0];
+		std::pop_heap(distance_open_.begin(), distance_open_.end(),
+				greaterEntry());
+		distance_open_.pop_back();
+		if (top.f != distance_[top.state])
+			continue;
+		distance_settled_++;
+
+		// moving from a neighbour into top costs the weight of top
+		float w = cellWeight(distance_costs_[top.state]);
+		if (w < 0)
+			w = neutral_cost_;
+		int x = top.state % distance_nx_, y = top.state / distance_nx_;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int mx = x + dx, my = y + dy;
+				if ((dx == 0 && dy == 0) || mx < 0 || mx >= distance_nx_
+						|| my < 0 || my >= distance_ny_)
+					continue;
+				int m = my * distance_nx_ + mx;
+				if (m != distance_start_ && cellWeight(distance_costs_[m]) < 0)
+					continue;
+				float d = top.f + w * (dx != 0 && dy != 0 ? M_SQRT2 : 1);
+				if (d < distance_[m]) {
+					distance_[m] = d;
+					distance_open_.push_back(Entry(m, d, d));
+					std::push_heap(distance_open_.begin(), distance_open_.end(),
+							greaterEntry());
+				}
+			}
+		}
+	}
+	return distance_[n] >= POT_HIGH ? -1 : distance_[n];
+}
+
+float LatticePlanner::heuristic(int x, int y, int angle) {
+	float h = distanceTo(y * nx_ + x);
+	if (h < 0)
+		return -1;
+	int dx = goal_x_ - x, dy = goal_y_ - y, r = free_radius_;
+	if (r > 0 && abs(dx) <= r && abs(dy) <= r) {
+		int w = 2 * r + 1;
+		h = std::max(h,
+				free_table_[((angle * w + dy + r) * w + dx + r) * num_angles_
+						+ goal_angle_]);
+	}
+	return h;
+}
+
+/*
+ * 无障碍时从 (0, 0, a) 到窗口内每个 (dx, dy, angle) 的 lattice 代价，
+ * 在 goal 附近补足 2d 距离忽略的转向代价
+ */
+void LatticePlanner::computeFreeSpaceTable(int radius) {
+	free_radius_ = std::max(radius, 0);
+	free_table_.clear();
+	if (free_radius_ == 0)
+		return;
+
+	int w = 2 * free_radius_ + 1, r = free_radius_;
+	int size = w * w * num_angles_;
+	free_table_.assign(num_angles_ * size, 0.0f);
+	std::vector<float> g(size);
+	std::vector<Entry> open;
+
+	for (int a = 0; a < num_angles_; a++) {
+		std::fill(g.begin(), g.end(), (float) POT_HIGH);
+		open.clear();
+		int s = (r * w + r) * num_angles_ + a;
+		g[s] = 0;
+		open.push_back(Entry(s, 0, 0));
+
+		while (!open.empty()) {
+			Entry top = open[0];
+			std::pop_heap(open.begin(), open.end(), greaterEntry());
+			open.pop_back();
+			if (top.g != g[top.state])
+				continue;
+			int angle = top.state % num_angles_, cell = top.state / num_angles_;
+			int x = cell % w - r, y = cell / w - r;
+
+			const std::vector<MotionPrimitive>& ps = primitives_.forAngle(angle);
+			for (size_t i = 0; i < ps.size(); i++) {
+				const MotionPrimitive& p = ps[i];
+				int ex = x + p.dx, ey = y + p.dy;
+				if (abs(ex) > r || abs(ey) > r)
+					continue;
+				float c = neutral_cost_ * (p.cells.empty() ? 1 : p.length)
+						* p.cost_mult;
+				int m = ((ey + r) * w + ex + r) * num_angles_ + p.end_angle;
+				if (top.g + c < g[m]) {
+					g[m] = top.g + c;
+					open.push_back(Entry(m, g[m], g[m]));
+					std::push_heap(open.begin(), open.end(), greaterEntry());
+				}
+			}
+		}
+
+		for (int m = 0; m < size; m++)
+			if (g[m] < POT_HIGH)
+				free_table_[a * size + m] = g[m];
+	}
+}
+
+bool LatticePlanner::makePlan(const Pose2D& start, const Pose2D& goal,
+		std::vector<Pose2D>& plan) {
+	logInfo<< "lattice planner start make plan";
+	boost::mutex::scoped_lock lock(mutex_);
+
+	if (!initialized_) {
+		printf(
+				"This planner has not been initialized yet, but it is being used, please call initialize() before use\n");
+		return false;
+	}
+	plan.clear();
+	cancel_requested_ = false;
+	clock_t begin = clock();
+
+	NS_CostMap::Costmap2D* map = costmap->getLayeredCostmap()->getCostmap();
+	int nx = map->getSizeInCellsX(), ny = map->getSizeInCellsY();
+	unsigned int start_x, start_y, goal_x, goal_y;
+	if (!map->worldToMap(start.x(), start.y(), start_x, start_y)) {
+		printf(
+				"The robot's start position is off the global costmap. Planning will always fail, are you sure the robot has been properly localized?\n");
+		return false;
+	}
+	if (!map->worldToMap(goal.x(), goal.y(), goal_x, goal_y)) {
+		printf(
+				"The goal sent to the global planner is off the global costmap. Planning will always fail to this goal.\n");
+		return false;
+	}
+
+	const unsigned char* costs = map->getCharMap();
+	if (cellWeight(costs[goal_y * nx + goal_x]) < 0) {
+		printf("[LatticePlanner] the goal is in collision\n");
+		return false;
+	}
+
+	/*
+	 * 机器人周围 1 格内没有和 goal 同一个连通区域的格子时，
+	 * 不必把 2d 距离场扩展到整个可达区域才失败
+	 */
+	if (components_ != NULL) {
+		components_->update(costmap->getLayeredCostmap());
+		int reachable;
+		if (!components_->connected(start_x, start_y, 1, goal_x, goal_y, 0,
+				&reachable) && reachable > 0) {
+			++unreachable_rejected_;
+			logInfo<< "goal is not connected to the robot , rejected "
+			<<unreachable_rejected_<<" goals";
+			return false;
+		}
+	}
+
+	nx_ = nx;
+	goal_x_ = goal_x;
+	goal_y_ = goal_y;
+	goal_angle_ = primitives_.binOf(goal.theta());
+	///the robot cell may be inscribed or hold a sensor hit on the robot
+	int start_cell = start_y * nx + start_x;
+	free_start_ = cellWeight(costs[start_cell]) < 0 ? start_cell : -1;
+	prepareDistanceField(costs, nx, ny, goal_x, goal_y);
+
+	int start_angle = primitives_.binOf(start.theta());
+	float h = heuristic(start_x, start_y, start_angle);
+	if (h < 0) {
+		printf("[LatticePlanner] the goal can not be reached from the start\n");
+		return false;
+	}
+
+	nodes_.clear();
+	open_.clear();
+	int start_state = (start_y * nx + start_x) * num_angles_ + start_angle;
+	int goal_state = (goal_y * nx + goal_x) * num_angles_ + goal_angle_;
+	Node first = { 0, h, -1, -1, false };
+	nodes_[start_state] = first;
+	open_.push_back(Entry(start_state, heuristic_weight_ * h, 0));
+
+	int expansions = 0;
+	bool found = false;
+	while (!open_.empty()) {
+		if (cancel_requested_) {
+			logInfo<< "lattice planner cancelled after " << expansions
+			<< " expansions";
+			return false;
+		}
+		Entry top = open_[0];
+		std::pop_heap(open_.begin(), open_.end(), greaterEntry());
+		open_.pop_back();
+
+		Node& node = nodes_[top.state];
+		if (node.closed || top.g != node.g)
+			continue;
+		node.closed = true;
+		if (top.state == goal_state) {
+			found = true;
+			break;
+		}
+		if (max_expansions_ > 0 && expansions >= max_expansions_)
+			break;
+		expansions++;
+
+		int angle = top.state % num_angles_, cell = top.state / num_angles_;
+		int x = cell % nx, y = cell / nx;
+		const std::vector<MotionPrimitive>& ps = primitives_.forAngle(angle);
+		for (size_t i = 0; i < ps.size(); i++) {
+			const MotionPrimitive& p = ps[i];
+			float c = primitiveCost(costs, nx, ny, x, y, p);
+			if (c < 0)
+				continue;
+			int ex = x + p.dx, ey = y + p.dy;
+			int next = (ey * nx + ex) * num_angles_ + p.end_angle;
+			float g = top.g + c;
+
+			std::unordered_map<int, Node>::iterator it = nodes_.find(next);
+			if (it == nodes_.end()) {
+				float nh = heuristic(ex, ey, p.end_angle);
+				if (nh < 0)
+					continue;
+				Node n = { g, nh, top.state, (short) i, false };
+				it = nodes_.insert(std::make_pair(next, n)).first;
+			} else if (it->second.closed || g >= it->second.g) {
+				continue;
+			} else {
+				it->second.g = g;
+				it->second.parent = top.state;
+				it->second.primitive = i;
+			}
+			open_.push_back(Entry(next, g + heuristic_weight_ * it->second.h, g));
+			std::push_heap(open_.begin(), open_.end(), greaterEntry());
+		}
+	}
+
+	logInfo<< "lattice planner expansions " << expansions << " , states "
+	<< nodes_.size() << " , 2d cells settled " << distance_settled_
+	<< " , 2d field reused " << distance_reused_ << " times , "
+	<< (double) (clock() - begin) * 1000 / CLOCKS_PER_SEC << " ms";
+
+	if (!found) {
+		printf("[LatticePlanner] no path found after %d expansions\n",
+				expansions);
+		return false;
+	}
+	last_plan_cost_ = nodes_[goal_state].g;
+	extractPlan(goal_state, start, goal, plan);
+	return true;
+}
+
+bool LatticePlanner::makePlan(const Pose2D& start, const Pose2D& goal,
+		std::vector<Pose2D>& plan, double& cost) {
+	bool found = makePlan(start, goal, plan);
+	cost = found ? last_plan_cost_ : 0;
+	return found;
+}
+
+void LatticePlanner::cancelPlan() {
+	cancel_requested_ = true;
+}
+
+/*
+ * 按 primitive 的中间位姿展开成 plan，朝向直接来自 primitive
+ */
+void LatticePlanner::extractPlan(int state, const Pose2D& start,
+		const Pose2D& goal, std::vector<Pose2D>& plan) {
+	std::vector<int> chain;
+	for (int s = state; nodes_[s].parent >= 0; s = nodes_[s].parent)
+		chain.push_back(s);
+
+	NS_CostMap::Costmap2D* map = costmap->getLayeredCostmap()->getCostmap();
+	double resolution = map->getResolution();
+	plan.push_back(start);
+	for (int i = (int) chain.size() - 1; i >= 0; i--) {
+		const Node& node = nodes_[chain[i]];
+		int angle = node.parent % num_angles_, cell = node.parent / num_angles_;
+		float wx, wy;
+		map->mapToWorld(cell % nx_, cell / nx_, wx, wy);
+
+		const MotionPrimitive& p = primitives_.forAngle(angle)[node.primitive];
+		for (size_t k = 1; k < p.points.size(); k++) {
+			double theta = atan2(sin(p.thetas[k]), cos(p.thetas[k]));
+			plan.push_back(
+					Pose2D(wx + p.points[k].first * resolution,
+							wy + p.points[k].second * resolution, theta));
+		}
+	}
+	if (plan.size() > 1)
+		plan.back() = goal;
+	else
+		plan.push_back(goal);
+}
+
+} /* namespace NS_Planner */
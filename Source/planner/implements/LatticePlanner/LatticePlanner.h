@@ -0,0 +1,149 @@
+#ifndef _LATTICEPLANNER_H_
+#define _LATTICEPLANNER_H_
+
+#include "../../base/GlobalPlannerBase.h"
+#include "MotionPrimitives.h"
+#include "../../../costmap/costmap_2d/FreeSpaceComponents.h"
+
+#include <vector>
+#include <atomic>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
+
+namespace NS_Planner
+{
+
+  /**
+   * state lattice planner: a* over (x, y, heading bin) whose edges are the
+   * motion primitives of MotionPrimitives, so every plan is drivable with
+   * its headings as planned and no orientation filter is needed.
+   * h = max(2d dijkstra from the goal on the costmap, free space lattice
+   * cost), the 2d field is expanded lazily and kept while goal and costmap
+   * do not change, the free space table is computed once on initialize.
+   */
+  class LatticePlanner: public GlobalPlannerBase
+  {
+  public:
+    LatticePlanner();
+    virtual
+    ~LatticePlanner();
+
+    void
+    onInitialize();
+
+    bool
+    makePlan(const Pose2D& start,
+             const Pose2D& goal,
+             std::vector< Pose2D >& plan);
+
+    bool
+    makePlan(const Pose2D& start,
+             const Pose2D& goal,
+             std::vector< Pose2D >& plan,
+             double& cost);
+
+    void
+    cancelPlan();
+
+  private:
+    struct Node
+    {
+      float g, h;
+      int parent;
+      short primitive;
+      bool closed;
+    };
+    struct Entry
+    {
+      Entry(int state, float f, float g)
+          : state(state), f(f), g(g)
+      {
+      }
+      int state;
+      float f, g;
+    };
+    struct greaterEntry
+    {
+      bool operator()(const Entry& a, const Entry& b) const
+      {
+        return a.f > b.f;
+      }
+    };
+
+    /**
+     * neutral_cost_ + cost_factor_ * cost, < 0 if the cell can not be entered
+     */
+    float
+    cellWeight(unsigned char cost);
+    /**
+     * cost of primitive p from cell (x, y), < 0 if it leaves the map or
+     * touches a cell that can not be entered
+     */
+    float
+    primitiveCost(const unsigned char* costs, int nx, int ny, int x, int y,
+                  const MotionPrimitive& p);
+    /**
+     * < 0 if the goal can not be reached from (x, y) on the 2d grid
+     */
+    float
+    heuristic(int x, int y, int angle);
+    void
+    prepareDistanceField(const unsigned char* costs, int nx, int ny,
+                         int goal_x, int goal_y);
+    /**
+     * newest dirty tile stamp of the layered costmap,
+     * false if its tiles do not match the nx x ny map
+     */
+    bool
+    costmapStamp(int nx, int ny, unsigned int& stamp);
+    float
+    distanceTo(int n);
+    void
+    computeFreeSpaceTable(int radius);
+    void
+    extractPlan(int state, const Pose2D& start, const Pose2D& goal,
+                std::vector< Pose2D >& plan);
+
+    bool initialized_, allow_unknown_;
+    boost::mutex mutex_;
+    std::atomic< bool > cancel_requested_;
+
+    MotionPrimitives primitives_;
+    int num_angles_;
+    unsigned char lethal_cost_;
+    float neutral_cost_, cost_factor_;
+    float heuristic_weight_;
+    int max_expansions_;
+
+    std::unordered_map< int, Node > nodes_;
+    std::vector< Entry > open_;
+    int nx_, goal_x_, goal_y_, goal_angle_;
+    /// the start cell when it can not be entered, it is searched as free
+    /// space like GlobalPlanner clears the robot cell, -1 otherwise
+    int free_start_;
+
+    /// lazy 2d dijkstra from the goal, reused while the goal, the free
+    /// start and the dirty tile stamps of the costmap stay
+    const unsigned char* distance_costs_;
+    float* distance_;
+    int distance_nx_, distance_ny_, distance_goal_, distance_start_;
+    unsigned int distance_stamp_;
+    bool distance_stamped_;
+    std::vector< Entry > distance_open_;
+    int distance_settled_, distance_reused_;
+
+    /// [start angle][dy + r][dx + r][end angle] in free space, 0 if unknown
+    std::vector< float > free_table_;
+    int free_radius_;
+
+    float last_plan_cost_;
+
+    /// goals outside the robot's free space component are rejected before
+    /// the 2d field is flooded, NULL if reject_unreachable is off
+    NS_CostMap::FreeSpaceComponents* components_;
+    int unreachable_rejected_;
+  };
+
+} /* namespace NS_Planner */
+
+#endif
@@ -0,0 +1,225 @@
+#include "MotionPrimitives.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <algorithm>
+
+namespace NS_Planner
+{
+
+  static bool expectLabel(std::ifstream& in, const char* label)
+  {
+    std::string token;
+    if(!(in >> token) || token != label)
+    {
+      printf("[MotionPrimitives] expected %s, read %s\n", label,
+             token.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool MotionPrimitives::load(const std::string& file, double resolution)
+  {
+    std::ifstream in(file.c_str());
+    if(!in.is_open())
+    {
+      printf("[MotionPrimitives] can not open %s\n", file.c_str());
+      return false;
+    }
+
+    double file_resolution;
+    int num_angles, total;
+    if(!expectLabel(in, "resolution_m:") || !(in >> file_resolution)
+        || !expectLabel(in, "numberofangles:") || !(in >> num_angles)
+        || !expectLabel(in, "totalnumberofprimitives:") || !(in >> total))
+      return false;
+    if(fabs(file_resolution - resolution) > resolution * 1e-3 || num_angles <= 0)
+    {
+      printf("[MotionPrimitives] %s is made for resolution %f and %d angles, "
+             "the costmap resolution is %f\n", file.c_str(), file_resolution,
+             num_angles, resolution);
+      return false;
+    }
+
+    num_angles_ = num_angles;
+    by_angle_.assign(num_angles_, std::vector< MotionPrimitive >());
+    for(int i = 0; i < total; i++)
+    {
+      MotionPrimitive primitive;
+      int id, end_angle, count;
+      if(!expectLabel(in, "primID:") || !(in >> id)
+          || !expectLabel(in, "startangle_c:") || !(in >> primitive.start_angle)
+          || !expectLabel(in, "endpose_c:")
+          || !(in >> primitive.dx >> primitive.dy >> end_angle)
+          || !expectLabel(in, "additionalactioncostmult:")
+          || !(in >> primitive.cost_mult)
+          || !expectLabel(in, "intermediateposes:") || !(in >> count))
+        return false;
+      if(primitive.start_angle < 0 || primitive.start_angle >= num_angles_
+          || count < 2)
+      {
+        printf("[MotionPrimitives] primitive %d of %s is invalid\n", id,
+               file.c_str());
+        return false;
+      }
+      primitive.end_angle = ((end_angle % num_angles_) + num_angles_)
+          % num_angles_;
+
+      for(int k = 0; k < count; k++)
+      {
+        float x, y, theta;
+        if(!(in >> x >> y >> theta))
+          return false;
+        primitive.points.push_back(
+            std::make_pair(x / resolution, y / resolution));
+        primitive.thetas.push_back(theta);
+      }
+      addPrimitive(primitive);
+    }
+    return true;
+  }
+
+  void MotionPrimitives::generateDefault(int num_angles, float turn_in_place_mult)
+  {
+    num_angles_ = num_angles;
+    by_angle_.assign(num_angles_, std::vector< MotionPrimitive >());
+
+    for(int a = 0; a < num_angles_; a++)
+    {
+      double theta = angleOf(a);
+
+      // the shortest cell offset pointing closest to the bin direction
+      int sx = 1, sy = 0;
+      double best = HUGE_VAL;
+      for(int dy = -3; dy <= 3; dy++)
+      {
+        for(int dx = -3; dx <= 3; dx++)
+        {
+          if(dx == 0 && dy == 0)
+            continue;
+          double error = fabs(remainder(atan2((double) dy, (double) dx) - theta,
+                                        2 * M_PI));
+          // 1 degree of slack in favour of shorter offsets
+          double score = error + hypot(dx, dy) * (M_PI / 180);
+          if(score < best)
+          {
+            best = score;
+            sx = dx;
+            sy = dy;
+          }
+        }
+      }
+      int k = (int) ceil(4.0 / hypot(sx, sy));
+      addCurve(a, sx, sy, a, 1.0f);
+      addCurve(a, sx * k, sy * k, a, 1.0f);
+
+      // arcs of radius 8 cells to the neighbouring bins
+      double step = 2 * M_PI / num_angles_;
+      for(int side = -1; side <= 1; side += 2)
+      {
+        double r = 8.0;
+        double ex = r * sin(step), ey = side * r * (1 - cos(step));
+        int dx = (int) floor(ex * cos(theta) - ey * sin(theta) + 0.5);
+        int dy = (int) floor(ex * sin(theta) + ey * cos(theta) + 0.5);
+        addCurve(a, dx, dy, (a + side + num_angles_) % num_angles_, 2.0f);
+      }
+
+      for(int side = -1; side <= 1; side += 2)
+      {
+        MotionPrimitive turn;
+        turn.start_angle = a;
+        turn.end_angle = (a + side + num_angles_) % num_angles_;
+        turn.dx = turn.dy = 0;
+        turn.cost_mult = turn_in_place_mult;
+        for(int k = 0; k <= 4; k++)
+        {
+          turn.points.push_back(std::make_pair(0.0f, 0.0f));
+          turn.thetas.push_back(theta + side * step * k / 4);
+        }
+        addPrimitive(turn);
+      }
+    }
+  }
+
+  void MotionPrimitives::addCurve(int angle, int dx, int dy, int end_angle,
+                                  float cost_mult)
+  {
+    // cubic hermite from the start pose to the end pose, the tangents as
+    // long as the chord
+    double t0 = angleOf(angle), t1 = angleOf(end_angle);
+    double chord = hypot(dx, dy);
+    double m0x = chord * cos(t0), m0y = chord * sin(t0);
+    double m1x = chord * cos(t1), m1y = chord * sin(t1);
+
+    MotionPrimitive primitive;
+    primitive.start_angle = angle;
+    primitive.end_angle = end_angle;
+    primitive.dx = dx;
+    primitive.dy = dy;
+    primitive.cost_mult = cost_mult;
+
+    int n = (int) ceil(chord * 4);
+    for(int k = 0; k <= n; k++)
+    {
+      double t = (double) k / n, t2 = t * t, t3 = t2 * t;
+      double h10 = t3 - 2 * t2 + t, h01 = -2 * t3 + 3 * t2, h11 = t3 - t2;
+      double x = h10 * m0x + h01 * dx + h11 * m1x;
+      double y = h10 * m0y + h01 * dy + h11 * m1y;
+      // derivative for the heading
+      double d10 = 3 * t2 - 4 * t + 1, d01 = -6 * t2 + 6 * t, d11 = 3 * t2 - 2 * t;
+      double vx = d10 * m0x + d01 * dx + d11 * m1x;
+      double vy = d10 * m0y + d01 * dy + d11 * m1y;
+      primitive.points.push_back(std::make_pair((float) x, (float) y));
+      primitive.thetas.push_back(
+          k == 0 ? t0 : (k == n ? t1 : atan2(vy, vx)));
+    }
+    addPrimitive(primitive);
+  }
+
+  void MotionPrimitives::addPrimitive(MotionPrimitive& primitive)
+  {
+    primitive.length = 0;
+    for(size_t k = 1; k < primitive.points.size(); k++)
+      primitive.length += hypot(
+          primitive.points[k].first - primitive.points[k - 1].first,
+          primitive.points[k].second - primitive.points[k - 1].second);
+    computeCells(primitive);
+    by_angle_[primitive.start_angle].push_back(primitive);
+  }
+
+  void MotionPrimitives::computeCells(MotionPrimitive& primitive)
+  {
+    primitive.cells.clear();
+    int lx = 0, ly = 0;
+    for(size_t k = 0; k < primitive.points.size(); k++)
+    {
+      int x = (int) floor(primitive.points[k].first + 0.5);
+      int y = (int) floor(primitive.points[k].second + 0.5);
+      if(x == lx && y == ly)
+        continue;
+      primitive.cells.push_back(std::make_pair(x, y));
+      lx = x;
+      ly = y;
+    }
+    // the end cell is the lattice state, make sure it is checked
+    if(primitive.cells.empty() ? (primitive.dx != 0 || primitive.dy != 0)
+        : (primitive.cells.back().first != primitive.dx
+            || primitive.cells.back().second != primitive.dy))
+      primitive.cells.push_back(std::make_pair(primitive.dx, primitive.dy));
+  }
+
+  double MotionPrimitives::angleOf(int bin) const
+  {
+    return bin * 2 * M_PI / num_angles_;
+  }
+
+  int MotionPrimitives::binOf(double theta) const
+  {
+    double step = 2 * M_PI / num_angles_;
+    int bin = (int) floor(theta / step + 0.5) % num_angles_;
+    return bin < 0 ? bin + num_angles_ : bin;
+  }
+
+} //end namespace global_planner
@@ -0,0 +1,86 @@
+#ifndef _MOTION_PRIMITIVES_H_
+#define _MOTION_PRIMITIVES_H_
+
+#include <vector>
+#include <string>
+#include <utility>
+
+namespace NS_Planner
+{
+
+  /**
+   * one kinematically feasible motion from the centre of a cell with a given
+   * heading bin to the centre of the cell (dx, dy) with end_angle
+   */
+  struct MotionPrimitive
+  {
+    int start_angle, end_angle;
+    int dx, dy;
+    /// extra cost multiplier of the file, e.g. > 1 for turning in place
+    float cost_mult;
+    /// arc length in cells, 0 for turning in place
+    float length;
+    /// (x, y) in cells from the start cell centre and theta in radians
+    std::vector< std::pair< float, float > > points;
+    std::vector< float > thetas;
+    /// cells the centre passes through, without the start cell, in order
+    std::vector< std::pair< int, int > > cells;
+  };
+
+  /**
+   * library of motion primitives per heading bin, in the .mprim format of
+   * the sbpl lattice planner (resolution_m, numberofangles,
+   * totalnumberofprimitives, then per primitive primID, startangle_c,
+   * endpose_c, additionalactioncostmult and intermediateposes in metres).
+   * the swept cells of every primitive are computed once on load.
+   */
+  class MotionPrimitives
+  {
+  public:
+    MotionPrimitives()
+        : num_angles_(0)
+    {
+    }
+
+    /**
+     * false if the file is missing, malformed or made for another resolution
+     */
+    bool
+    load(const std::string& file, double resolution);
+
+    /**
+     * unicycle set for a differential drive: short and long straights, arcs
+     * to the neighbouring heading bins and turns in place by one bin
+     */
+    void
+    generateDefault(int num_angles, float turn_in_place_mult);
+
+    int getNumAngles() const
+    {
+      return num_angles_;
+    }
+
+    const std::vector< MotionPrimitive >& forAngle(int angle) const
+    {
+      return by_angle_[angle];
+    }
+
+    double
+    angleOf(int bin) const;
+    int
+    binOf(double theta) const;
+
+  private:
+    void
+    addPrimitive(MotionPrimitive& primitive);
+    void
+    addCurve(int angle, int dx, int dy, int end_angle, float cost_mult);
+    void
+    computeCells(MotionPrimitive& primitive);
+
+    int num_angles_;
+    std::vector< std::vector< MotionPrimitive > > by_angle_;
+  };
+
+} //end namespace global_planner
+#endif
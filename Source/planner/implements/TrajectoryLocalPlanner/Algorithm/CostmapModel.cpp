@@ -1,15 +1,96 @@
 #include "CostmapModel.h"
 
+#include <algorithm>
+#include <utility>
 #include "../../../../costmap/costmap_2d/CostValues.h"
-#include "LineIterator.h"
 
 using namespace std;
 using namespace NS_CostMap;
 
 namespace NS_Planner
 {
+  /// headings the footprint stamps are precomputed for
+  static const int FOOTPRINT_STAMP_HEADINGS = 64;
+  /// cells the stamps are grown by, covers the rounding of the pose
+  static const double FOOTPRINT_STAMP_MARGIN = 0.01;
+
+  /**
+   * whether a segment given in cell units passes through a rectangle,
+   * Liang-Barsky clipping
+   */
+  static bool segmentInRect(double x0, double y0, double x1, double y1,
+                            double min_x, double min_y, double max_x,
+                            double max_y)
+  {
+    double t0 = 0.0, t1 = 1.0;
+    double p[4] = {-(x1 - x0), x1 - x0, -(y1 - y0), y1 - y0};
+    double q[4] = {x0 - min_x, max_x - x0, y0 - min_y, max_y - y0};
+    for(int i = 0; i < 4; i++)
+    {
+      if(p[i] == 0.0)
+      {
+        if(q[i] < 0.0)
+          return false;
+        continue;
+      }
+      double t = q[i] / p[i];
+      if(p[i] < 0.0)
+        t0 = std::max(t0, t);
+      else
+        t1 = std::min(t1, t);
+      if(t0 > t1)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * cells overlapped by a polygon given in cell units, each cell (x, y) is
+   * taken as [x - low, x + 1 + high] x [y - low, y + 1 + high]
+   */
+  static void polygonCells(const vector< double >& px,
+                           const vector< double >& py, double low,
+                           double high, vector< pair< int, int > >& cells)
+  {
+    cells.clear();
+    size_t n = px.size();
+    double min_x = px[0], max_x = px[0], min_y = py[0], max_y = py[0];
+    for(size_t i = 1; i < n; i++)
+    {
+      min_x = std::min(min_x, px[i]);
+      max_x = std::max(max_x, px[i]);
+      min_y = std::min(min_y, py[i]);
+      max_y = std::max(max_y, py[i]);
+    }
+
+    for(int y = (int)floor(min_y - high) - 1; y <= (int)floor(max_y + low); y++)
+    {
+      for(int x = (int)floor(min_x - high) - 1; x <= (int)floor(max_x + low);
+          x++)
+      {
+        bool overlap = false, inside = false;
+        for(size_t i = 0; !overlap && i < n; i++)
+        {
+          size_t j = (i + 1) % n;
+          overlap = segmentInRect(px[i], py[i], px[j], py[j], x - low,
+                                  y - low, x + 1 + high, y + 1 + high);
+        }
+
+        //no edge crosses the cell, it is inside if its corner is
+        for(size_t i = 0, j = n - 1; !overlap && i < n; j = i++)
+        {
+          if((py[i] > y) != (py[j] > y)
+              && x < px[i] + (y - py[i]) / (py[j] - py[i]) * (px[j] - px[i]))
+            inside = !inside;
+        }
+        if(overlap || inside)
+          cells.push_back(make_pair(x, y));
+      }
+    }
+  }
+
   CostmapModel::CostmapModel(const Costmap2D& ma)
-      : costmap_(ma)
+      : costmap_(ma), distance_layer_(NULL), clear_shortcut_(false)
   {
   }
 
@@ -38,82 +119,213 @@ namespace NS_Planner
     }
 
     //now we really have to lay down the footprint in the costmap grid
-//    unsigned int x0, x1, y0, y1;
-//    double line_cost = 0.0;
+    float origin_x, origin_y;
+    double resolution = costmap_.getResolution();
+    costmap_.mapToWorld(0, 0, origin_x, origin_y);
+    origin_x -= resolution / 2;
+    origin_y -= resolution / 2;
+
+    vector< double > px(footprint.size()), py(footprint.size());
+    for(unsigned int i = 0; i < footprint.size(); ++i)
+    {
+      px[i] = (footprint[i].x() - origin_x) / resolution;
+      py[i] = (footprint[i].y() - origin_y) / resolution;
+    }
+    vector< pair< int, int > > cells;
+    polygonCells(px, py, 0.0, 0.0, cells);
+
     double footprint_cost = 0.0;
-//
-//    //we need to rasterize each line in the footprint
-//    for(unsigned int i = 0; i < footprint.size() - 1; ++i)
-//    {
-//      //get the cell coord of the first point
-//      if(!costmap_.worldToMap(footprint[i].x(), footprint[i].y(), x0, y0))
-//        return -1.0;
-//
-//      //get the cell coord of the second point
-//      if(!costmap_.worldToMap(footprint[i + 1].x(), footprint[i + 1].y(), x1, y1))
-//        return -1.0;
-//
-//      line_cost = lineCost(x0, x1, y0, y1);
-//      footprint_cost = std::max(line_cost, footprint_cost);
-//
-//      //if there is an obstacle that hits the line... we know that we can return false right away
-//      if(line_cost < 0)
-//        return -1.0;
-//    }
-//
-//    //we also need to connect the first point in the footprint to the last point
-//    //get the cell coord of the last point
-//    if(!costmap_.worldToMap(footprint.back().x(), footprint.back().y(), x0, y0))
-//      return -1.0;
-//
-//    //get the cell coord of the first point
-//    if(!costmap_.worldToMap(footprint.front().x(), footprint.front().y(), x1, y1))
-//      return -1.0;
-//
-//    line_cost = lineCost(x0, x1, y0, y1);
-//    footprint_cost = std::max(line_cost, footprint_cost);
-//
-//    if(line_cost < 0)
-//      return -1.0;
-
-    //if all line costs are legal... then we can return that the footprint is legal
+    for(size_t i = 0; i < cells.size(); ++i)
+    {
+      if(cells[i].first < 0 || cells[i].second < 0
+          || cells[i].first >= (int)costmap_.getSizeInCellsX()
+          || cells[i].second >= (int)costmap_.getSizeInCellsY())
+        return -1.0;
+
+      double point_cost = pointCost(cells[i].first, cells[i].second);
+
+      //if there is an obstacle under the footprint... we know that we can return false right away
+      if(point_cost < 0)
+        return -1.0;
+
+      footprint_cost = std::max(point_cost, footprint_cost);
+    }
+
+    //if all cell costs are legal... then we can return that the footprint is legal
     return footprint_cost;
 
   }
 
-  //calculate the cost of a ray-traced line
-//  double CostmapModel::lineCost(int x0, int x1, int y0, int y1)
-//  {
-//
-//    double line_cost = 0.0;
-//    double point_cost = -1.0;
-//
-//    for(LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance())
-//    {
-//      point_cost = pointCost(line.getX(), line.getY()); //Score the current point
-//
-//      if(point_cost < 0)
-//        return -1;
-//
-//      if(line_cost < point_cost)
-//        line_cost = point_cost;
-//    }
-//
-//    return line_cost;
-//  }
-//
-//  double CostmapModel::pointCost(int x, int y)
-//  {
-//    unsigned char cost = costmap_.getCost(x, y);
-//    //if the cell is in an obstacle the path is invalid
-//    //if(cost == LETHAL_OBSTACLE){
-//    if(cost == LETHAL_OBSTACLE || cost == NO_INFORMATION)
-//    {
-//      return -1;
-//    }
-//
-//    return cost;
-//  }
+  double CostmapModel::footprintCost(
+      double x, double y, double theta,
+      const std::vector< Point2D >& footprint_spec,
+      double inscribed_radius, double circumscribed_radius)
+  {
+    if(footprint_spec.size() < 3)
+      return WorldModel::footprintCost(x, y, theta, footprint_spec,
+                                       inscribed_radius, circumscribed_radius);
+
+    unsigned int cell_x, cell_y;
+    if(!costmap_.worldToMap(x, y, cell_x, cell_y))
+      return -1.0;
+
+    FootprintStampsPtr stamps = boost::atomic_load(&stamps_);
+    bool stale = !stamps || stamps->size_x != costmap_.getSizeInCellsX()
+        || stamps->resolution != costmap_.getResolution()
+        || stamps->footprint.size() != footprint_spec.size();
+    for(size_t i = 0; !stale && i < footprint_spec.size(); i++)
+      stale = stamps->footprint[i].x() != footprint_spec[i].x()
+          || stamps->footprint[i].y() != footprint_spec[i].y();
+    if(stale)
+    {
+      stamps = buildStamps(footprint_spec);
+      boost::atomic_store(&stamps_, stamps);
+    }
+
+    /*
+     * 距离场的值是栅格中心之间的距离，机器人在栅格内的偏移和障碍栅格的大小
+     * 合起来最多差一个对角线，两边各留出余量
+     */
+    const NS_CostMap::DistanceLayer* distance_layer = distance_layer_;
+    if(distance_layer && distance_layer->getSizeInCellsX() == stamps->size_x
+        && distance_layer->getSizeInCellsY() == costmap_.getSizeInCellsY())
+    {
+      double clearance = distance_layer->getDistance(cell_x, cell_y);
+      if(clearance <= stamps->inscribed_radius - stamps->resolution)
+        return -1.0;
+      // the robot cell is the farthest from obstacles, its cost is only a lower bound of the footprint cost
+      if(clear_shortcut_
+          && clearance > stamps->circumscribed_radius + 2 * stamps->resolution
+          && (int)cell_x >= stamps->reach && (int)cell_y >= stamps->reach
+          && cell_x + stamps->reach < costmap_.getSizeInCellsX()
+          && cell_y + stamps->reach < costmap_.getSizeInCellsY())
+        return costmap_.getCost(cell_x, cell_y);
+    }
+
+    /*
+     * 按最近的离散朝向和机器人所在栅格的四分之一块选取预先计算好的足迹栅格，
+     * 印章包含了该块和该朝向区间内任意位姿压到的栅格，只会多查边缘的栅格，不会漏查
+     */
+    float center_x, center_y;
+    costmap_.mapToWorld(cell_x, cell_y, center_x, center_y);
+    int quarter = (x >= center_x ? 1 : 0) + (y >= center_y ? 2 : 0);
+    int heading = (int)floor(theta / (2 * M_PI) * FOOTPRINT_STAMP_HEADINGS + 0.5)
+        % FOOTPRINT_STAMP_HEADINGS;
+    if(heading < 0)
+      heading += FOOTPRINT_STAMP_HEADINGS;
+    int stamp = heading * 4 + quarter;
+
+    if((int)cell_x + stamps->min_x[stamp] < 0
+        || (int)cell_y + stamps->min_y[stamp] < 0
+        || cell_x + stamps->max_x[stamp] >= costmap_.getSizeInCellsX()
+        || cell_y + stamps->max_y[stamp] >= costmap_.getSizeInCellsY())
+      return -1.0;
+
+    const unsigned char* center = costmap_.getCharMap()
+        + costmap_.getIndex(cell_x, cell_y);
+    const int* offset = &stamps->offsets[0] + stamps->begin[stamp];
+    const int* end = &stamps->offsets[0] + stamps->begin[stamp + 1];
+    unsigned char footprint_cost = 0;
+    for(; offset != end; ++offset)
+    {
+      unsigned char cost = center[*offset];
+      //lethal and no information are the two highest values
+      if(cost >= LETHAL_OBSTACLE)
+        return -1.0;
+      if(cost > footprint_cost)
+        footprint_cost = cost;
+    }
+    return footprint_cost;
+  }
+
+  CostmapModel::FootprintStampsPtr CostmapModel::buildStamps(
+      const std::vector< Point2D >& footprint_spec) const
+  {
+    boost::shared_ptr< FootprintStamps > stamps(new FootprintStamps);
+    stamps->footprint = footprint_spec;
+    stamps->size_x = costmap_.getSizeInCellsX();
+    stamps->resolution = costmap_.getResolution();
+    calculateMinAndMaxDistances(footprint_spec, stamps->inscribed_radius,
+                                stamps->circumscribed_radius);
+
+    int count = FOOTPRINT_STAMP_HEADINGS * 4;
+    stamps->begin.reserve(count + 1);
+    stamps->min_x.resize(count);
+    stamps->max_x.resize(count);
+    stamps->min_y.resize(count);
+    stamps->max_y.resize(count);
+
+    /*
+     * 机器人在四分之一栅格内移动时，足迹压到某个栅格等价于固定在该块左下角的
+     * 足迹压到向左下扩大半个栅格的这个栅格；朝向区间取两端和中间三个朝向的并集
+     */
+    vector< double > px(footprint_spec.size()), py(footprint_spec.size());
+    vector< pair< int, int > > heading_cells, cells;
+    for(int stamp = 0; stamp < count; stamp++)
+    {
+      double robot_x = (stamp & 1) ? 0.5 : 0.0;
+      double robot_y = (stamp & 2) ? 0.5 : 0.0;
+      cells.clear();
+      for(int step = -1; step <= 1; step++)
+      {
+        double theta = (stamp / 4 + step * 0.5) * 2 * M_PI
+            / FOOTPRINT_STAMP_HEADINGS;
+        double cos_th = cos(theta), sin_th = sin(theta);
+        for(size_t i = 0; i < footprint_spec.size(); i++)
+        {
+          px[i] = robot_x
+              + (footprint_spec[i].x() * cos_th - footprint_spec[i].y() * sin_th)
+                  / stamps->resolution;
+          py[i] = robot_y
+              + (footprint_spec[i].x() * sin_th + footprint_spec[i].y() * cos_th)
+                  / stamps->resolution;
+        }
+        polygonCells(px, py, 0.5 + FOOTPRINT_STAMP_MARGIN,
+                     FOOTPRINT_STAMP_MARGIN, heading_cells);
+        cells.insert(cells.end(), heading_cells.begin(), heading_cells.end());
+      }
+      sort(cells.begin(), cells.end());
+      cells.erase(unique(cells.begin(), cells.end()), cells.end());
+
+      stamps->begin.push_back(stamps->offsets.size());
+      stamps->min_x[stamp] = stamps->max_x[stamp] = 0;
+      stamps->min_y[stamp] = stamps->max_y[stamp] = 0;
+      for(size_t i = 0; i < cells.size(); i++)
+      {
+        stamps->min_x[stamp] = std::min(stamps->min_x[stamp], cells[i].first);
+        stamps->max_x[stamp] = std::max(stamps->max_x[stamp], cells[i].first);
+        stamps->min_y[stamp] = std::min(stamps->min_y[stamp], cells[i].second);
+        stamps->max_y[stamp] = std::max(stamps->max_y[stamp], cells[i].second);
+        stamps->offsets.push_back(
+            cells[i].second * (int)stamps->size_x + cells[i].first);
+      }
+    }
+    stamps->begin.push_back(stamps->offsets.size());
+
+    stamps->reach = 0;
+    for(int stamp = 0; stamp < count; stamp++)
+      stamps->reach = std::max(
+          stamps->reach,
+          std::max(std::max(-stamps->min_x[stamp], stamps->max_x[stamp]),
+                   std::max(-stamps->min_y[stamp], stamps->max_y[stamp])));
+
+    logInfo<< "costmap model: " << count << " footprint stamps with "
+    << stamps->offsets.size() << " cells";
+    return stamps;
+  }
+
+  double CostmapModel::pointCost(int x, int y)
+  {
+    unsigned char cost = costmap_.getCost(x, y);
+    //if the cell is in an obstacle the path is invalid
+    //if(cost == LETHAL_OBSTACLE){
+    if(cost == LETHAL_OBSTACLE || cost == NO_INFORMATION)
+    {
+      return -1;
+    }
+
+    return cost;
+  }
 
 }
 ;
@@ -1,7 +1,9 @@
 #ifndef _BASE_LOCAL_PLANNER_COSTMAP_MODEL_
 #define _BASE_LOCAL_PLANNER_COSTMAP_MODEL_
 
+#include <boost/shared_ptr.hpp>
 #include "../../../../costmap/costmap_2d/CostMap2D.h"
+#include "../../../../costmap/layers/DistanceLayer.h"
 #include "WorldModel.h"
 #include "log_tool.h"
 namespace NS_Planner
@@ -42,17 +44,58 @@ namespace NS_Planner
                   const std::vector< Point2D >& footprint,
                   double inscribed_radius, double circumscribed_radius);
 
+    /**
+     * @brief  Use the clearance of a distance layer over the same map, the footprint cost is then looked up
+     * once when the clearance alone tells the answer. NULL turns it off
+     * @param  clear_shortcut Let a pose far from obstacles cost what the robot cell costs, which is not the
+     * highest cost under the footprint, only for callers that do not score the cost (occdist_scale 0)
+     */
+    void setDistanceLayer(const NS_CostMap::DistanceLayer* distance_layer, bool clear_shortcut)
+    {
+      distance_layer_ = distance_layer;
+      clear_shortcut_ = clear_shortcut;
+    }
+
+    /**
+     * @brief  Checks the filled footprint at a pose with a stamp precomputed for the nearest discretized heading
+     * and quarter of the cell, the stamps are rebuilt when the footprint or the map width changes, thread safe.
+     * With a distance layer, a pose closer than the inscribed radius is a collision and, if clear_shortcut is set,
+     * a pose clear by more than the circumscribed radius costs what the robot cell costs, all others read a stamp
+     * @param  x The x position of the robot in world coordinates
+     * @param  y The y position of the robot in world coordinates
+     * @param  theta The orientation of the robot
+     * @param  footprint_spec The specification of the footprint of the robot in the robot frame
+     * @return The highest cost under the footprint, negative if a cell is lethal, unknown or off the map
+     */
+    virtual double
+    footprintCost(double x, double y, double theta,
+                  const std::vector< Point2D >& footprint_spec,
+                  double inscribed_radius = 0.0,
+                  double circumscribed_radius = 0.0);
+
   private:
     /**
-     * @brief  Rasterizes a line in the costmap grid and checks for collisions
-     * @param x0 The x position of the first cell in grid coordinates
-     * @param y0 The y position of the first cell in grid coordinates
-     * @param x1 The x position of the second cell in grid coordinates
-     * @param y1 The y position of the second cell in grid coordinates
-     * @return A positive cost for a legal line... negative otherwise
+     * @brief Filled footprint cells of one footprint for every discretized heading and quarter of the robot cell
      */
-    double
-    lineCost(int x0, int x1, int y0, int y1);
+    struct FootprintStamps
+    {
+      std::vector< Point2D > footprint;
+      unsigned int size_x;
+      float resolution;
+      /// cell index offsets from the robot cell, all stamps back to back
+      std::vector< int > offsets;
+      /// first offset of every stamp, plus one past the last
+      std::vector< int > begin;
+      /// cell bounds of every stamp around the robot cell
+      std::vector< int > min_x, max_x, min_y, max_y;
+      /// cells the farthest stamp reaches from the robot cell
+      int reach;
+      double inscribed_radius, circumscribed_radius;
+    };
+    typedef boost::shared_ptr< const FootprintStamps > FootprintStampsPtr;
+
+    FootprintStampsPtr
+    buildStamps(const std::vector< Point2D >& footprint_spec) const;
 
     /**
      * @brief  Checks the cost of a point in the costmap
@@ -65,6 +108,11 @@ namespace NS_Planner
 
     const NS_CostMap::Costmap2D& costmap_; ///< @brief Allows access of costmap obstacle information
 
+    const NS_CostMap::DistanceLayer* distance_layer_; ///< @brief Clearance of the cells of costmap_, may be NULL
+    bool clear_shortcut_; ///< @brief Poses clear of the circumscribed radius skip the stamp
+
+    FootprintStampsPtr stamps_; ///< @brief Only swapped as a whole, read and written with atomic_load / atomic_store
+
   };
 }
 ;
@@ -1,6 +1,8 @@
 #include "MapGrid.h"
 
 #include "../../../../costmap/costmap_2d/CostValues.h"
+#include <algorithm>
+#include <cmath>
 #include <Console/Console.h>
 
 using namespace std;
@@ -9,115 +11,129 @@ namespace NS_Planner
 {
 
   MapGrid::MapGrid()
-      : size_x_(0), size_y_(0)
+      : goal_x_(0), goal_y_(0), origin_x_(0), origin_y_(0), size_x_(0),
+        size_y_(0), times(0), epoch_(1), stride_(0), queue_size_(0)
   {
   }
 
-  MapGrid::MapGrid(unsigned int size_x, unsigned int size_y)
-      : size_x_(size_x), size_y_(size_y)
+  /**
+   * @brief  The costmap cells within half_size meters of a point, clipped to the costmap, a single cell off the map
+   */
+  static void windowCells(const NS_CostMap::Costmap2D& costmap, double x,
+                          double y, double half_size, int& min_x, int& min_y,
+                          int& max_x, int& max_y)
   {
-    commonInit();
-  }
-
-  MapGrid::MapGrid(const MapGrid& mg)
-  {
-    size_y_ = mg.size_y_;
-    size_x_ = mg.size_x_;
-    map_ = mg.map_;
+    //getOriginX() is not const, the center of the first cell is half a cell past the origin
+    double resolution = costmap.getResolution();
+    float origin_x, origin_y;
+    costmap.mapToWorld(0, 0, origin_x, origin_y);
+    origin_x -= resolution / 2;
+    origin_y -= resolution / 2;
+    min_x = (int)floor((x - half_size - origin_x) / resolution);
+    min_y = (int)floor((y - half_size - origin_y) / resolution);
+    max_x = (int)floor((x + half_size - origin_x) / resolution);
+    max_y = (int)floor((y + half_size - origin_y) / resolution);
+
+    min_x = std::max(min_x, 0);
+    min_y = std::max(min_y, 0);
+    max_x = std::min(max_x, (int)costmap.getSizeInCellsX() - 1);
+    max_y = std::min(max_y, (int)costmap.getSizeInCellsY() - 1);
+    if(max_x < min_x || max_y < min_y)
+    {
+      //the robot is off the map, keep a single cell so that every lookup stays valid
+      min_x = max_x = std::min(std::max(min_x, 0),
+                               (int)costmap.getSizeInCellsX() - 1);
+      min_y = max_y = std::min(std::max(min_y, 0),
+                               (int)costmap.getSizeInCellsY() - 1);
+    }
   }
 
-  void MapGrid::commonInit()
+  bool MapGrid::setWindow(const NS_CostMap::Costmap2D& costmap, double x,
+                          double y, double half_size, double margin)
   {
-    //don't allow construction of zero size grid
-    assert(size_y_ != 0 && size_x_ != 0);
-
-    map_.resize(size_y_ * size_x_);
-
-    //make each cell aware of its location in the grid
-    for(unsigned int i = 0; i < size_y_; ++i)
+    int min_x, min_y, max_x, max_y;
+    if(fits(costmap))
     {
-      for(unsigned int j = 0; j < size_x_; ++j)
-      {
-        unsigned int id = size_x_ * i + j;
-        map_[id].cx = j;
-        map_[id].cy = i;
-      }
+      /*
+       * 需要的范围还在窗口内且窗口没有大出太多时保持不动，
+       * 窗口不动，上次算好的距离才可能继续用
+       */
+      windowCells(costmap, x, y, half_size, min_x, min_y, max_x, max_y);
+      double max_cells = 2 * (half_size + margin) / costmap.getResolution() + 2;
+      if(inWindow(min_x, min_y) && inWindow(max_x, max_y)
+          && size_x_ <= max_cells && size_y_ <= max_cells)
+        return false;
     }
-    times = 0;
-  }
 
-  size_t MapGrid::getIndex(int x, int y)
-  {
-    return size_x_ * y + x;
+    windowCells(costmap, x, y, half_size + margin, min_x, min_y, max_x, max_y);
+    origin_x_ = min_x;
+    origin_y_ = min_y;
+    size_x_ = max_x - min_x + 1;
+    size_y_ = max_y - min_y + 1;
+    stride_ = size_x_ + 2;
+    unsigned int cells = stride_ * (size_y_ + 2);
+    if(state_.size() < cells)
+    {
+      target_dist_.resize(cells);
+      state_.assign(cells, 0);
+      queue_.resize(cells);
+      epoch_ = 1;
+    }
+    resetPathDist();
+    return true;
   }
 
-  MapGrid&
-  MapGrid::operator=(const MapGrid& mg)
+  void MapGrid::setWindow(const NS_CostMap::Costmap2D& costmap)
   {
-    size_y_ = mg.size_y_;
-    size_x_ = mg.size_x_;
-    map_ = mg.map_;
-    return *this;
+    unsigned int size_x = costmap.getSizeInCellsX();
+    unsigned int size_y = costmap.getSizeInCellsY();
+    float center_x, center_y;
+    costmap.mapToWorld(size_x / 2, size_y / 2, center_x, center_y);
+    size_x_ = size_y_ = 0;
+    setWindow(costmap, center_x, center_y,
+              std::max(size_x, size_y) * costmap.getResolution(), 0);
   }
 
-  void MapGrid::sizeCheck(unsigned int size_x, unsigned int size_y)
+  void MapGrid::setWithinRobot(unsigned int x, unsigned int y)
   {
-    if(map_.size() != size_x * size_y)
-      map_.resize(size_x * size_y);
-
-    if(size_x_ != size_x || size_y_ != size_y)
+    if(inWindow(x, y))
     {
-      size_x_ = size_x;
-      size_y_ = size_y;
-
-      for(unsigned int i = 0; i < size_y_; ++i)
-      {
-        for(unsigned int j = 0; j < size_x_; ++j)
-        {
-          int index = size_x_ * i + j;
-          map_[index].cx = j;
-          map_[index].cy = i;
-        }
-      }
+      unsigned int index = getIndex(x - origin_x_, y - origin_y_);
+      setFlags(index, WITHIN_ROBOT);
+      robot_cells_.push_back(index);
     }
   }
 
-  inline bool MapGrid::updatePathCell(MapCell* current_cell,
-                                      MapCell* check_cell,
-                                      const NS_CostMap::Costmap2D& costmap)
+  void MapGrid::clearWithinRobot()
   {
-
-    //if the cell is an obstacle set the max path distance
-    unsigned char cost = costmap.getCost(check_cell->cx, check_cell->cy);
-    if(!getCell(check_cell->cx, check_cell->cy).within_robot && (cost == NS_CostMap::LETHAL_OBSTACLE || cost == NS_CostMap::INSCRIBED_INFLATED_OBSTACLE || cost == NS_CostMap::NO_INFORMATION))
+    for(unsigned int i = 0; i < robot_cells_.size(); ++i)
     {
-      check_cell->target_dist = obstacleCosts();
-      return false;
+      if(isCurrent(robot_cells_[i]))
+        state_[robot_cells_[i]] &= ~WITHIN_ROBOT;
     }
-
-    float new_target_dist = current_cell->target_dist + 1;
-    if(new_target_dist < check_cell->target_dist)
-    {
-      check_cell->target_dist = new_target_dist;
-    }
-    return true;
+    robot_cells_.clear();
   }
 
   //reset the path_dist and goal_dist fields for all cells
   void MapGrid::resetPathDist()
   {
-    for(unsigned int i = 0; i < map_.size(); ++i)
+    /*
+     * 只推进纪元，旧纪元的栅格读出来就是重置后的值，写入时再真正重置，
+     * 纪元用完才整体清一次
+     */
+    epoch_++;
+    robot_cells_.clear();
+    if(epoch_ >= 1 << (16 - FLAG_BITS))
     {
-      map_[i].target_dist = unreachableCellCosts();
-      map_[i].target_mark = false;
-      map_[i].within_robot = false;
+      std::fill(state_.begin(), state_.end(), 0);
+      epoch_ = 1;
     }
   }
 
   void MapGrid::adjustPlanResolution(
       const std::vector< Pose2D >& global_plan_in,
       std::vector< Pose2D >& global_plan_out,
-      float resolution)
+      float resolution, std::vector< unsigned int >* plan_index)
   {
     if(global_plan_in.size() == 0)
     {
@@ -125,6 +141,8 @@ namespace NS_Planner
     }
     float last_x = global_plan_in[0].x();
     float last_y = global_plan_in[0].y();
+    if(plan_index)
+      plan_index->push_back(global_plan_out.size());
     global_plan_out.push_back(global_plan_in[0]);
 
     // we can take "holes" in the plan smaller than 2 grid cells (squared = 4)
@@ -153,6 +171,8 @@ namespace NS_Planner
           global_plan_out.push_back(pose);
         }
       }
+      if(plan_index)
+        plan_index->push_back(global_plan_out.size());
       global_plan_out.push_back(global_plan_in[i]);
       last_x = loop_x;
       last_y = loop_y;
@@ -162,37 +182,26 @@ namespace NS_Planner
   //update what map cells are considered path based on the global_plan
   void MapGrid::setTargetCells(
       const NS_CostMap::Costmap2D& costmap,
-      const std::vector< Pose2D >& global_plan)
+      const std::vector< Pose2D >& adjusted_global_plan, unsigned int begin)
   {
-    sizeCheck(costmap.getSizeInCellsX(), costmap.getSizeInCellsY());
+    if(!fits(costmap))
+      setWindow(costmap);
 
     bool started_path = false;
 
-    queue< MapCell* > path_dist_queue;
-
-    std::vector < Pose2D > adjusted_global_plan;
-    adjustPlanResolution(global_plan, adjusted_global_plan,
-                         costmap.getResolution());
+    markBlocked(costmap);
 
-    if(adjusted_global_plan.size() != global_plan.size())
-    {
-      printf("Adjusted global plan resolution, added %zu points\n",
-             adjusted_global_plan.size() - global_plan.size());
-    }
     unsigned int i;
     // put global path points into local map until we reach the border of the local map
-    for(i = 0; i < adjusted_global_plan.size(); ++i)
+    for(i = begin; i < adjusted_global_plan.size(); ++i)
     {
       float g_x = adjusted_global_plan[i].x();
       float g_y = adjusted_global_plan[i].y();
       unsigned int map_x, map_y;
-      if(costmap.worldToMap(g_x, g_y, map_x, map_y) && costmap.getCost(map_x,
-                                                                       map_y) != NS_CostMap::NO_INFORMATION)
+      if(costmap.worldToMap(g_x, g_y, map_x, map_y) && inWindow(map_x, map_y)
+          && costmap.getCost(map_x, map_y) != NS_CostMap::NO_INFORMATION)
       {
-        MapCell& current = getCell(map_x, map_y);
-        current.target_dist = 0.0;
-        current.target_mark = true;
-        path_dist_queue.push(&current);
+        addSeed(getIndex(map_x - origin_x_, map_y - origin_y_));
         started_path = true;
       }
       else if(started_path)
@@ -203,40 +212,59 @@ namespace NS_Planner
     if(!started_path)
     {
       printf(
-          "None of the %d first of %zu (%zu) points of the global plan were in the local costmap and free\n",
-          i, adjusted_global_plan.size(), global_plan.size());
+          "None of the %d first of %zu points of the global plan were in the local costmap and free\n",
+          i - begin, adjusted_global_plan.size() - begin);
       return;
     }
 
-    computeTargetDistance(path_dist_queue, costmap);
+    computeTargetDistance();
   }
 
   //mark the point of the costmap as local goal where global_plan first leaves the area (or its last point)
   void MapGrid::setLocalGoal(
       const NS_CostMap::Costmap2D& costmap,
-      const std::vector< Pose2D >& global_plan)
+      const std::vector< Pose2D >& adjusted_global_plan, unsigned int begin)
   {
-    sizeCheck(costmap.getSizeInCellsX(), costmap.getSizeInCellsY());
+    if(!fits(costmap))
+      setWindow(costmap);
 
-    int local_goal_x = -1;
-    int local_goal_y = -1;
-    bool started_path = false;
+    int local_goal_x, local_goal_y;
+    if(!findLocalGoal(costmap, adjusted_global_plan, begin, local_goal_x,
+                      local_goal_y))
+    {
+      printf(
+          "None of the points of the global plan were in the local costmap, global plan points too far from robot\n");
+      return;
+    }
 
-    std::vector < Pose2D > adjusted_global_plan;
-    adjustPlanResolution(global_plan, adjusted_global_plan,
-                         costmap.getResolution());
+    setLocalGoal(costmap, local_goal_x, local_goal_y);
+  }
+
+  bool MapGrid::findLocalGoal(
+      const NS_CostMap::Costmap2D& costmap,
+      const std::vector< Pose2D >& adjusted_global_plan, unsigned int begin,
+      int& local_goal_x, int& local_goal_y) const
+  {
+    local_goal_x = -1;
+    local_goal_y = -1;
+    bool started_path = false;
 
     // skip global path points until we reach the border of the local map
-    for(unsigned int i = 0; i < adjusted_global_plan.size(); ++i)
+    for(unsigned int i = begin; i < adjusted_global_plan.size(); ++i)
     {
       float g_x = adjusted_global_plan[i].x();
       float g_y = adjusted_global_plan[i].y();
       unsigned int map_x, map_y;
-      if(costmap.worldToMap(g_x, g_y, map_x, map_y) && costmap.getCost(map_x,
-                                                                       map_y) != NS_CostMap::NO_INFORMATION)
+      unsigned char cost;
+      if(costmap.worldToMap(g_x, g_y, map_x, map_y) && inWindow(map_x, map_y)
+          && (cost = costmap.getCost(map_x, map_y)) != NS_CostMap::NO_INFORMATION)
       {
-        local_goal_x = map_x;
-        local_goal_y = map_y;
+        //the edge of the window may cut the plan where it passes an obstacle, the goal wave could not leave such a cell
+        if(cost < NS_CostMap::INSCRIBED_INFLATED_OBSTACLE)
+        {
+          local_goal_x = map_x;
+          local_goal_y = map_y;
+        }
         started_path = true;
       }
       else
@@ -247,92 +275,94 @@ namespace NS_Planner
         } // else we might have a non pruned path, so we just continue
       }
     }
-    if(!started_path)
-    {
-      printf(
-          "None of the points of the global plan were in the local costmap, global plan points too far from robot\n");
-      return;
-    }
+    return started_path;
+  }
 
-    queue< MapCell* > path_dist_queue;
+  void MapGrid::setLocalGoal(const NS_CostMap::Costmap2D& costmap,
+                             int local_goal_x, int local_goal_y)
+  {
+    markBlocked(costmap);
     if(local_goal_x >= 0 && local_goal_y >= 0)
     {
-      MapCell& current = getCell(local_goal_x, local_goal_y);
       costmap.mapToWorld(local_goal_x, local_goal_y, goal_x_, goal_y_);
-      current.target_dist = 0.0;
-      current.target_mark = true;
-      path_dist_queue.push(&current);
+      addSeed(getIndex(local_goal_x - origin_x_, local_goal_y - origin_y_));
     }
 
-    computeTargetDistance(path_dist_queue, costmap);
+    computeTargetDistance();
   }
 
-  void MapGrid::computeTargetDistance(queue< MapCell* >& dist_queue,
-                                      const NS_CostMap::Costmap2D& costmap)
+  void MapGrid::markBlocked(const NS_CostMap::Costmap2D& costmap)
   {
-    MapCell* current_cell;
-    MapCell* check_cell;
-    unsigned int last_col = size_x_ - 1;
-    unsigned int last_row = size_y_ - 1;
-    while(!dist_queue.empty())
+    unsigned short current = epoch_ << FLAG_BITS;
+    //the border reads as visited, the wavefront never steps on it
+    unsigned short border = current | TARGET_MARK;
+    unsigned int last_row = stride_ * (size_y_ + 1);
+    for(unsigned int x = 0; x < stride_; ++x)
     {
-      current_cell = dist_queue.front();
-
-      dist_queue.pop();
-
-      if(current_cell->cx > 0)
-      {
-        check_cell = current_cell - 1;
-        if(!check_cell->target_mark)
-        {
-          //mark the cell as visisted
-          check_cell->target_mark = true;
-          if(updatePathCell(current_cell, check_cell, costmap))
-          {
-            dist_queue.push(check_cell);
-          }
-        }
-      }
-
-      if(current_cell->cx < last_col)
-      {
-        check_cell = current_cell + 1;
-        if(!check_cell->target_mark)
-        {
-          check_cell->target_mark = true;
-          if(updatePathCell(current_cell, check_cell, costmap))
-          {
-            dist_queue.push(check_cell);
-          }
-        }
-      }
+      state_[x] = border;
+      state_[last_row + x] = border;
+    }
 
-      if(current_cell->cy > 0)
+    const unsigned char* costs = costmap.getCharMap();
+    for(unsigned int y = 0; y < size_y_; ++y)
+    {
+      const unsigned char* row = costs
+          + costmap.getIndex(origin_x_, origin_y_ + y);
+      unsigned int index = getIndex(0, y);
+      state_[index - 1] = border;
+      state_[index + size_x_] = border;
+      for(unsigned int x = 0; x < size_x_; ++x, ++index)
       {
-        check_cell = current_cell - size_x_;
-        if(!check_cell->target_mark)
-        {
-          check_cell->target_mark = true;
-          if(updatePathCell(current_cell, check_cell, costmap))
-          {
-            dist_queue.push(check_cell);
-          }
-        }
+        //only the footprint marks are kept, the wavefront starts over
+        unsigned short state = current;
+        if(isCurrent(index))
+          state |= state_[index] & WITHIN_ROBOT;
+        target_dist_[index] = unreachableCellCosts();
+
+        //an obstacle inside the footprint does not stop the wavefront, the robot is already there
+        unsigned char cost = row[x];
+        if(!(state & WITHIN_ROBOT) && (cost == NS_CostMap::LETHAL_OBSTACLE || cost == NS_CostMap::INSCRIBED_INFLATED_OBSTACLE || cost == NS_CostMap::NO_INFORMATION))
+          state |= BLOCKED;
+        state_[index] = state;
       }
+    }
+  }
 
-      if(current_cell->cy < last_row)
+  void MapGrid::computeTargetDistance()
+  {
+    /*
+     * 每个栅格至多入队一次，队列就是一段预先分配好的数组；窗口外一圈边框
+     * 已标记为访问过，四个邻居不需要判断越界，障碍只看 markBlocked 记下的标志
+     */
+    unsigned int* queue = queue_.empty() ? NULL : &queue_[0];
+    unsigned short* state = &state_[0];
+    float* target_dist = &target_dist_[0];
+    const int offsets[4] = {-1, 1, -(int)stride_, (int)stride_};
+    float obstacle_costs = obstacleCosts();
+
+    for(unsigned int head = 0; head < queue_size_; ++head)
+    {
+      unsigned int current_cell = queue[head];
+      float new_target_dist = target_dist[current_cell] + 1;
+      for(int i = 0; i < 4; ++i)
       {
-        check_cell = current_cell + size_x_;
-        if(!check_cell->target_mark)
+        unsigned int check_cell = current_cell + offsets[i];
+        unsigned short check_state = state[check_cell];
+        if(check_state & TARGET_MARK)
+          continue;
+        //mark the cell as visisted
+        state[check_cell] = check_state | TARGET_MARK;
+        //if the cell is an obstacle set the max path distance
+        if(check_state & BLOCKED)
         {
-          check_cell->target_mark = true;
-          if(updatePathCell(current_cell, check_cell, costmap))
-          {
-            dist_queue.push(check_cell);
-          }
+          target_dist[check_cell] = obstacle_costs;
+          continue;
         }
+        target_dist[check_cell] = new_target_dist;
+        queue[queue_size_++] = check_cell;
       }
     }
+    queue_size_ = 0;
   }
 
 }
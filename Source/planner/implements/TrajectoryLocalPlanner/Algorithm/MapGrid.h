@@ -3,187 +3,260 @@
 
 #include <vector>
 #include <iostream>
-#include "MapCell.h"
 #include "../../../../costmap/costmap_2d/CostMap2D.h"
 #include <transform/transform2d.h>
-#include "MapCell.h"
 
 
 namespace NS_Planner
 {
   /**
    * @class MapGrid
-   * @brief A grid of MapCell cells that is used to propagate path and goal distances for the trajectory controller.
+   * @brief A window of the costmap around the robot that is used to propagate path and goal distances for the trajectory controller.
+   * The cells are stored as separate arrays, a reset only starts a new epoch and a cell of an older epoch reads as reset.
+   * The arrays have a border of one cell around the window so that the wavefront needs no bounds checks
    */
   class MapGrid
   {
   public:
     /**
-     * @brief  Creates a 0x0 map by default
+     * @brief  Creates an empty window by default, setTargetCells and setLocalGoal then cover the whole costmap
      */
     MapGrid();
 
     /**
-     * @brief  Creates a map of size_x by size_y
-     * @param size_x The width of the map 
-     * @param size_y The height of the map 
+     * @brief  Destructor for a MapGrid
      */
-    MapGrid(unsigned int size_x, unsigned int size_y);
+    ~MapGrid()
+    {
+    }
 
     /**
-     * @brief  Returns a map cell accessed by (col, row)
-     * @param x The x coordinate of the cell 
-     * @param y The y coordinate of the cell 
-     * @return A reference to the desired cell
+     * @brief  Keep the window while it covers the cells within half_size meters of a point, otherwise place it over
+     * the cells within half_size + margin meters, clipped to the costmap, and reset it
+     * @param costmap The costmap the window is a part of
+     * @param x The x coordinate of the center in world coordinates
+     * @param y The y coordinate of the center in world coordinates
+     * @param half_size Half the side of the square that has to be covered in meters
+     * @param margin How much farther the window reaches when it is placed
+     * @return True if the window was placed and reset
      */
-    inline MapCell&
-    operator()(unsigned int x, unsigned int y)
-    {
-      return map_[size_x_ * y + x];
-    }
+    bool
+    setWindow(const NS_CostMap::Costmap2D& costmap, double x, double y,
+              double half_size, double margin);
 
     /**
-     * @brief  Returns a map cell accessed by (col, row)
-     * @param x The x coordinate of the cell 
-     * @param y The y coordinate of the cell 
-     * @return A copy of the desired cell
+     * @brief  Place the window over the whole costmap and reset it
      */
-    inline MapCell operator()(unsigned int x, unsigned int y) const
-    {
-      return map_[size_x_ * y + x];
-    }
+    void
+    setWindow(const NS_CostMap::Costmap2D& costmap);
 
-    inline MapCell&
-    getCell(unsigned int x, unsigned int y)
+    /**
+     * @brief  Whether the window is placed and lies inside the costmap
+     */
+    inline bool fits(const NS_CostMap::Costmap2D& costmap) const
     {
-      return map_[size_x_ * y + x];
+      return size_x_ > 0 && size_y_ > 0
+          && origin_x_ + size_x_ <= costmap.getSizeInCellsX()
+          && origin_y_ + size_y_ <= costmap.getSizeInCellsY();
     }
 
     /**
-     * @brief  Destructor for a MapGrid
+     * @brief  Whether a costmap cell lies inside the window
      */
-    ~MapGrid()
+    inline bool inWindow(unsigned int x, unsigned int y) const
     {
+      return x - origin_x_ < size_x_ && y - origin_y_ < size_y_;
     }
 
     /**
-     * @brief  Copy constructor for a MapGrid
-     * @param mg The MapGrid to copy 
+     * @brief  Returns the distance propagated to a costmap cell, unreachableCellCosts() outside the window
+     * @param x The x coordinate of the cell in the costmap
+     * @param y The y coordinate of the cell in the costmap
      */
-    MapGrid(const MapGrid& mg);
+    inline float getTargetDist(unsigned int x, unsigned int y) const
+    {
+      if(!inWindow(x, y))
+        return unreachableCellCosts();
+      unsigned int index = getIndex(x - origin_x_, y - origin_y_);
+      return isCurrent(index) ? target_dist_[index] : unreachableCellCosts();
+    }
 
     /**
-     * @brief  Assignment operator for a MapGrid
-     * @param mg The MapGrid to assign from 
+     * @brief  Whether a costmap cell was marked as within the robot footprint since the last reset
      */
-    MapGrid&
-    operator=(const MapGrid& mg);
+    inline bool isWithinRobot(unsigned int x, unsigned int y) const
+    {
+      return inWindow(x, y)
+          && (getFlags(getIndex(x - origin_x_, y - origin_y_)) & WITHIN_ROBOT);
+    }
 
     /**
-     * @brief reset path distance fields for all cells
+     * @brief  Mark a costmap cell as within the robot footprint, cells outside the window are ignored
      */
     void
-    resetPathDist();
+    setWithinRobot(unsigned int x, unsigned int y);
 
     /**
-     * @brief  check if we need to resize
-     * @param size_x The desired width
-     * @param size_y The desired height
+     * @brief  Unmark the cells marked with setWithinRobot since the last reset, the distances are kept
      */
     void
-    sizeCheck(unsigned int size_x, unsigned int size_y);
+    clearWithinRobot();
 
     /**
-     * @brief Utility to share initialization code across constructors
+     * @brief reset path distance fields for all cells
      */
     void
-    commonInit();
-
-    /**
-     * @brief  Returns a 1D index into the MapCell array for a 2D index
-     * @param x The desired x coordinate
-     * @param y The desired y coordinate
-     * @return The associated 1D index 
-     */
-    size_t
-    getIndex(int x, int y);
+    resetPathDist();
 
     /**
      * return a value that indicates cell is in obstacle
      */
-    inline float obstacleCosts()
+    inline float obstacleCosts() const
     {
-      return map_.size();
+      return size_x_ * size_y_;
     }
 
     /**
      * returns a value indicating cell was not reached by wavefront
      * propagation of set cells. (is behind walls, regarding the region covered by grid)
      */
-    inline float unreachableCellCosts()
+    inline float unreachableCellCosts() const
     {
-      return map_.size() + 1;
+      return size_x_ * size_y_ + 1;
     }
 
-    /**
-     * @brief  Used to update the distance of a cell in path distance computation
-     * @param  current_cell The cell we're currently in 
-     * @param  check_cell The cell to be updated
-     */
-    inline bool
-    updatePathCell(MapCell* current_cell, MapCell* check_cell,
-                   const NS_CostMap::Costmap2D& costmap);
-
     /**
      * increase global plan resolution to match that of the costmap by adding points linearly between global plan points
      * This is necessary where global planners produce plans with few points.
      * @param global_plan_in input
      * @param global_plan_output output
      * @param resolution desired distance between waypoints
+     * @param plan_index If not NULL, receives the index in global_plan_out of every point of global_plan_in
      */
     static void
     adjustPlanResolution(
         const std::vector< Pose2D >& global_plan_in,
         std::vector< Pose2D >& global_plan_out,
-        float resolution);
+        float resolution, std::vector< unsigned int >* plan_index = NULL);
 
     /**
-     * @brief  Compute the distance from each cell in the local map grid to the planned path
-     * @param dist_queue A queue of the initial cells on the path 
+     * @brief Update what cells are considered path based on the part of the global plan in the window
+     * @param adjusted_global_plan The global plan at the resolution of the costmap, see adjustPlanResolution
+     * @param begin The first point of adjusted_global_plan to use
      */
     void
-    computeTargetDistance(std::queue< MapCell* >& dist_queue,
-                          const NS_CostMap::Costmap2D& costmap);
+    setTargetCells(const NS_CostMap::Costmap2D& costmap,
+                   const std::vector< Pose2D >& adjusted_global_plan,
+                   unsigned int begin = 0);
 
     /**
-     * @brief  Compute the distance from each cell in the local map grid to the local goal point
-     * @param goal_queue A queue containing the local goal cell 
+     * @brief Update what cell is considered the next local goal, where the global plan first leaves the window
+     * @param adjusted_global_plan The global plan at the resolution of the costmap, see adjustPlanResolution
+     * @param begin The first point of adjusted_global_plan to use
      */
     void
-    computeGoalDistance(std::queue< MapCell* >& dist_queue,
-                        const NS_CostMap::Costmap2D& costmap);
+    setLocalGoal(const NS_CostMap::Costmap2D& costmap,
+                 const std::vector< Pose2D >& adjusted_global_plan,
+                 unsigned int begin = 0);
 
     /**
-     * @brief Update what cells are considered path based on the global plan 
+     * @brief Find the cell setLocalGoal would start the goal wave from
+     * @param local_goal_x Set to the x coordinate of the cell in the costmap, -1 if every cell in reach is blocked
+     * @param local_goal_y Set to the y coordinate of the cell in the costmap, -1 if every cell in reach is blocked
+     * @return False if no point of the plan is in the window
      */
-    void
-    setTargetCells(const NS_CostMap::Costmap2D& costmap,
-                   const std::vector< Pose2D >& global_plan);
+    bool
+    findLocalGoal(const NS_CostMap::Costmap2D& costmap,
+                  const std::vector< Pose2D >& adjusted_global_plan,
+                  unsigned int begin, int& local_goal_x,
+                  int& local_goal_y) const;
 
     /**
-     * @brief Update what cell is considered the next local goal
+     * @brief Propagate the goal distance from a cell found with findLocalGoal, nothing is propagated from -1
      */
     void
-    setLocalGoal(const NS_CostMap::Costmap2D& costmap,
-                 const std::vector< Pose2D >& global_plan);
+    setLocalGoal(const NS_CostMap::Costmap2D& costmap, int local_goal_x,
+                 int local_goal_y);
 
     float goal_x_, goal_y_; /**< @brief The goal distance was last computed from */
 
-    unsigned int size_x_, size_y_; ///< @brief The dimensions of the grid
+    unsigned int origin_x_, origin_y_; ///< @brief The costmap cell of the first cell of the window
+    unsigned int size_x_, size_y_; ///< @brief The dimensions of the window
     int times;
   private:
+    /// flags of a cell, the bits above them hold the epoch the cell was last written in
+    enum
+    {
+      TARGET_MARK = 1, ///< Marks for computing path/goal distances
+      WITHIN_ROBOT = 2, ///< Mark for cells within the robot footprint
+      BLOCKED = 4, ///< The wavefront stops at the cell, set by markBlocked
+      FLAG_BITS = 3
+    };
+
+    /**
+     * @brief  Returns a 1D index into the bordered arrays for a 2D index relative to the window
+     */
+    inline unsigned int getIndex(unsigned int x, unsigned int y) const
+    {
+      return stride_ * (y + 1) + x + 1;
+    }
+
+    inline bool isCurrent(unsigned int index) const
+    {
+      return (state_[index] >> FLAG_BITS) == epoch_;
+    }
+
+    inline unsigned short getFlags(unsigned int index) const
+    {
+      return isCurrent(index) ? state_[index] & ((1 << FLAG_BITS) - 1) : 0;
+    }
+
+    /**
+     * @brief  Set flags of a cell, a cell of an older epoch is reset first
+     */
+    inline void setFlags(unsigned int index, unsigned short flags)
+    {
+      if(!isCurrent(index))
+      {
+        target_dist_[index] = unreachableCellCosts();
+        state_[index] = epoch_ << FLAG_BITS;
+      }
+      state_[index] |= flags;
+    }
+
+    /**
+     * @brief  Reset the distances of the window keeping the footprint marks, set BLOCKED from the costmap
+     * and mark the border as visited so that the wavefront never leaves the window
+     */
+    void
+    markBlocked(const NS_CostMap::Costmap2D& costmap);
+
+    /**
+     * @brief  Start the wavefront from a cell, after markBlocked
+     */
+    inline void addSeed(unsigned int index)
+    {
+      if(state_[index] & TARGET_MARK)
+        return;
+      state_[index] |= TARGET_MARK;
+      target_dist_[index] = 0.0;
+      queue_[queue_size_++] = index;
+    }
+
+    /**
+     * @brief  Compute the distance from each cell in the window to the seeds
+     */
+    void
+    computeTargetDistance();
+
+    std::vector< float > target_dist_; ///< @brief Distance to the planner's path or goal
+    std::vector< unsigned short > state_; ///< @brief Epoch and flags of every cell
+    unsigned short epoch_;
+    unsigned int stride_; ///< @brief Row length of the bordered arrays
 
-    std::vector< MapCell > map_; ///< @brief Storage for the MapCells
+    std::vector< unsigned int > queue_; ///< @brief The wavefront, every cell enters it at most once
+    unsigned int queue_size_;
+    std::vector< unsigned int > robot_cells_; ///< @brief Cells marked with setWithinRobot since the last reset
 
   };
 }
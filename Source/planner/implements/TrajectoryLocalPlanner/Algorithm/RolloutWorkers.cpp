@@ -0,0 +1,97 @@
+#include "RolloutWorkers.h"
+
+#include <algorithm>
+
+namespace NS_Planner
+{
+  /// indices taken at once, rollouts differ a lot in length so keep it small
+  static const int ROLLOUT_CHUNK = 4;
+
+  RolloutWorkers::RolloutWorkers(int threads)
+      : task_(NULL), count_(0), next_(0), generation_(0), busy_(0),
+        quit_(false)
+  {
+    if(threads <= 0)
+      threads = std::max(1u, boost::thread::hardware_concurrency());
+    for(int i = 1; i < threads; i++)
+      threads_.push_back(
+          new boost::thread(boost::bind(&RolloutWorkers::workerLoop, this, i)));
+  }
+
+  RolloutWorkers::~RolloutWorkers()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      quit_ = true;
+      start_cond_.notify_all();
+    }
+    for(size_t i = 0; i < threads_.size(); i++)
+    {
+      threads_[i]->join();
+      delete threads_[i];
+    }
+  }
+
+  void RolloutWorkers::run(int count, const Task& task)
+  {
+    if(threads_.empty() || count <= ROLLOUT_CHUNK)
+    {
+      for(int i = 0; i < count; i++)
+        task(0, i);
+      return;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_ = 0;
+      busy_ = threads_.size();
+      generation_++;
+      start_cond_.notify_all();
+    }
+
+    work(0);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    while(busy_ > 0)
+      done_cond_.wait(lock);
+    task_ = NULL;
+  }
+
+  void RolloutWorkers::work(int worker)
+  {
+    for(;;)
+    {
+      int first = next_.fetch_add(ROLLOUT_CHUNK);
+      if(first >= count_)
+        break;
+      int last = std::min(first + ROLLOUT_CHUNK, count_);
+      for(int i = first; i < last; i++)
+        (*task_)(worker, i);
+    }
+  }
+
+  void RolloutWorkers::workerLoop(int worker)
+  {
+    unsigned int seen = 0;
+    for(;;)
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while(!quit_ && generation_ == seen)
+          start_cond_.wait(lock);
+        if(quit_)
+          return;
+        seen = generation_;
+      }
+
+      work(worker);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      if(--busy_ == 0)
+        done_cond_.notify_one();
+    }
+  }
+}
+;
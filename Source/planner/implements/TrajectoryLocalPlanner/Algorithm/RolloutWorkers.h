@@ -0,0 +1,64 @@
+#ifndef _BASE_LOCAL_PLANNER_ROLLOUT_WORKERS_H_
+#define _BASE_LOCAL_PLANNER_ROLLOUT_WORKERS_H_
+
+#include <vector>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+
+namespace NS_Planner
+{
+  /**
+   * @class RolloutWorkers
+   * @brief A persistent pool of threads that runs the trajectory samples of
+   * one control cycle in parallel, the calling thread is worker 0
+   */
+  class RolloutWorkers
+  {
+  public:
+    /**
+     * @brief Called once for every index, worker is in [0, size())
+     */
+    typedef boost::function< void(int worker, int index) > Task;
+
+    /**
+     * @param threads Number of workers including the caller, 0 for one per core
+     */
+    RolloutWorkers(int threads);
+
+    ~RolloutWorkers();
+
+    int size() const
+    {
+      return (int)threads_.size() + 1;
+    }
+
+    /**
+     * @brief Run task for every index in [0, count), returns when all are done
+     */
+    void
+    run(int count, const Task& task);
+
+  private:
+    void
+    workerLoop(int worker);
+
+    void
+    work(int worker);
+
+    std::vector< boost::thread* > threads_;
+    boost::mutex mutex_;
+    boost::condition_variable start_cond_, done_cond_;
+
+    const Task* task_;
+    int count_;
+    std::atomic< int > next_;
+    /// bumped for every run so that each worker joins it once
+    unsigned int generation_;
+    int busy_;
+    bool quit_;
+  };
+}
+;
+#endif
@@ -41,10 +41,12 @@
 #include <string>
 #include <sstream>
 #include <math.h>
+#include <algorithm>
 
 #include <boost/algorithm/string.hpp>
 
 #include <Console/Console.h>
+#include <Time/Time.h>
 
 //for computing path distance
 #include <queue>
@@ -54,6 +56,9 @@ using namespace NS_CostMap;
 
 namespace NS_Planner {
 
+//meters the path and goal distance window extends past where the rollouts can reach when it is placed
+static const double LOCAL_WINDOW_MARGIN = 1.0;
+
 TrajectoryPlanner::TrajectoryPlanner(WorldModel& world_model,
 		const Costmap2D& costmap, std::vector<Point2D> footprint_spec,
 		double acc_lim_x, double acc_lim_y, double acc_lim_theta,
@@ -68,27 +73,51 @@ TrajectoryPlanner::TrajectoryPlanner(WorldModel& world_model,
 		bool meter_scoring, bool simple_attractor, vector<double> y_vels,
 		double stop_time_buffer, double sim_period,
 		double angular_sim_granularity, double circums_radius,
-		double inscribe_radius) :
-		path_map_(costmap.getSizeInCellsX(), costmap.getSizeInCellsY()), goal_map_(
-				costmap.getSizeInCellsX(), costmap.getSizeInCellsY()), costmap_(
-				costmap), world_model_(world_model), footprint_spec_(
-				footprint_spec), sim_time_(sim_time), sim_granularity_(
-				sim_granularity), angular_sim_granularity_(
-				angular_sim_granularity), vx_samples_(vx_samples), vtheta_samples_(
-				vtheta_samples), pdist_scale_(pdist_scale), gdist_scale_(
-				gdist_scale), occdist_scale_(occdist_scale), acc_lim_x_(
-				acc_lim_x), acc_lim_y_(acc_lim_y), acc_lim_theta_(
-				acc_lim_theta), prev_x_(0), prev_y_(0), escape_x_(0), escape_y_(
-				0), escape_theta_(0), heading_lookahead_(heading_lookahead), oscillation_reset_dist_(
-				oscillation_reset_dist), escape_reset_dist_(escape_reset_dist), escape_reset_theta_(
-				escape_reset_theta), holonomic_robot_(holonomic_robot), max_vel_x_(
-				max_vel_x), min_vel_x_(min_vel_x), max_vel_th_(max_vel_th), min_vel_th_(
-				min_vel_th), min_in_place_vel_th_(min_in_place_vel_th), backup_vel_(
-				backup_vel), dwa_(dwa), heading_scoring_(heading_scoring), heading_scoring_timestep_(
-				heading_scoring_timestep), simple_attractor_(simple_attractor), y_vels_(
-				y_vels), stop_time_buffer_(stop_time_buffer), sim_period_(
-				sim_period), inscribed_radius_(inscribe_radius), circumscribed_radius_(
-				circums_radius) {
+		double inscribe_radius, int rollout_threads) :
+		costmap_(costmap), world_model_(world_model), footprint_spec_(
+				footprint_spec), plan_version_(0), plan_pruned_(0), adjusted_resolution_(
+				0), layered_costmap_(NULL), path_valid_(false), goal_valid_(false), prev_x_(
+				0), prev_y_(0), escape_x_(0), escape_y_(0), escape_theta_(0), inscribed_radius_(
+				inscribe_radius), circumscribed_radius_(circums_radius), workers_(
+				rollout_threads), forward_best_(-1.0), last_best_vx_(0), last_best_vtheta_(
+				0), last_best_valid_(false), rollout_time_(0), rollout_cycles_(0), rollout_steps_(
+				0), rollout_pruned_(0), primitive_lookups_(0), primitive_hits_(0), path_updates_(
+				0), goal_updates_(0), heading_x_(0), heading_y_(0), heading_size_(0) {
+	TrajectoryPlannerConfig config;
+	config.acc_lim_x = acc_lim_x;
+	config.acc_lim_y = acc_lim_y;
+	config.acc_lim_theta = acc_lim_theta;
+	config.sim_time = sim_time;
+	config.sim_granularity = sim_granularity;
+	config.angular_sim_granularity = angular_sim_granularity;
+	config.vx_samples = vx_samples;
+	config.vtheta_samples = vtheta_samples;
+	config.pdist_scale = pdist_scale;
+	config.gdist_scale = gdist_scale;
+	config.occdist_scale = occdist_scale;
+	config.heading_lookahead = heading_lookahead;
+	config.oscillation_reset_dist = oscillation_reset_dist;
+	config.escape_reset_dist = escape_reset_dist;
+	config.escape_reset_theta = escape_reset_theta;
+	config.holonomic_robot = holonomic_robot;
+	config.max_vel_x = max_vel_x;
+	config.min_vel_x = min_vel_x;
+	config.max_vel_th = max_vel_th;
+	config.min_vel_th = min_vel_th;
+	config.min_in_place_vel_th = min_in_place_vel_th;
+	config.backup_vel = backup_vel;
+	config.dwa = dwa;
+	config.heading_scoring = heading_scoring;
+	config.heading_scoring_timestep = heading_scoring_timestep;
+	config.simple_attractor = simple_attractor;
+	config.y_vels = y_vels;
+	config.stop_time_buffer = stop_time_buffer;
+	config.sim_period = sim_period;
+	config.primitive_cache = false;
+	config.primitive_vel_bin = 0.01;
+	config.primitive_theta_bin = 0.02;
+	reconfigure(config);
+
 	//the robot is not stuck to begin with
 	stuck_left = false;
 	stuck_right = false;
@@ -102,6 +131,9 @@ TrajectoryPlanner::TrajectoryPlanner(WorldModel& world_model,
 	escaping_ = false;
 	final_goal_position_valid_ = false;
 
+	worker_trajs_.resize(workers_.size());
+	logInfo<< "trajectory rollout on "<<workers_.size()<<" threads";
+
 	logInfo<<
 	"initial trajectory planner inscribed_raidus = "<<inscribed_radius_<< " and circumstance_radius = "<<circumscribed_radius_;
 //    NS_CostMap::calculateMinAndMaxDistances(footprint_spec_, inscribed_radius_,
@@ -111,36 +143,46 @@ TrajectoryPlanner::TrajectoryPlanner(WorldModel& world_model,
 TrajectoryPlanner::~TrajectoryPlanner() {
 }
 
+void TrajectoryPlanner::reconfigure(const TrajectoryPlannerConfig& config) {
+	TrajectoryPlannerConfigPtr snapshot(new TrajectoryPlannerConfig(config));
+	boost::atomic_store(&config_, snapshot);
+}
+
+TrajectoryPlannerConfigPtr TrajectoryPlanner::getConfig() const {
+	return boost::atomic_load(&config_);
+}
+
 bool TrajectoryPlanner::getCellCosts(int cx, int cy, float &path_cost,
 		float &goal_cost, float &occ_cost, float &total_cost) {
-	MapCell cell = path_map_(cx, cy);
-	MapCell goal_cell = goal_map_(cx, cy);
-	if (cell.within_robot) {
+	TrajectoryPlannerConfigPtr config = getConfig();
+	const TrajectoryPlannerConfig& cfg = *config;
+	if (path_map_.isWithinRobot(cx, cy)) {
 		return false;
 	}
+	float target_dist = path_map_.getTargetDist(cx, cy);
 	occ_cost = costmap_.getCost(cx, cy);
-	if (cell.target_dist == path_map_.obstacleCosts()
-			|| cell.target_dist == path_map_.unreachableCellCosts()
+	if (target_dist == path_map_.obstacleCosts()
+			|| target_dist == path_map_.unreachableCellCosts()
 			|| occ_cost >= NS_CostMap::INSCRIBED_INFLATED_OBSTACLE) {
 		return false;
 	}
-	path_cost = cell.target_dist;
-	goal_cost = goal_cell.target_dist;
-	total_cost = pdist_scale_ * path_cost + gdist_scale_ * goal_cost
-			+ occdist_scale_ * occ_cost;
+	path_cost = target_dist;
+	goal_cost = goal_map_.getTargetDist(cx, cy);
+	total_cost = cfg.pdist_scale * path_cost + cfg.gdist_scale * goal_cost
+			+ cfg.occdist_scale * occ_cost;
 	return true;
 }
 
 /**
  * create and score a trajectory given the current pose of the robot and selected velocities
  */
-void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
+int TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 		double vx, double vy, double vtheta, double vx_samp, double vy_samp,
 		double vtheta_samp, double acc_x, double acc_y, double acc_theta,
-		double impossible_cost, Trajectory& traj) {
-
-	// make sure the configuration doesn't change mid run
-	boost::mutex::scoped_lock l(configuration_mutex_);
+		double impossible_cost, Trajectory& traj,
+		const TrajectoryPlannerConfig& cfg,
+		const std::atomic<double>* cost_bound,
+		TrajectoryPrimitive* primitive) {
 
 	double x_i = x;
 	double y_i = y;
@@ -157,12 +199,12 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 
 	//compute the number of steps we must take along this trajectory to be "safe"
 	int num_steps;
-	if (!heading_scoring_) {
+	if (!cfg.heading_scoring) {
 		num_steps = int(
-				max((vmag * sim_time_) / sim_granularity_,
-						fabs(vtheta_samp) / angular_sim_granularity_) + 0.5);
+				max((vmag * cfg.sim_time) / cfg.sim_granularity,
+						fabs(vtheta_samp) / cfg.angular_sim_granularity) + 0.5);
 	} else {
-		num_steps = int(sim_time_ / sim_granularity_ + 0.5);
+		num_steps = int(cfg.sim_time / cfg.sim_granularity + 0.5);
 	}
 
 	//we at least want to take one step... even if we won't move, we want to score our current position
@@ -170,7 +212,15 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 		num_steps = 1;
 	}
 
-	double dt = sim_time_ / num_steps;
+	//a primitive brings its own poses, they only need to be moved to where the robot is
+	double cos_th = 0.0, sin_th = 0.0;
+	if (primitive) {
+		num_steps = primitive->x.size();
+		cos_th = cos(theta);
+		sin_th = sin(theta);
+	}
+
+	double dt = cfg.sim_time / num_steps;
 	double time = 0.0;
 
 	//create a potential trajectory
@@ -186,23 +236,38 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 	double occ_cost = 0.0;
 	double heading_diff = 0.0;
 
+	/*
+	 * occ_cost 只会变大；heading 评分时 path/goal/heading 在评分时刻之后不再改变。
+	 * 已知部分的代价已经超过当前最优时，这条轨迹不可能被选中，提前结束
+	 */
+	bool scored = false;
+
 	for (int i = 0; i < num_steps; ++i) {
 		//get map coordinates of a point
 		unsigned int cell_x, cell_y;
 
+		if (primitive) {
+			x_i = x + primitive->x[i] * cos_th - primitive->y[i] * sin_th;
+			y_i = y + primitive->x[i] * sin_th + primitive->y[i] * cos_th;
+			theta_i = theta + primitive->theta[i];
+		}
+
 		//we don't want a path that goes off the know map
 		if (!costmap_.worldToMap(x_i, y_i, cell_x, cell_y)) {
 			traj.cost_ = -1.0;
-			return;
+			return i + 1;
 		}
 
 		//check the point on the trajectory for legality
-		double footprint_cost = footprintCost(x_i, y_i, theta_i);
+		//the swept footprint of a primitive is checked once after the last step
+		double footprint_cost =
+				primitive && footprint_spec_.size() >= 3 ?
+						0.0 : footprintCost(x_i, y_i, theta_i);
 //      printf("footprint cost = %.4f\n", footprint_cost);
 		//if the footprint hits an obstacle this trajectory is invalid
 		if (footprint_cost < 0) {
 			traj.cost_ = -1.0;
-			return;
+			return i + 1;
 			//TODO: Really look at getMaxSpeedToStopInTime... dues to discretization errors and high acceleration limits,
 			//it can actually cause the robot to hit obstacles. There may be something to be done to fix, but I'll have to
 			//come back to it when I have time. Right now, pulling it out as it'll just make the robot a bit more conservative,
@@ -211,11 +276,11 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 			 double max_vel_x, max_vel_y, max_vel_th;
 			 //we want to compute the max allowable speeds to be able to stop
 			 //to be safe... we'll make sure we can stop some time before we actually hit
-			 getMaxSpeedToStopInTime(time - stop_time_buffer_ - dt, max_vel_x, max_vel_y, max_vel_th);
+			 getMaxSpeedToStopInTime(cfg, time - cfg.stop_time_buffer - dt, max_vel_x, max_vel_y, max_vel_th);
 
 			 //check if we can stop in time
 			 if(fabs(vx_samp) < max_vel_x && fabs(vy_samp) < max_vel_y && fabs(vtheta_samp) < max_vel_th){
-			 ROS_ERROR("v: (%.2f, %.2f, %.2f), m: (%.2f, %.2f, %.2f) t:%.2f, st: %.2f, dt: %.2f", vx_samp, vy_samp, vtheta_samp, max_vel_x, max_vel_y, max_vel_th, time, stop_time_buffer_, dt);
+			 ROS_ERROR("v: (%.2f, %.2f, %.2f), m: (%.2f, %.2f, %.2f) t:%.2f, st: %.2f, dt: %.2f", vx_samp, vy_samp, vtheta_samp, max_vel_x, max_vel_y, max_vel_th, time, cfg.stop_time_buffer, dt);
 			 //if we can stop... we'll just break out of the loop here.. no point in checking future points
 			 break;
 			 }
@@ -230,7 +295,7 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 				double(costmap_.getCost(cell_x, cell_y)));
 
 		//do we want to follow blindly
-		if (simple_attractor_) {
+		if (cfg.simple_attractor) {
 			goal_dist = (x_i - global_plan_[global_plan_.size() - 1].x())
 					* (x_i - global_plan_[global_plan_.size() - 1].x())
 					+ (y_i - global_plan_[global_plan_.size() - 1].y())
@@ -241,11 +306,12 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 
 			// with heading scoring, we take into account heading diff, and also only score
 			// path and goal distance for one point of the trajectory
-			if (heading_scoring_) {
-				if (time >= heading_scoring_timestep_
-						&& time < heading_scoring_timestep_ + dt) {
+			if (cfg.heading_scoring) {
+				if (time >= cfg.heading_scoring_timestep
+						&& time < cfg.heading_scoring_timestep + dt) {
 					heading_diff = headingDiff(cell_x, cell_y, x_i, y_i,
 							theta_i);
+					scored = true;
 				} else {
 					update_path_and_goal_distances = false;
 				}
@@ -253,8 +319,8 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 
 			if (update_path_and_goal_distances) {
 				//update path and goal distances
-				path_dist = path_map_(cell_x, cell_y).target_dist;
-				goal_dist = goal_map_(cell_x, cell_y).target_dist;
+				path_dist = path_map_.getTargetDist(cell_x, cell_y);
+				goal_dist = goal_map_.getTargetDist(cell_x, cell_y);
 
 				//if a point on this trajectory has no clear path to goal it is invalid
 				if (impossible_cost <= goal_dist
@@ -263,14 +329,31 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 							"No path to goal with goal distance = %f, path_distance = %f and max cost = %f\n",
 							goal_dist, path_dist, impossible_cost);
 					traj.cost_ = -2.0;
-					return;
+					return i + 1;
 				}
 			}
 		}
 
+		if (cost_bound) {
+			double bound = cost_bound->load(std::memory_order_relaxed);
+			double lower = cfg.occdist_scale * occ_cost;
+			if (scored)
+				lower += cfg.pdist_scale * path_dist + 0.3 * heading_diff
+						+ goal_dist * cfg.gdist_scale;
+			if (bound >= 0 && lower > bound) {
+				traj.cost_ = -3.0;
+				return i + 1;
+			}
+		}
+
 		//the point is legal... add it to the trajectory
 		traj.addPoint(x_i, y_i, theta_i);
 
+		if (primitive) {
+			time += dt;
+			continue;
+		}
+
 		//calculate velocities
 		vx_i = computeNewVelocity(vx_samp, vx_i, acc_x, dt);
 		vy_i = computeNewVelocity(vy_samp, vy_i, acc_y, dt);
@@ -285,39 +368,113 @@ void TrajectoryPlanner::generateTrajectory(double x, double y, double theta,
 		time += dt;
 	} // end for i < numsteps
 
+	if (primitive && footprint_spec_.size() >= 3) {
+		primitives_.sweep(*primitive);
+		double step = primitives_.sweptStep();
+		for (size_t i = 0; i < primitive->swept_x.size(); ++i) {
+			double sx = primitive->swept_x[i] * step;
+			double sy = primitive->swept_y[i] * step;
+			unsigned int cell_x, cell_y;
+			if (!costmap_.worldToMap(x + sx * cos_th - sy * sin_th,
+					y + sx * sin_th + sy * cos_th, cell_x, cell_y)) {
+				traj.cost_ = -1.0;
+				return num_steps;
+			}
+			unsigned char cost = costmap_.getCost(cell_x, cell_y);
+			if (cost == LETHAL_OBSTACLE || cost == NO_INFORMATION) {
+				traj.cost_ = -1.0;
+				return num_steps;
+			}
+			occ_cost = std::max(occ_cost, double(cost));
+		}
+	}
+
 //    printf(
 //        "before compute cost OccCost: %f, vx: %.2f, vy: %.2f, vtheta: %.2f\n",
 //        occ_cost, vx_samp, vy_samp, vtheta_samp);
 
 	double cost = -1.0;
-	if (!heading_scoring_) {
-		cost = pdist_scale_ * path_dist + goal_dist * gdist_scale_
-				+ occdist_scale_ * occ_cost;
+	if (!cfg.heading_scoring) {
+		cost = cfg.pdist_scale * path_dist + goal_dist * cfg.gdist_scale
+				+ cfg.occdist_scale * occ_cost;
 	} else {
-		cost = occdist_scale_ * occ_cost + pdist_scale_ * path_dist
-				+ 0.3 * heading_diff + goal_dist * gdist_scale_;
+		cost = cfg.occdist_scale * occ_cost + cfg.pdist_scale * path_dist
+				+ 0.3 * heading_diff + goal_dist * cfg.gdist_scale;
 	}
 	traj.cost_ = cost;
+	return num_steps;
 }
 
 double TrajectoryPlanner::headingDiff(int cell_x, int cell_y, double x,
 		double y, double heading) {
+	// find a clear line of sight from the robot's cell to a farthest point on the path
+	int goal = headingGoal(cell_x, cell_y);
+	if (goal < 0)
+		return DBL_MAX;
+
+	float gx, gy;
+	costmap_.mapToWorld(heading_plan_[goal].first, heading_plan_[goal].second,
+			gx, gy);
+	return fabs(angleDiff(sgbot::math::atan2(gy - y, gx - x) - heading));
+}
+
+void TrajectoryPlanner::prepareHeadingGoals(double x, double y, double reach,
+		const TrajectoryPlannerConfig& cfg) {
+	heading_plan_.clear();
+	heading_size_ = 0;
+	if (!cfg.heading_scoring || cfg.simple_attractor)
+		return;
+
 	unsigned int goal_cell_x, goal_cell_y;
+	for (size_t i = 0; i < global_plan_.size(); ++i) {
+		if (!costmap_.worldToMap(global_plan_[i].x(), global_plan_[i].y(),
+				goal_cell_x, goal_cell_y))
+			continue;
+		if (heading_plan_.empty() || heading_plan_.back().first != goal_cell_x
+				|| heading_plan_.back().second != goal_cell_y)
+			heading_plan_.push_back(std::make_pair(goal_cell_x, goal_cell_y));
+	}
 
-	// find a clear line of sight from the robot's cell to a farthest point on the path
-	for (int i = global_plan_.size() - 1; i >= 0; --i) {
-		if (costmap_.worldToMap(global_plan_[i].x(), global_plan_[i].y(),
-				goal_cell_x, goal_cell_y)) {
-			if (lineCost(cell_x, goal_cell_x, cell_y, goal_cell_y) >= 0) {
-				float gx, gy;
-				costmap_.mapToWorld(goal_cell_x, goal_cell_y, gx, gy);
-				return fabs(
-						angleDiff(
-								sgbot::math::atan2(gy - y, gx - x) - heading));
-			}
+	/*
+	 * 评分时刻的轨迹点都落在机器人周围 reach 以内，这些栅格的视线结果
+	 * 由第一条到达它的 rollout 算出并缓存，同一周期里其它轨迹直接取用
+	 */
+	unsigned int robot_x, robot_y;
+	if (!costmap_.worldToMap(x, y, robot_x, robot_y))
+		return;
+	int half = int(ceil(reach / costmap_.getResolution())) + 1;
+	heading_x_ = int(robot_x) - half;
+	heading_y_ = int(robot_y) - half;
+	heading_size_ = 2 * half + 1;
+	if (heading_goals_.size() < heading_size_ * heading_size_)
+		std::vector<std::atomic<int> >(heading_size_ * heading_size_).swap(
+				heading_goals_);
+	for (unsigned int i = 0; i < heading_size_ * heading_size_; ++i)
+		heading_goals_[i].store(-2, std::memory_order_relaxed);
+}
+
+int TrajectoryPlanner::headingGoal(int cell_x, int cell_y) {
+	std::atomic<int>* cached = NULL;
+	unsigned int local_x = cell_x - heading_x_, local_y = cell_y - heading_y_;
+	if (local_x < heading_size_ && local_y < heading_size_) {
+		cached = &heading_goals_[local_y * heading_size_ + local_x];
+		int goal = cached->load(std::memory_order_relaxed);
+		if (goal != -2)
+			return goal;
+	}
+
+	//rollouts racing on a cell find the same plan point
+	int goal = -1;
+	for (int i = heading_plan_.size() - 1; i >= 0; --i) {
+		if (lineCost(cell_x, heading_plan_[i].first, cell_y,
+				heading_plan_[i].second) >= 0) {
+			goal = i;
+			break;
 		}
 	}
-	return DBL_MAX;
+	if (cached)
+		cached->store(goal, std::memory_order_relaxed);
+	return goal;
 }
 
 //calculate the cost of a ray-traced line
@@ -408,6 +565,35 @@ double TrajectoryPlanner::pointCost(int x, int y) {
 
 void TrajectoryPlanner::updatePlan(const vector<Pose2D>& new_plan,
 		bool compute_dists) {
+	/*
+	 * 新路径通常是上一条剪掉了开头的位姿，这时不用重新加密，
+	 * 只把加密路径的起点往后移
+	 */
+	bool pruned = !adjusted_plan_.empty()
+			&& new_plan.size() <= global_plan_.size()
+			&& adjusted_resolution_ == costmap_.getResolution();
+	size_t offset = global_plan_.size() - new_plan.size();
+	for (unsigned int i = 0; pruned && i < new_plan.size(); ++i) {
+		const Pose2D& a = new_plan[i];
+		const Pose2D& b = global_plan_[offset + i];
+		pruned = a.x() == b.x() && a.y() == b.y() && a.theta() == b.theta();
+	}
+	if (pruned) {
+		plan_pruned_ += offset;
+	} else {
+		adjusted_plan_.clear();
+		adjusted_index_.clear();
+		adjusted_resolution_ = costmap_.getResolution();
+		MapGrid::adjustPlanResolution(new_plan, adjusted_plan_,
+				adjusted_resolution_, &adjusted_index_);
+		if (adjusted_plan_.size() != new_plan.size()) {
+			printf("Adjusted global plan resolution, added %zu points\n",
+					adjusted_plan_.size() - new_plan.size());
+		}
+		plan_version_++;
+		plan_pruned_ = 0;
+	}
+
 	global_plan_.resize(new_plan.size());
 	for (unsigned int i = 0; i < new_plan.size(); ++i) {
 		global_plan_[i] = new_plan[i];
@@ -423,17 +609,110 @@ void TrajectoryPlanner::updatePlan(const vector<Pose2D>& new_plan,
 	}
 
 	if (compute_dists) {
-		//reset the map for new operations
-		path_map_.resetPathDist();
-		goal_map_.resetPathDist();
-
 		//make sure that we update our path based on the global plan and compute costs
-		path_map_.setTargetCells(costmap_, global_plan_);
-		goal_map_.setLocalGoal(costmap_, global_plan_);
+		updateDistanceMaps(std::vector<Point2D>());
 		printf("Path/Goal distance computed\n");
 	}
 }
 
+bool TrajectoryPlanner::windowStamp(const MapGrid& map,
+		unsigned int& stamp) {
+	if (!layered_costmap_)
+		return false;
+
+	unsigned int tile = NS_CostMap::LayeredCostmap::DIRTY_TILE_SIZE;
+	unsigned int tx0 = map.origin_x_ / tile;
+	unsigned int ty0 = map.origin_y_ / tile;
+	unsigned int tx1 = (map.origin_x_ + map.size_x_ - 1) / tile;
+	unsigned int ty1 = (map.origin_y_ + map.size_y_ - 1) / tile;
+	//stamps of another size (not resized through the layered costmap yet)
+	if (tx1 >= layered_costmap_->getTilesX()
+			|| ty1 >= layered_costmap_->getTilesY())
+		return false;
+
+	stamp = 0;
+	for (unsigned int ty = ty0; ty <= ty1; ++ty)
+		for (unsigned int tx = tx0; tx <= tx1; ++tx)
+			stamp = max(stamp, layered_costmap_->getTileStamp(tx, ty));
+	return true;
+}
+
+void TrajectoryPlanner::updateDistanceMaps(
+		const vector<Point2D>& footprint_list) {
+	if (!path_map_.fits(costmap_))
+		path_map_.setWindow(costmap_);
+	if (!goal_map_.fits(costmap_))
+		goal_map_.setWindow(costmap_);
+
+	/*
+	 * 距离只取决于窗口、剪过的路径、窗口下的代价和足迹里的障碍栅格，
+	 * 这些都没变时沿用上一次传播的结果
+	 */
+	DistanceMapKey key;
+	key.local_goal = -1;
+	key.plan_version = plan_version_;
+	key.plan_begin =
+			plan_pruned_ < adjusted_index_.size() ?
+					adjusted_index_[plan_pruned_] : adjusted_plan_.size();
+
+	key.origin_x = path_map_.origin_x_;
+	key.origin_y = path_map_.origin_y_;
+	key.size_x = path_map_.size_x_;
+	key.size_y = path_map_.size_y_;
+	bool stamped = windowStamp(path_map_, key.costmap_stamp);
+	for (unsigned int i = 0; i < footprint_list.size(); ++i) {
+		unsigned int x = footprint_list[i].x(), y = footprint_list[i].y();
+		if (!path_map_.inWindow(x, y))
+			continue;
+		unsigned char cost = costmap_.getCost(x, y);
+		if (cost == LETHAL_OBSTACLE || cost == INSCRIBED_INFLATED_OBSTACLE
+				|| cost == NO_INFORMATION)
+			key.robot_obstacles.push_back(costmap_.getIndex(x, y));
+	}
+	if (!path_valid_ || !(key == path_key_)) {
+		path_map_.resetPathDist();
+		//mark cells within the initial footprint of the robot
+		for (unsigned int i = 0; i < footprint_list.size(); ++i) {
+			path_map_.setWithinRobot(footprint_list[i].x(), footprint_list[i].y());
+		}
+		path_map_.setTargetCells(costmap_, adjusted_plan_, key.plan_begin);
+		path_key_ = key;
+		path_valid_ = stamped;
+		path_updates_++;
+	} else {
+		//the robot moved without changing the distances
+		path_map_.clearWithinRobot();
+		for (unsigned int i = 0; i < footprint_list.size(); ++i) {
+			path_map_.setWithinRobot(footprint_list[i].x(), footprint_list[i].y());
+		}
+	}
+
+	key.origin_x = goal_map_.origin_x_;
+	key.origin_y = goal_map_.origin_y_;
+	key.size_x = goal_map_.size_x_;
+	key.size_y = goal_map_.size_y_;
+	stamped = windowStamp(goal_map_, key.costmap_stamp);
+	//the goal wave starts from a single cell and does not look at the footprint
+	int goal_x, goal_y;
+	bool goal_found = goal_map_.findLocalGoal(costmap_, adjusted_plan_,
+			key.plan_begin, goal_x, goal_y);
+	key.plan_version = key.plan_begin = 0;
+	key.local_goal = goal_x >= 0 ? costmap_.getIndex(goal_x, goal_y) : -1;
+	key.robot_obstacles.clear();
+	if (!goal_valid_ || !(key == goal_key_)) {
+		goal_map_.resetPathDist();
+		if (goal_found) {
+			goal_map_.setLocalGoal(costmap_, goal_x, goal_y);
+		} else {
+			printf(
+					"None of the points of the global plan were in the local costmap, global plan points too far from robot\n");
+		}
+		goal_key_ = key;
+		goal_valid_ = stamped;
+		goal_updates_++;
+	}
+}
+
 bool TrajectoryPlanner::checkTrajectory(double x, double y, double theta,
 		double vx, double vy, double vtheta, double vx_samp, double vy_samp,
 		double vtheta_samp) {
@@ -459,9 +738,14 @@ double TrajectoryPlanner::scoreTrajectory(double x, double y, double theta,
 		double vtheta_samp) {
 	Trajectory t;
 	double impossible_cost = path_map_.obstacleCosts();
+	TrajectoryPlannerConfigPtr config = getConfig();
+	const TrajectoryPlannerConfig& cfg = *config;
+	prepareHeadingGoals(x, y,
+			std::max(hypot(vx, vy), hypot(vx_samp, vy_samp))
+					* (cfg.heading_scoring_timestep + cfg.sim_granularity), cfg);
 	generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-			vtheta_samp, acc_lim_x_, acc_lim_y_, acc_lim_theta_,
-			impossible_cost, t);
+			vtheta_samp, cfg.acc_lim_x, cfg.acc_lim_y, cfg.acc_lim_theta,
+			impossible_cost, t, cfg);
 
 	// return the cost.
 	return double(t.cost_);
@@ -472,34 +756,41 @@ double TrajectoryPlanner::scoreTrajectory(double x, double y, double theta,
  */
 Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 		double theta, double vx, double vy, double vtheta, double acc_x,
-		double acc_y, double acc_theta) {
+		double acc_y, double acc_theta, const TrajectoryPlannerConfig& cfg) {
+	//around a binned velocity the samples repeat from cycle to cycle and their primitives can be reused
+	if (cfg.primitive_cache && vy == 0.0) {
+		vx = floor(vx / cfg.primitive_vel_bin + 0.5) * cfg.primitive_vel_bin;
+		vtheta = floor(vtheta / cfg.primitive_theta_bin + 0.5)
+				* cfg.primitive_theta_bin;
+	}
+
 	//compute feasible velocity limits in robot space
-	double max_vel_x = max_vel_x_, max_vel_theta;
+	double max_vel_x = cfg.max_vel_x, max_vel_theta;
 	double min_vel_x, min_vel_theta;
 
 	if (final_goal_position_valid_) {
 		double final_goal_dist = hypot(final_goal_x_ - x, final_goal_y_ - y);
-		max_vel_x = min(max_vel_x, final_goal_dist / sim_time_);
+		max_vel_x = min(max_vel_x, final_goal_dist / cfg.sim_time);
 	}
 
 	//should we use the dynamic window approach?
-	if (dwa_) {
-		max_vel_x = max(min(max_vel_x, vx + acc_x * sim_period_), min_vel_x_);
-		min_vel_x = max(min_vel_x_, vx - acc_x * sim_period_);
+	if (cfg.dwa) {
+		max_vel_x = max(min(max_vel_x, vx + acc_x * cfg.sim_period), cfg.min_vel_x);
+		min_vel_x = max(cfg.min_vel_x, vx - acc_x * cfg.sim_period);
 
-		max_vel_theta = min(max_vel_th_, vtheta + acc_theta * sim_period_);
-		min_vel_theta = max(min_vel_th_, vtheta - acc_theta * sim_period_);
+		max_vel_theta = min(cfg.max_vel_th, vtheta + acc_theta * cfg.sim_period);
+		min_vel_theta = max(cfg.min_vel_th, vtheta - acc_theta * cfg.sim_period);
 	} else {
-		max_vel_x = max(min(max_vel_x, vx + acc_x * sim_time_), min_vel_x_);
-		min_vel_x = max(min_vel_x_, vx - acc_x * sim_time_);
+		max_vel_x = max(min(max_vel_x, vx + acc_x * cfg.sim_time), cfg.min_vel_x);
+		min_vel_x = max(cfg.min_vel_x, vx - acc_x * cfg.sim_time);
 
-		max_vel_theta = min(max_vel_th_, vtheta + acc_theta * sim_time_);
-		min_vel_theta = max(min_vel_th_, vtheta - acc_theta * sim_time_);
+		max_vel_theta = min(cfg.max_vel_th, vtheta + acc_theta * cfg.sim_time);
+		min_vel_theta = max(cfg.min_vel_th, vtheta - acc_theta * cfg.sim_time);
 	}
 
 	//we want to sample the velocity space regularly
-	double dvx = (max_vel_x - min_vel_x) / (vx_samples_ - 1);
-	double dvtheta = (max_vel_theta - min_vel_theta) / (vtheta_samples_ - 1);
+	double dvx = (max_vel_x - min_vel_x) / (cfg.vx_samples - 1);
+	double dvtheta = (max_vel_theta - min_vel_theta) / (cfg.vtheta_samples - 1);
 
 	double vx_samp = min_vel_x;
 	double vtheta_samp = min_vel_theta;
@@ -517,136 +808,203 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 	//any cell with a cost greater than the size of the map is impossible
 	double impossible_cost = path_map_.obstacleCosts();
 
+	//the heading is scored before the speed gets past the faster of the current and the sampled ones
+	double reach = max(max(fabs(vx), fabs(cfg.backup_vel)),
+			max(fabs(max_vel_x), fabs(min_vel_x)));
+	prepareHeadingGoals(x, y,
+			reach * (cfg.heading_scoring_timestep + cfg.sim_granularity), cfg);
+
+	/*
+	 * 先按原来的评分顺序列出所有采样，并行 rollout 之后再按同样的顺序比较，
+	 * 选出的轨迹与串行时完全一致
+	 */
+	samples_.clear();
+	RolloutSample sample;
+	sample.vy = vy_samp;
+
 	//if we're performing an escape we won't allow moving forward
 	if (!escaping_) {
 		//loop through all x velocities
-		for (int i = 0; i < vx_samples_; ++i) {
-			vtheta_samp = 0;
+		for (int i = 0; i < cfg.vx_samples; ++i) {
 			//first sample the straight trajectory
-			generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-					vtheta_samp, acc_x, acc_y, acc_theta, impossible_cost,
-					*comp_traj);
-
-			//if the new trajectory is better... let's take it
-			if (comp_traj->cost_ >= 0
-					&& (comp_traj->cost_ < best_traj->cost_
-							|| best_traj->cost_ < 0)) {
-				swap = best_traj;
-				best_traj = comp_traj;
-				comp_traj = swap;
-			}
+			sample.vx = vx_samp;
+			sample.vtheta = sample.vtheta_sampled = 0;
+			samples_.push_back(sample);
 
 			vtheta_samp = min_vel_theta;
 			//next sample all theta trajectories
-			for (int j = 0; j < vtheta_samples_ - 1; ++j) {
-				generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp,
-						vy_samp, vtheta_samp, acc_x, acc_y, acc_theta,
-						impossible_cost, *comp_traj);
-
-				//if the new trajectory is better... let's take it
-				if (comp_traj->cost_ >= 0
-						&& (comp_traj->cost_ < best_traj->cost_
-								|| best_traj->cost_ < 0)) {
-					swap = best_traj;
-					best_traj = comp_traj;
-					comp_traj = swap;
-				}
+			for (int j = 0; j < cfg.vtheta_samples - 1; ++j) {
+				sample.vtheta = sample.vtheta_sampled = vtheta_samp;
+				samples_.push_back(sample);
 				vtheta_samp += dvtheta;
 			}
 			vx_samp += dvx;
 		}
-
-		//only explore y velocities with holonomic robots
-//      if(holonomic_robot_)
-//      {
-//        //explore trajectories that move forward but also strafe slightly
-//        vx_samp = 0.1;
-//        vy_samp = 0.1;
-//        vtheta_samp = 0.0;
-//        generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-//                           vtheta_samp, acc_x, acc_y, acc_theta,
-//                           impossible_cost, *comp_traj);
-//
-//        //if the new trajectory is better... let's take it
-//        if(comp_traj->cost_ >= 0 && (comp_traj->cost_ < best_traj->cost_ || best_traj->cost_ < 0))
-//        {
-//          swap = best_traj;
-//          best_traj = comp_traj;
-//          comp_traj = swap;
-//        }
-//
-//        vx_samp = 0.1;
-//        vy_samp = -0.1;
-//        vtheta_samp = 0.0;
-//        generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-//                           vtheta_samp, acc_x, acc_y, acc_theta,
-//                           impossible_cost, *comp_traj);
-//
-//        //if the new trajectory is better... let's take it
-//        if(comp_traj->cost_ >= 0 && (comp_traj->cost_ < best_traj->cost_ || best_traj->cost_ < 0))
-//        {
-//          swap = best_traj;
-//          best_traj = comp_traj;
-//          comp_traj = swap;
-//        }
-//      }
 	} // end if not escaping
+	int forward_samples = samples_.size();
 
 	//next we want to generate trajectories for rotating in place
 	vtheta_samp = min_vel_theta;
-	vx_samp = 0.0;
-	vy_samp = 0.0;
+	sample.vx = 0.0;
+	for (int i = 0; i < cfg.vtheta_samples; ++i) {
+		//enforce a minimum rotational velocity because the base can't handle small in-place rotations
+		sample.vtheta =
+				vtheta_samp > 0 ?
+						max(vtheta_samp, cfg.min_in_place_vel_th) :
+						min(vtheta_samp, -1.0 * cfg.min_in_place_vel_th);
+		sample.vtheta_sampled = vtheta_samp;
+		samples_.push_back(sample);
+		vtheta_samp += dvtheta;
+	}
+
+	rollout_start_.x = x;
+	rollout_start_.y = y;
+	rollout_start_.theta = theta;
+	rollout_start_.vx = vx;
+	rollout_start_.vy = vy;
+	rollout_start_.vtheta = vtheta;
+	rollout_start_.acc_x = acc_x;
+	rollout_start_.acc_y = acc_y;
+	rollout_start_.acc_theta = acc_theta;
+	rollout_start_.impossible_cost = impossible_cost;
+	rollout_start_.config = &cfg;
+	rollout_start_.forward_samples = forward_samples;
+
+	//roll out the forward samples closest to the last choice first, they set a tight bound early
+	std::vector<std::pair<double, int> > order;
+	order.reserve(samples_.size());
+	double range_x = max(max_vel_x - min_vel_x, 1e-6);
+	double range_theta = max(max_vel_theta - min_vel_theta, 1e-6);
+	for (int i = 0; i < (int) samples_.size(); ++i) {
+		double key = i;
+		if (i < forward_samples && last_best_valid_)
+			key = fabs(samples_[i].vx - last_best_vx_) / range_x
+					+ fabs(samples_[i].vtheta - last_best_vtheta_) / range_theta;
+		else if (i >= forward_samples)
+			key = DBL_MAX;
+		order.push_back(std::make_pair(key, i));
+	}
+	std::sort(order.begin(), order.end());
+	rollout_order_.resize(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		rollout_order_[i] = order[i].second;
+	forward_best_.store(-1.0);
+
+	NS_NaviCommon::Time rollout_begin = NS_NaviCommon::Time::now();
+
+	/*
+	 * 起始速度和采样速度都按分箱取整后查找机器人坐标系下的轨迹，没有的先在
+	 * 工作线程上积分生成；下发的速度仍然是原始采样速度
+	 */
+	for (size_t i = 0; i < samples_.size(); ++i)
+		samples_[i].primitive = NULL;
+	if (cfg.primitive_cache && vy == 0.0) {
+		primitives_.setModel(cfg.primitive_vel_bin, cfg.primitive_theta_bin,
+				cfg.sim_time, cfg.sim_granularity, cfg.angular_sim_granularity,
+				cfg.heading_scoring, acc_x, acc_theta, footprint_spec_,
+				costmap_.getResolution());
+		primitives_.use(vx, vtheta, samples_.size());
+		primitive_misses_.clear();
+		for (size_t i = 0; i < samples_.size(); ++i) {
+			RolloutSample& s = samples_[i];
+			if (s.vy != 0.0)
+				continue;
+			primitive_lookups_++;
+			s.primitive = primitives_.find(vx, vtheta, s.vx, s.vtheta);
+			if (s.primitive) {
+				primitive_hits_++;
+				continue;
+			}
+			TrajectoryPrimitive* primitive = primitives_.add(vx, vtheta, s.vx,
+					s.vtheta);
+			primitive_misses_.push_back(primitive);
+			s.primitive = primitive;
+		}
+		workers_.run(primitive_misses_.size(),
+				boost::bind(&TrajectoryPlanner::buildPrimitive, this, _1, _2));
+	}
+
+	workers_.run(samples_.size(),
+			boost::bind(&TrajectoryPlanner::rolloutSample, this, _1, _2));
+	rollout_time_ += (NS_NaviCommon::Time::now() - rollout_begin).toSec();
+	for (size_t i = 0; i < samples_.size(); ++i) {
+		rollout_steps_ += samples_[i].steps;
+		if (samples_[i].cost == -3.0)
+			rollout_pruned_++;
+	}
+	if (++rollout_cycles_ == 50) {
+		logInfo<< "rolled out "<<samples_.size()<<" samples on "<<workers_.size()
+		<<" threads in "<<rollout_time_ * 1000 / rollout_cycles_<<" ms per cycle, "
+		<<(double) rollout_steps_ / rollout_cycles_<<" steps simulated and "
+		<<(double) rollout_pruned_ / rollout_cycles_<<" samples pruned per cycle, "
+		<<primitive_hits_<<"/"<<primitive_lookups_<<" primitive cache hits, "
+		<<primitives_.size()<<" cached, "
+		<<path_updates_<<" path and "<<goal_updates_<<" goal distance maps propagated";
+		rollout_time_ = 0;
+		rollout_cycles_ = 0;
+		rollout_steps_ = 0;
+		rollout_pruned_ = 0;
+		primitive_lookups_ = 0;
+		primitive_hits_ = 0;
+		path_updates_ = 0;
+		goal_updates_ = 0;
+	}
+
+	//the straight and theta samples,if the new trajectory is better... let's take it
+	int best = -1;
+	double best_cost = -1.0, best_yv = 0.0;
+	for (int i = 0; i < forward_samples; ++i) {
+		const RolloutSample& s = samples_[i];
+		if (s.cost >= 0 && (s.cost < best_cost || best_cost < 0)) {
+			best = i;
+			best_cost = s.cost;
+			best_yv = s.vy;
+		}
+	}
 
 	//let's try to rotate toward open space
 	double heading_dist = DBL_MAX;
 
-	for (int i = 0; i < vtheta_samples_; ++i) {
-		//enforce a minimum rotational velocity because the base can't handle small in-place rotations
-		double vtheta_samp_limited =
-				vtheta_samp > 0 ?
-						max(vtheta_samp, min_in_place_vel_th_) :
-						min(vtheta_samp, -1.0 * min_in_place_vel_th_);
-
-		generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-				vtheta_samp_limited, acc_x, acc_y, acc_theta, impossible_cost,
-				*comp_traj);
+	for (int i = forward_samples; i < (int) samples_.size(); ++i) {
+		const RolloutSample& s = samples_[i];
+		vtheta_samp = s.vtheta_sampled;
 
 		//if the new trajectory is better... let's take it...
 		//note if we can legally rotate in place we prefer to do that rather than move with y velocity
-		if (comp_traj->cost_ >= 0
-				&& (comp_traj->cost_ <= best_traj->cost_ || best_traj->cost_ < 0
-						|| best_traj->yv_ != 0.0)
+		if (s.cost >= 0
+				&& (s.cost <= best_cost || best_cost < 0 || best_yv != 0.0)
 				&& (vtheta_samp > dvtheta || vtheta_samp < -1 * dvtheta)) {
-			double x_r, y_r, th_r;
-			comp_traj->getEndpoint(x_r, y_r, th_r);
-			x_r += heading_lookahead_ * cos(th_r);
-			y_r += heading_lookahead_ * sin(th_r);
+			double x_r = s.end_x, y_r = s.end_y, th_r = s.end_theta;
+			x_r += cfg.heading_lookahead * cos(th_r);
+			y_r += cfg.heading_lookahead * sin(th_r);
 			unsigned int cell_x, cell_y;
 
 			//make sure that we'll be looking at a legal cell
 			if (costmap_.worldToMap(x_r, y_r, cell_x, cell_y)) {
-				double ahead_gdist = goal_map_(cell_x, cell_y).target_dist;
-				if (ahead_gdist < heading_dist) {
-					//if we haven't already tried rotating left since we've moved forward
-					if (vtheta_samp < 0 && !stuck_left) {
-						swap = best_traj;
-						best_traj = comp_traj;
-						comp_traj = swap;
-						heading_dist = ahead_gdist;
-					}
-					//if we haven't already tried rotating right since we've moved forward
-					else if (vtheta_samp > 0 && !stuck_right) {
-						swap = best_traj;
-						best_traj = comp_traj;
-						comp_traj = swap;
-						heading_dist = ahead_gdist;
-					}
+				double ahead_gdist = goal_map_.getTargetDist(cell_x, cell_y);
+				//if we haven't already tried rotating left (right) since we've moved forward
+				if (ahead_gdist < heading_dist
+						&& ((vtheta_samp < 0 && !stuck_left)
+								|| (vtheta_samp > 0 && !stuck_right))) {
+					best = i;
+					best_cost = s.cost;
+					best_yv = s.vy;
+					heading_dist = ahead_gdist;
 				}
 			}
 		}
+	}
 
-		vtheta_samp += dvtheta;
+	//only the chosen sample is rolled out again to keep its points
+	if (best >= 0) {
+		generateTrajectory(x, y, theta, vx, vy, vtheta, samples_[best].vx,
+				samples_[best].vy, samples_[best].vtheta, acc_x, acc_y,
+				acc_theta, impossible_cost, *best_traj, cfg, NULL,
+				samples_[best].primitive);
+		last_best_vx_ = samples_[best].vx;
+		last_best_vtheta_ = samples_[best].vtheta;
 	}
+	last_best_valid_ = best >= 0;
 
 	//do we have a legal trajectory
 	if (best_traj->cost_ >= 0) {
@@ -680,7 +1038,7 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 		}
 
 		double dist = hypot(x - prev_x_, y - prev_y_);
-		if (dist > oscillation_reset_dist_) {
+		if (dist > cfg.oscillation_reset_dist) {
 			rotating_left = false;
 			rotating_right = false;
 			strafe_left = false;
@@ -692,10 +1050,10 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 		}
 
 		dist = hypot(x - escape_x_, y - escape_y_);
-		if (dist > escape_reset_dist_
+		if (dist > cfg.escape_reset_dist
 				|| fabs(
 						angleDiff(
-								theta - escape_theta_)) > escape_reset_theta_) {
+								theta - escape_theta_)) > cfg.escape_reset_theta) {
 			escaping_ = false;
 		}
 
@@ -703,17 +1061,17 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 	}
 
 	//only explore y velocities with holonomic robots
-//    if(holonomic_robot_)
+//    if(cfg.holonomic_robot)
 //    {
 //      //if we can't rotate in place or move forward... maybe we can move sideways and rotate
 //      vtheta_samp = min_vel_theta;
 //      vx_samp = 0.0;
 //
 //      //loop through all y velocities
-//      for(unsigned int i = 0; i < y_vels_.size(); ++i)
+//      for(unsigned int i = 0; i < cfg.y_vels.size(); ++i)
 //      {
 //        vtheta_samp = 0;
-//        vy_samp = y_vels_[i];
+//        vy_samp = cfg.y_vels[i];
 //        //sample completely horizontal trajectories
 //        generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
 //                           vtheta_samp, acc_x, acc_y, acc_theta,
@@ -724,8 +1082,8 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 //        {
 //          double x_r, y_r, th_r;
 //          comp_traj->getEndpoint(x_r, y_r, th_r);
-//          x_r += heading_lookahead_ * cos(th_r);
-//          y_r += heading_lookahead_ * sin(th_r);
+//          x_r += cfg.heading_lookahead * cos(th_r);
+//          y_r += cfg.heading_lookahead * sin(th_r);
 //          unsigned int cell_x, cell_y;
 //
 //          //make sure that we'll be looking at a legal cell
@@ -788,7 +1146,7 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 		}
 
 		double dist = hypot(x - prev_x_, y - prev_y_);
-		if (dist > oscillation_reset_dist_) {
+		if (dist > cfg.oscillation_reset_dist) {
 			rotating_left = false;
 			rotating_right = false;
 			strafe_left = false;
@@ -800,10 +1158,10 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 		}
 
 		dist = hypot(x - escape_x_, y - escape_y_);
-		if (dist > escape_reset_dist_
+		if (dist > cfg.escape_reset_dist
 				|| fabs(
 						angleDiff(
-								theta - escape_theta_)) > escape_reset_theta_) {
+								theta - escape_theta_)) > cfg.escape_reset_theta) {
 			escaping_ = false;
 		}
 
@@ -813,10 +1171,11 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 	logInfo<< "nothing have been done , so move back slowly";
 	//and finally, if we can't do anything else, we want to generate trajectories that move backwards slowly
 	vtheta_samp = 0.0;
-	vx_samp = backup_vel_;
+	vx_samp = cfg.backup_vel;
 	vy_samp = 0.0;
 	generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp,
-			vtheta_samp, acc_x, acc_y, acc_theta, impossible_cost, *comp_traj);
+			vtheta_samp, acc_x, acc_y, acc_theta, impossible_cost, *comp_traj,
+			cfg);
 
 	//if the new trajectory is better... let's take it
 	/*
@@ -833,7 +1192,7 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 	comp_traj = swap;
 
 	double dist = hypot(x - prev_x_, y - prev_y_);
-	if (dist > oscillation_reset_dist_) {
+	if (dist > cfg.oscillation_reset_dist) {
 		rotating_left = false;
 		rotating_right = false;
 		strafe_left = false;
@@ -854,10 +1213,10 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 
 	dist = hypot(x - escape_x_, y - escape_y_);
 
-	if (dist > escape_reset_dist_
+	if (dist > cfg.escape_reset_dist
 			|| fabs(
 					angleDiff(
-							theta - escape_theta_)) > escape_reset_theta_) {
+							theta - escape_theta_)) > cfg.escape_reset_theta) {
 		escaping_ = false;
 	}
 
@@ -869,16 +1228,60 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y,
 
 }
 
+void TrajectoryPlanner::rolloutSample(int worker, int index) {
+	index = rollout_order_[index];
+	RolloutSample& s = samples_[index];
+	Trajectory& traj = worker_trajs_[worker];
+	const RolloutStart& r = rollout_start_;
+	s.steps = generateTrajectory(r.x, r.y, r.theta, r.vx, r.vy, r.vtheta, s.vx,
+			s.vy, s.vtheta, r.acc_x, r.acc_y, r.acc_theta, r.impossible_cost,
+			traj, *r.config, &forward_best_, s.primitive);
+	s.cost = traj.cost_;
+	if (traj.getPointsSize() > 0)
+		traj.getEndpoint(s.end_x, s.end_y, s.end_theta);
+
+	/*
+	 * 只有前进采样的代价作为上界：前进采样按严格小于比较，原地旋转采样也要求
+	 * 代价不超过已选中的最优，所以代价高于任何一个前进采样的轨迹都不会被选中
+	 */
+	if (index < r.forward_samples && s.cost >= 0) {
+		double best = forward_best_.load();
+		while ((best < 0 || s.cost < best)
+				&& !forward_best_.compare_exchange_weak(best, s.cost))
+			;
+	}
+}
+
+void TrajectoryPlanner::buildPrimitive(int worker, int index) {
+	primitives_.build(*primitive_misses_[index]);
+}
+
 //given the current state of the robot, find a good trajectory
 Trajectory TrajectoryPlanner::findBestPath(Pose2D global_pose,
 		Velocity2D global_vel, Velocity2D& drive_velocities) {
 
+	// one configuration for the whole cycle, reconfigure may swap it meanwhile
+	TrajectoryPlannerConfigPtr config = getConfig();
+	const TrajectoryPlannerConfig& cfg = *config;
+
 	std::vector<float> pos = { global_pose.x(), global_pose.y(), global_pose.theta() };
 	std::vector<float> vel = { global_vel.linear, 0.0f, global_vel.angular };
 
-	//reset the map for new operations
-	path_map_.resetPathDist();
-	goal_map_.resetPathDist();
+	/*
+	 * 路径和目标距离只在机器人周围的窗口里传播，窗口盖住所有 rollout
+	 * 在 sim_time 内能走到的位置和 heading_lookahead 看向的位置
+	 */
+	double reach_vel = max(cfg.max_vel_x, fabs(cfg.backup_vel));
+	for (unsigned int i = 0; i < cfg.y_vels.size(); ++i)
+		reach_vel = max(reach_vel, fabs(cfg.y_vels[i]));
+	double half_size = reach_vel * cfg.sim_time + cfg.heading_lookahead
+			+ circumscribed_radius_;
+
+	//the window moves only when the robot gets within half_size of its border
+	path_map_.setWindow(costmap_, pos[0], pos[1], half_size,
+			LOCAL_WINDOW_MARGIN);
+	goal_map_.setWindow(costmap_, pos[0], pos[1], half_size,
+			LOCAL_WINDOW_MARGIN);
 
 	//temporarily remove obstacles that are within the footprint of the robot
 	std::vector<Point2D> footprint_list =
@@ -887,20 +1290,14 @@ Trajectory TrajectoryPlanner::findBestPath(Pose2D global_pose,
 	printf("footprint_list size = %d,footprint_list[0].x = %lf,y = %lf\n",footprint_list.size(),
 			footprint_list[0].x(), footprint_list[0].y());
 
-	//mark cells within the initial footprint of the robot
-	for (unsigned int i = 0; i < footprint_list.size(); ++i) {
-		path_map_(footprint_list[i].x(), footprint_list[i].y()).within_robot = true;
-	}
-
 	//make sure that we update our path based on the global plan and compute costs
-	path_map_.setTargetCells(costmap_, global_plan_);
-	goal_map_.setLocalGoal(costmap_, global_plan_);
+	updateDistanceMaps(footprint_list);
 
 	printf("Path/Goal distance computed\n");
 
 	//rollout trajectories and find the minimum cost one
 	Trajectory best = createTrajectories(pos[0], pos[1], pos[2], vel[0], vel[1],
-			vel[2], acc_lim_x_, acc_lim_y_, acc_lim_theta_);
+			vel[2], cfg.acc_lim_x, cfg.acc_lim_y, cfg.acc_lim_theta, cfg);
 	logInfo << "Trajectories created\n";
 
 //    if(best.cost_ < 0)
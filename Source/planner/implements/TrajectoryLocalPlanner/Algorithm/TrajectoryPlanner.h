@@ -3,10 +3,13 @@
 
 #include <vector>
 #include <cmath>
+#include <cfloat>
+#include <boost/shared_ptr.hpp>
 
 //for obstacle data access
 #include "../../../../costmap/costmap_2d/CostMap2D.h"
 #include "../../../../costmap/costmap_2d/CostValues.h"
+#include "../../../../costmap/costmap_2d/LayeredCostMap.h"
 #include "WorldModel.h"
 
 
@@ -15,10 +18,11 @@
 #include <std-math/math.h>
 //for creating a local cost grid
 #include "FootprintHelper.h"
-#include "MapCell.h"
 #include "MapGrid.h"
 #include "Trajectory.h"
 #include "WorldModel.h"
+#include "RolloutWorkers.h"
+#include "TrajectoryPrimitives.h"
 
 
 #include "log_tool.h"
@@ -26,6 +30,49 @@
 using namespace sgbot;
 namespace NS_Planner
 {
+  /**
+   * @brief The parameters of a TrajectoryPlanner, see its constructor for their meaning.
+   * A published configuration is never modified, reconfiguring swaps in a new one
+   */
+  struct TrajectoryPlannerConfig
+  {
+    double acc_lim_x, acc_lim_y, acc_lim_theta; ///< @brief The acceleration limits of the robot
+
+    double sim_time; ///< @brief The number of seconds each trajectory is "rolled-out"
+    double sim_granularity; ///< @brief The distance between simulation points
+    double angular_sim_granularity; ///< @brief The distance between angular simulation points
+
+    int vx_samples; ///< @brief The number of samples we'll take in the x dimenstion of the control space
+    int vtheta_samples; ///< @brief The number of samples we'll take in the theta dimension of the control space
+
+    double pdist_scale, gdist_scale, occdist_scale; ///< @brief Scaling factors for the controller's cost function
+
+    double heading_lookahead; ///< @brief How far the robot should look ahead of itself when differentiating between different rotational velocities
+    double oscillation_reset_dist; ///< @brief The distance the robot must travel before it can explore rotational velocities that were unsuccessful in the past
+    double escape_reset_dist, escape_reset_theta; ///< @brief The distance the robot must travel before it can leave escape mode
+    bool holonomic_robot; ///< @brief Is the robot holonomic or not?
+
+    double max_vel_x, min_vel_x, max_vel_th, min_vel_th,
+        min_in_place_vel_th; ///< @brief Velocity limits for the controller
+
+    double backup_vel; ///< @brief The velocity to use while backing up
+
+    bool dwa;  ///< @brief Should we use the dynamic window approach?
+    bool heading_scoring; ///< @brief Should we score based on the rollout approach or the heading approach
+    double heading_scoring_timestep; ///< @brief How far to look ahead in time when we score a heading
+    bool simple_attractor; ///< @brief Enables simple attraction to a goal point
+
+    std::vector< double > y_vels; ///< @brief Y velocities to explore
+
+    double stop_time_buffer; ///< @brief How long before hitting something we're going to enforce that the robot stop
+    double sim_period; ///< @brief The number of seconds to use to compute max/min vels for dwa
+
+    bool primitive_cache; ///< @brief Roll out from cached robot frame primitives instead of integrating every sample
+    double primitive_vel_bin, primitive_theta_bin; ///< @brief Velocity bins the primitives are cached by
+  };
+
+  typedef boost::shared_ptr< const TrajectoryPlannerConfig > TrajectoryPlannerConfigPtr;
+
   /**
    * @class TrajectoryPlanner
    * @brief Computes control velocities for a robot given a costmap, a plan, and the robot's position in the world. 
@@ -68,6 +115,7 @@ namespace NS_Planner
      * @param simple_attractor Set this to true to allow simple attraction to a goal point instead of intelligent cost propagation
      * @param y_vels A vector of the y velocities the controller will explore
      * @param angular_sim_granularity The distance between simulation points for angular velocity should be small enough that the robot doesn't hit things
+     * @param rollout_threads The number of threads the samples of a cycle are rolled out on, 0 for one per core
      */
     TrajectoryPlanner(WorldModel& world_model,
                       const NS_CostMap::Costmap2D& costmap,
@@ -93,7 +141,8 @@ namespace NS_Planner
                       double stop_time_buffer = 0.2, double sim_period = 0.1,
                       double angular_sim_granularity = 0.025,
                       double circums_radius = 0.36,
-                      double inscribe_radius = 0.26);
+                      double inscribe_radius = 0.26,
+                      int rollout_threads = 1);
 
     /**
      * @brief  Destructs a trajectory controller
@@ -101,11 +150,16 @@ namespace NS_Planner
     ~TrajectoryPlanner();
 
     /**
-     * @brief Reconfigures the trajectory planner
+     * @brief Reconfigures the trajectory planner, a cycle already running keeps the configuration it started with
      */
-    /*
-     void reconfigure(BaseLocalPlannerConfig &cfg);
+    void
+    reconfigure(const TrajectoryPlannerConfig& config);
+
+    /**
+     * @brief The configuration in use, can be called from any thread
      */
+    TrajectoryPlannerConfigPtr
+    getConfig() const;
 
     /**
      * @brief  Given the current position, orientation, and velocity of the robot, return a trajectory to follow
@@ -120,7 +174,8 @@ namespace NS_Planner
 			Velocity2D& drive_velocities);
 
     /**
-     * @brief  Update the plan that the controller is following
+     * @brief  Update the plan that the controller is following, the plan is only brought to the costmap resolution
+     * again when it is not the last plan or a part of it with the first poses pruned
      * @param new_plan A new plan for the controller to follow 
      * @param compute_dists Wheter or not to compute path/goal distances when a plan is updated
      */
@@ -128,6 +183,15 @@ namespace NS_Planner
     updatePlan(const std::vector< Pose2D >& new_plan,
                bool compute_dists = false);
 
+    /**
+     * @brief  Tell the layered costmap that owns the costmap, its dirty tiles decide whether the path and goal distances
+     * of the last cycle still hold. Without it they are computed every cycle
+     */
+    void setLayeredCostmap(NS_CostMap::LayeredCostmap* layered_costmap)
+    {
+      layered_costmap_ = layered_costmap;
+    }
+
     /**
      * @brief  Accessor for the goal the robot is currently pursuing in world corrdinates
      * @param x Will be set to the x position of the local goal 
@@ -217,12 +281,13 @@ namespace NS_Planner
      * @param acc_x The x acceleration limit of the robot
      * @param acc_y The y acceleration limit of the robot
      * @param acc_theta The theta acceleration limit of the robot
+     * @param cfg The configuration snapshot of this cycle
      * @return 
      */
     Trajectory
     createTrajectories(double x, double y, double theta, double vx, double vy,
                        double vtheta, double acc_x, double acc_y,
-                       double acc_theta);
+                       double acc_theta, const TrajectoryPlannerConfig& cfg);
 
     /**
      * @brief  Generate and score a single trajectory
@@ -240,13 +305,31 @@ namespace NS_Planner
      * @param acc_theta The theta acceleration limit of the robot
      * @param impossible_cost The cost value of a cell in the local map grid that is considered impassable
      * @param traj Will be set to the generated trajectory with its associated score 
+     * @param cfg The configuration snapshot of this cycle
+     * @param cost_bound If set and not negative, the rollout stops with a cost of -3 once its cost can no longer get below it
+     * @param primitive If set, the poses and the swept footprint are taken from it instead of being integrated, the swept footprint is filled on first use
+     * @return The number of steps simulated
      */
-    void
+    int
     generateTrajectory(double x, double y, double theta, double vx, double vy,
                        double vtheta, double vx_samp, double vy_samp,
                        double vtheta_samp, double acc_x, double acc_y,
                        double acc_theta, double impossible_cost,
-                       Trajectory& traj);
+                       Trajectory& traj, const TrajectoryPlannerConfig& cfg,
+                       const std::atomic< double >* cost_bound = NULL,
+                       TrajectoryPrimitive* primitive = NULL);
+
+    /**
+     * @brief  Roll out the sample at position index of rollout_order_ with the buffers of worker, run by the rollout workers
+     */
+    void
+    rolloutSample(int worker, int index);
+
+    /**
+     * @brief  Build primitive_misses_[index], run by the rollout workers
+     */
+    void
+    buildPrimitive(int worker, int index);
 
     /**
      * @brief  Checks the legality of the robot footprint at a position and orientation using the world model
@@ -258,10 +341,49 @@ namespace NS_Planner
     double
     footprintCost(double x_i, double y_i, double theta_i);
 
+    /**
+     * @brief  What the distances of a MapGrid were computed from
+     */
+    struct DistanceMapKey
+    {
+      unsigned int origin_x, origin_y, size_x, size_y;
+      unsigned int plan_version, plan_begin;
+      /// the costmap index of the cell the goal wave starts from, the goal map is keyed by it instead of the plan
+      int local_goal;
+      /// the newest dirty tile stamp under the window
+      unsigned int costmap_stamp;
+      /// obstacle cells inside the footprint, the path wave passes them
+      std::vector< unsigned int > robot_obstacles;
+
+      bool operator==(const DistanceMapKey& key) const
+      {
+        return origin_x == key.origin_x && origin_y == key.origin_y
+            && size_x == key.size_x && size_y == key.size_y
+            && plan_version == key.plan_version && plan_begin == key.plan_begin
+            && local_goal == key.local_goal
+            && costmap_stamp == key.costmap_stamp
+            && robot_obstacles == key.robot_obstacles;
+      }
+    };
+
+    /**
+     * @brief  Propagate the path and goal distances unless they were already computed from the same inputs
+     * @param footprint_list The cells within the footprint of the robot
+     */
+    void
+    updateDistanceMaps(const std::vector< Point2D >& footprint_list);
+
+    /**
+     * @brief  The newest dirty tile stamp of the layered costmap under a window
+     * @return False if there is no layered costmap or its tiles do not cover the costmap
+     */
+    bool
+    windowStamp(const MapGrid& map, unsigned int& stamp);
+
     FootprintHelper footprint_helper_;
 
-    MapGrid path_map_; ///< @brief The local map grid where we propagate path distance
-    MapGrid goal_map_; ///< @brief The local map grid where we propagate goal distance
+    MapGrid path_map_; ///< @brief The window around the robot where we propagate path distance
+    MapGrid goal_map_; ///< @brief The window around the robot where we propagate goal distance
     const NS_CostMap::Costmap2D& costmap_; ///< @brief Provides access to cost map information
     WorldModel& world_model_; ///< @brief The world model that the controller uses for collision detection
 
@@ -269,6 +391,16 @@ namespace NS_Planner
 
     std::vector< Pose2D > global_plan_; ///< @brief The global path for the robot to follow
 
+    std::vector< Pose2D > adjusted_plan_; ///< @brief The plan global_plan_ was pruned from at the costmap resolution
+    std::vector< unsigned int > adjusted_index_; ///< @brief Index in adjusted_plan_ of every pose of that plan
+    unsigned int plan_version_; ///< @brief Changes whenever adjusted_plan_ is computed again
+    unsigned int plan_pruned_; ///< @brief Poses pruned from the plan since adjusted_plan_ was computed
+    double adjusted_resolution_; ///< @brief The costmap resolution adjusted_plan_ was computed for
+
+    NS_CostMap::LayeredCostmap* layered_costmap_;
+    DistanceMapKey path_key_, goal_key_; ///< @brief Inputs of the distances in path_map_ and goal_map_
+    bool path_valid_, goal_valid_;
+
     bool stuck_left, stuck_right; ///< @brief Booleans to keep the robot from oscillating during rotation
     bool rotating_left, rotating_right; ///< @brief Booleans to keep track of the direction of rotation for the robot
 
@@ -283,44 +415,64 @@ namespace NS_Planner
     double final_goal_x_, final_goal_y_; ///< @brief The end position of the plan.
     bool final_goal_position_valid_; ///< @brief True if final_goal_x_ and final_goal_y_ have valid data.  Only false if an empty path is sent.
 
-    double sim_time_; ///< @brief The number of seconds each trajectory is "rolled-out"
-    double sim_granularity_; ///< @brief The distance between simulation points
-    double angular_sim_granularity_; ///< @brief The distance between angular simulation points
-
-    int vx_samples_; ///< @brief The number of samples we'll take in the x dimenstion of the control space
-    int vtheta_samples_; ///< @brief The number of samples we'll take in the theta dimension of the control space
-
-    double pdist_scale_, gdist_scale_, occdist_scale_; ///< @brief Scaling factors for the controller's cost function
-    double acc_lim_x_, acc_lim_y_, acc_lim_theta_; ///< @brief The acceleration limits of the robot
-
     double prev_x_, prev_y_; ///< @brief Used to calculate the distance the robot has traveled before reseting oscillation booleans
     double escape_x_, escape_y_, escape_theta_; ///< @brief Used to calculate the distance the robot has traveled before reseting escape booleans
 
     Trajectory traj_one, traj_two; ///< @brief Used for scoring trajectories
 
-    double heading_lookahead_; ///< @brief How far the robot should look ahead of itself when differentiating between different rotational velocities
-    double oscillation_reset_dist_; ///< @brief The distance the robot must travel before it can explore rotational velocities that were unsuccessful in the past
-    double escape_reset_dist_, escape_reset_theta_; ///< @brief The distance the robot must travel before it can leave escape mode
-    bool holonomic_robot_; ///< @brief Is the robot holonomic or not? 
-
-    double max_vel_x_, min_vel_x_, max_vel_th_, min_vel_th_,
-        min_in_place_vel_th_; ///< @brief Velocity limits for the controller
-
-    double backup_vel_; ///< @brief The velocity to use while backing up
-
-    bool dwa_;  ///< @brief Should we use the dynamic window approach?
-    bool heading_scoring_; ///< @brief Should we score based on the rollout approach or the heading approach
-    double heading_scoring_timestep_; ///< @brief How far to look ahead in time when we score a heading
-    bool simple_attractor_; ///< @brief Enables simple attraction to a goal point
-
-    std::vector< double > y_vels_; ///< @brief Y velocities to explore
+    double inscribed_radius_, circumscribed_radius_;
 
-    double stop_time_buffer_; ///< @brief How long before hitting something we're going to enforce that the robot stop
-    double sim_period_; ///< @brief The number of seconds to use to compute max/min vels for dwa
+    TrajectoryPlannerConfigPtr config_; ///< @brief Only swapped as a whole, read and written with atomic_load / atomic_store
 
-    double inscribed_radius_, circumscribed_radius_;
+    /**
+     * @brief A velocity sample of one control cycle and the result of its rollout
+     */
+    struct RolloutSample
+    {
+      double vx, vy, vtheta;
+      /// the sampled theta velocity before min_in_place_vel_th_ is applied
+      double vtheta_sampled;
+      double cost;
+      double end_x, end_y, end_theta;
+      int steps;
+      TrajectoryPrimitive* primitive;
+    };
 
-    boost::mutex configuration_mutex_;
+    /**
+     * @brief The robot state every sample of a cycle starts from
+     */
+    struct RolloutStart
+    {
+      double x, y, theta, vx, vy, vtheta;
+      double acc_x, acc_y, acc_theta;
+      double impossible_cost;
+      const TrajectoryPlannerConfig* config;
+      /// samples_ before it move forward and bound the others
+      int forward_samples;
+    };
+
+    RolloutWorkers workers_; ///< @brief Persistent threads the samples are rolled out on
+    std::vector< Trajectory > worker_trajs_; ///< @brief One scratch trajectory per worker
+    std::vector< RolloutSample > samples_; ///< @brief Samples of the current cycle in scoring order
+    RolloutStart rollout_start_;
+    std::vector< int > rollout_order_; ///< @brief Indices of samples_ in the order they are rolled out, best guess first
+    std::atomic< double > forward_best_; ///< @brief Lowest cost of a forward sample rolled out in this cycle, -1 if none
+    double last_best_vx_, last_best_vtheta_; ///< @brief Velocity chosen in the last cycle, seeds the rollout order
+    bool last_best_valid_;
+    double rollout_time_; ///< @brief Seconds spent rolling out since the last report
+    int rollout_cycles_;
+    long rollout_steps_; ///< @brief Steps simulated since the last report
+    int rollout_pruned_; ///< @brief Samples stopped by the bound since the last report
+
+    TrajectoryPrimitives primitives_; ///< @brief Robot frame rollouts of the samples seen so far
+    std::vector< TrajectoryPrimitive* > primitive_misses_; ///< @brief Primitives added in this cycle, built before the rollouts
+    int primitive_lookups_, primitive_hits_; ///< @brief Since the last report
+    int path_updates_, goal_updates_; ///< @brief Distance maps propagated since the last report
+
+    std::vector< std::pair< unsigned int, unsigned int > > heading_plan_; ///< @brief Cells of global_plan_ in the costmap, repeated cells dropped
+    std::vector< std::atomic< int > > heading_goals_; ///< @brief headingGoal of the cells around the robot, -2 until a rollout asks for it
+    int heading_x_, heading_y_; ///< @brief The costmap cell of the first entry of heading_goals_
+    unsigned int heading_size_; ///< @brief The side of the square of cells heading_goals_ covers
 
     /**
      * @brief  Compute x position based on velocity
@@ -383,12 +535,12 @@ namespace NS_Planner
       return std::max(vg, vi - a_max * dt);
     }
 
-    void getMaxSpeedToStopInTime(double time, double& vx, double& vy,
-                                 double& vth)
+    void getMaxSpeedToStopInTime(const TrajectoryPlannerConfig& cfg, double time,
+                                 double& vx, double& vy, double& vth)
     {
-      vx = acc_lim_x_ * std::max(time, 0.0);
-      vy = acc_lim_y_ * std::max(time, 0.0);
-      vth = acc_lim_theta_ * std::max(time, 0.0);
+      vx = cfg.acc_lim_x * std::max(time, 0.0);
+      vy = cfg.acc_lim_y * std::max(time, 0.0);
+      vth = cfg.acc_lim_theta * std::max(time, 0.0);
     }
 
     double
@@ -397,6 +549,20 @@ namespace NS_Planner
     pointCost(int x, int y);
     double
     headingDiff(int cell_x, int cell_y, double x, double y, double heading);
+
+    /**
+     * @brief  Find the cells of the plan for this cycle and forget the line of sight found in the last one
+     * @param reach How far from (x, y) a rollout can get by the heading scoring timestep
+     */
+    void
+    prepareHeadingGoals(double x, double y, double reach,
+                        const TrajectoryPlannerConfig& cfg);
+
+    /**
+     * @brief  Index in heading_plan_ of the farthest plan cell with a clear line of sight from a cell, -1 if there is none
+     */
+    int
+    headingGoal(int cell_x, int cell_y);
   };
 }
 ;
@@ -0,0 +1,266 @@
+#include "TrajectoryPrimitives.h"
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+namespace NS_Planner
+{
+  /// primitives kept, one is a few kilobytes, at least two start bins are kept whatever the samples
+  static const size_t TRAJECTORY_PRIMITIVES_CAPACITY = 4096;
+
+  TrajectoryPrimitives::TrajectoryPrimitives()
+      : cycle_(0), vel_bin_(0), theta_bin_(0), sim_time_(0),
+        sim_granularity_(0), angular_sim_granularity_(0),
+        heading_scoring_(false), acc_x_(0), acc_theta_(0), swept_step_(0)
+  {
+  }
+
+  bool TrajectoryPrimitives::Key::operator<(const Key& other) const
+  {
+    if(vx != other.vx)
+      return vx < other.vx;
+    if(vtheta != other.vtheta)
+      return vtheta < other.vtheta;
+    if(vx_samp != other.vx_samp)
+      return vx_samp < other.vx_samp;
+    return vtheta_samp < other.vtheta_samp;
+  }
+
+  void TrajectoryPrimitives::setModel(double vel_bin, double theta_bin,
+                                      double sim_time, double sim_granularity,
+                                      double angular_sim_granularity,
+                                      bool heading_scoring, double acc_x,
+                                      double acc_theta,
+                                      const std::vector< Point2D >& footprint,
+                                      double resolution)
+  {
+    bool same_footprint = footprint.size() == footprint_.size();
+    for(size_t i = 0; same_footprint && i < footprint.size(); i++)
+      same_footprint = footprint[i].x() == footprint_[i].x()
+          && footprint[i].y() == footprint_[i].y();
+
+    if(same_footprint && vel_bin == vel_bin_ && theta_bin == theta_bin_
+        && sim_time == sim_time_ && sim_granularity == sim_granularity_
+        && angular_sim_granularity == angular_sim_granularity_
+        && heading_scoring == heading_scoring_ && acc_x == acc_x_
+        && acc_theta == acc_theta_ && resolution / 2 == swept_step_)
+      return;
+
+    library_.clear();
+    start_used_.clear();
+    vel_bin_ = vel_bin;
+    theta_bin_ = theta_bin;
+    sim_time_ = sim_time;
+    sim_granularity_ = sim_granularity;
+    angular_sim_granularity_ = angular_sim_granularity;
+    heading_scoring_ = heading_scoring;
+    acc_x_ = acc_x;
+    acc_theta_ = acc_theta;
+    footprint_ = footprint;
+    swept_step_ = resolution / 2;
+  }
+
+  void TrajectoryPrimitives::use(double vx, double vtheta, size_t samples)
+  {
+    Key k = key(vx, vtheta, 0, 0);
+    start_used_[std::make_pair(k.vx, k.vtheta)] = ++cycle_;
+
+    /*
+     * 同一周期的采样共用一个起始速度分箱，按分箱整体淘汰最久没用的，
+     * 本周期的分箱最新，不会被淘汰，上个周期交出去的指针也不再使用
+     */
+    size_t bins = std::max((size_t)2,
+                           TRAJECTORY_PRIMITIVES_CAPACITY
+                               / std::max((size_t)1, samples));
+    while(start_used_.size() > bins)
+    {
+      std::map< std::pair< int, int >, unsigned int >::iterator oldest =
+          start_used_.begin();
+      for(std::map< std::pair< int, int >, unsigned int >::iterator it =
+          start_used_.begin(); it != start_used_.end(); ++it)
+        if(it->second < oldest->second)
+          oldest = it;
+      // the library is ordered by the start bin first
+      Key first = {oldest->first.first, oldest->first.second, INT_MIN, INT_MIN};
+      Key last = {oldest->first.first, oldest->first.second, INT_MAX, INT_MAX};
+      library_.erase(library_.lower_bound(first), library_.upper_bound(last));
+      start_used_.erase(oldest);
+    }
+  }
+
+  TrajectoryPrimitives::Key TrajectoryPrimitives::key(double vx,
+                                                      double vtheta,
+                                                      double vx_samp,
+                                                      double vtheta_samp) const
+  {
+    Key k;
+    k.vx = (int)floor(vx / vel_bin_ + 0.5);
+    k.vtheta = (int)floor(vtheta / theta_bin_ + 0.5);
+    k.vx_samp = (int)floor(vx_samp / vel_bin_ + 0.5);
+    k.vtheta_samp = (int)floor(vtheta_samp / theta_bin_ + 0.5);
+    return k;
+  }
+
+  TrajectoryPrimitive* TrajectoryPrimitives::find(double vx, double vtheta,
+                                                  double vx_samp,
+                                                  double vtheta_samp)
+  {
+    std::map< Key, TrajectoryPrimitive >::iterator it = library_.find(
+        key(vx, vtheta, vx_samp, vtheta_samp));
+    return it == library_.end() ? NULL : &it->second;
+  }
+
+  TrajectoryPrimitive* TrajectoryPrimitives::add(double vx, double vtheta,
+                                                 double vx_samp,
+                                                 double vtheta_samp)
+  {
+    Key k = key(vx, vtheta, vx_samp, vtheta_samp);
+    TrajectoryPrimitive& primitive = library_[k];
+    primitive.vx = k.vx * vel_bin_;
+    primitive.vtheta = k.vtheta * theta_bin_;
+    primitive.vx_samp = k.vx_samp * vel_bin_;
+    primitive.vtheta_samp = k.vtheta_samp * theta_bin_;
+    return &primitive;
+  }
+
+  void TrajectoryPrimitives::build(TrajectoryPrimitive& primitive) const
+  {
+    // the same steps as TrajectoryPlanner::generateTrajectory from the origin
+    int num_steps;
+    if(!heading_scoring_)
+      num_steps = int(
+          std::max((fabs(primitive.vx_samp) * sim_time_) / sim_granularity_,
+                   fabs(primitive.vtheta_samp) / angular_sim_granularity_)
+              + 0.5);
+    else
+      num_steps = int(sim_time_ / sim_granularity_ + 0.5);
+    if(num_steps == 0)
+      num_steps = 1;
+    double dt = sim_time_ / num_steps;
+
+    primitive.x.resize(num_steps);
+    primitive.y.resize(num_steps);
+    primitive.theta.resize(num_steps);
+
+    double x = 0, y = 0, theta = 0;
+    double vx = primitive.vx, vtheta = primitive.vtheta;
+    for(int i = 0; i < num_steps; i++)
+    {
+      primitive.x[i] = x;
+      primitive.y[i] = y;
+      primitive.theta[i] = theta;
+
+      if(primitive.vx_samp >= vx)
+        vx = std::min(primitive.vx_samp, vx + acc_x_ * dt);
+      else
+        vx = std::max(primitive.vx_samp, vx - acc_x_ * dt);
+      if(primitive.vtheta_samp >= vtheta)
+        vtheta = std::min(primitive.vtheta_samp, vtheta + acc_theta_ * dt);
+      else
+        vtheta = std::max(primitive.vtheta_samp, vtheta - acc_theta_ * dt);
+
+      x += vx * cos(theta) * dt;
+      y += vx * sin(theta) * dt;
+      theta += vtheta * dt;
+    }
+  }
+
+  void TrajectoryPrimitives::sweep(TrajectoryPrimitive& primitive)
+  {
+    if(primitive.swept.load(std::memory_order_acquire))
+      return;
+    boost::mutex::scoped_lock lock(sweep_mutex_);
+    if(primitive.swept.load(std::memory_order_relaxed))
+      return;
+    fillSwept(primitive);
+    primitive.swept.store(true, std::memory_order_release);
+  }
+
+  void TrajectoryPrimitives::fillSwept(TrajectoryPrimitive& primitive) const
+  {
+    primitive.swept_x.clear();
+    primitive.swept_y.clear();
+    if(footprint_.size() < 3)
+      return;
+
+    /*
+     * 格点步长 s 为半个栅格，旋转平移后到任一栅格中心的最近格点距离不超过 s/√2，
+     * 仍落在该栅格内；足迹只要压到这个栅格，该格点距足迹就不超过 (2s + s)/√2。
+     * 因此取距某个姿态下填充足迹不超过这个距离的全部格点，跳过的姿态与保留姿态
+     * 的足迹相差不到 s/2 再加上，结果覆盖 CostmapModel 在各个姿态下检查的栅格，
+     * 只会多不会少
+     */
+    double radius = 0;
+    for(size_t j = 0; j < footprint_.size(); j++)
+      radius = std::max(radius,
+                        (double)hypot(footprint_[j].x(), footprint_[j].y()));
+    double reach = 3 * swept_step_ / sqrt(2.0) + swept_step_ / 2 + 1e-6;
+    double extent = radius + reach;
+    for(size_t i = 0; i < primitive.x.size(); i++)
+      extent = std::max(
+          extent,
+          std::max(fabs(primitive.x[i]), fabs(primitive.y[i])) + radius + reach);
+    int half = (int)ceil(extent / swept_step_) + 2, width = 2 * half + 1;
+    std::vector< bool > seen(width * width, false);
+
+    // poses whose footprint moved less than half a lattice step add nothing new
+    int last = -1;
+    for(size_t i = 0; i < primitive.x.size(); i++)
+    {
+      if(last >= 0 && i + 1 < primitive.x.size()
+          && hypot(primitive.x[i] - primitive.x[last],
+                   primitive.y[i] - primitive.y[last])
+              + fabs(primitive.theta[i] - primitive.theta[last]) * radius
+              < swept_step_ / 2)
+        continue;
+      last = i;
+      double c = cos(primitive.theta[i]), s = sin(primitive.theta[i]);
+      int min_qx = (int)floor((primitive.x[i] - radius - reach) / swept_step_);
+      int max_qx = (int)ceil((primitive.x[i] + radius + reach) / swept_step_);
+      int min_qy = (int)floor((primitive.y[i] - radius - reach) / swept_step_);
+      int max_qy = (int)ceil((primitive.y[i] + radius + reach) / swept_step_);
+      for(int qy = min_qy; qy <= max_qy; qy++)
+      {
+        for(int qx = min_qx; qx <= max_qx; qx++)
+        {
+          int index = (qy + half) * width + qx + half;
+          if(seen[index])
+            continue;
+          //the lattice point in the frame of the pose
+          double dx = qx * swept_step_ - primitive.x[i];
+          double dy = qy * swept_step_ - primitive.y[i];
+          if(dx * dx + dy * dy > (radius + reach) * (radius + reach))
+            continue;
+          double fx = dx * c + dy * s, fy = -dx * s + dy * c;
+          bool inside = false, near = false;
+          for(size_t j = 0, k = footprint_.size() - 1;
+              !near && j < footprint_.size(); k = j++)
+          {
+            double ax = footprint_[k].x(), ay = footprint_[k].y();
+            double bx = footprint_[j].x(), by = footprint_[j].y();
+            if((by > fy) != (ay > fy)
+                && fx < bx + (fy - by) / (ay - by) * (ax - bx))
+              inside = !inside;
+            //distance to the edge
+            double ex = bx - ax, ey = by - ay;
+            double length2 = ex * ex + ey * ey;
+            double t = length2 > 0 ?
+                std::max(0.0,
+                         std::min(1.0, ((fx - ax) * ex + (fy - ay) * ey)
+                                           / length2)) :
+                0.0;
+            double ox = fx - ax - t * ex, oy = fy - ay - t * ey;
+            near = ox * ox + oy * oy <= reach * reach;
+          }
+          if(!inside && !near)
+            continue;
+          seen[index] = true;
+          primitive.swept_x.push_back(qx);
+          primitive.swept_y.push_back(qy);
+        }
+      }
+    }
+  }
+}
+;
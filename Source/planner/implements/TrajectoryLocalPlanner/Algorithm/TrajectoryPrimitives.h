@@ -0,0 +1,132 @@
+#ifndef _BASE_LOCAL_PLANNER_TRAJECTORY_PRIMITIVES_H_
+#define _BASE_LOCAL_PLANNER_TRAJECTORY_PRIMITIVES_H_
+
+#include <vector>
+#include <map>
+#include <atomic>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
+#include "../../../../costmap/utils/Footprint.h"
+
+namespace NS_Planner
+{
+  /**
+   * @brief A trajectory rolled out from the origin of the robot frame
+   */
+  struct TrajectoryPrimitive
+  {
+    TrajectoryPrimitive()
+        : swept(false)
+    {
+    }
+
+    /// binned start and sample velocities the primitive is rolled out with
+    double vx, vtheta, vx_samp, vtheta_samp;
+    /// poses in the robot frame, the first one is the origin
+    std::vector< float > x, y, theta;
+    /// points on a lattice of half a cell near the filled footprint at every pose, robot frame,
+    /// they hit every cell the footprint overlaps at any of the poses
+    std::vector< int16_t > swept_x, swept_y;
+    /// swept_x and swept_y are filled, only rollouts that get to the end need them
+    std::atomic< bool > swept;
+  };
+
+  /**
+   * @class TrajectoryPrimitives
+   * @brief A library of robot frame trajectories keyed by the binned start and
+   * sample velocities, filled on demand
+   */
+  class TrajectoryPrimitives
+  {
+  public:
+    TrajectoryPrimitives();
+
+    /**
+     * @brief Set what the primitives are rolled out with, drops the library when any of it changes
+     * @param vel_bin Bin size of x velocities
+     * @param theta_bin Bin size of theta velocities
+     */
+    void
+    setModel(double vel_bin, double theta_bin, double sim_time,
+             double sim_granularity, double angular_sim_granularity,
+             bool heading_scoring, double acc_x, double acc_theta,
+             const std::vector< Point2D >& footprint, double resolution);
+
+    /**
+     * @brief Mark the start bin of this cycle as used, drops the least recently used other start bins
+     * @param samples Samples per cycle, the library keeps as many start bins as fit in its capacity
+     */
+    void
+    use(double vx, double vtheta, size_t samples);
+
+    /**
+     * @brief The primitive closest to the velocities, NULL if there is none yet
+     */
+    TrajectoryPrimitive*
+    find(double vx, double vtheta, double vx_samp, double vtheta_samp);
+
+    /**
+     * @brief Add an empty primitive for the velocities, filled by build()
+     */
+    TrajectoryPrimitive*
+    add(double vx, double vtheta, double vx_samp, double vtheta_samp);
+
+    /**
+     * @brief Roll out a primitive returned by add(), different primitives can be built in parallel
+     */
+    void
+    build(TrajectoryPrimitive& primitive) const;
+
+    /**
+     * @brief Fill the swept footprint of a built primitive once, thread safe
+     */
+    void
+    sweep(TrajectoryPrimitive& primitive);
+
+    /**
+     * @brief Lattice step of the swept points
+     */
+    double
+    sweptStep() const
+    {
+      return swept_step_;
+    }
+
+    size_t
+    size() const
+    {
+      return library_.size();
+    }
+
+  private:
+    struct Key
+    {
+      int vx, vtheta, vx_samp, vtheta_samp;
+
+      bool
+      operator<(const Key& other) const;
+    };
+
+    Key
+    key(double vx, double vtheta, double vx_samp, double vtheta_samp) const;
+
+    void
+    fillSwept(TrajectoryPrimitive& primitive) const;
+
+    std::map< Key, TrajectoryPrimitive > library_;
+    /// binned start velocities in library_ and the cycle they were last used in
+    std::map< std::pair< int, int >, unsigned int > start_used_;
+    unsigned int cycle_;
+
+    double vel_bin_, theta_bin_;
+    double sim_time_, sim_granularity_, angular_sim_granularity_;
+    bool heading_scoring_;
+    double acc_x_, acc_theta_;
+    std::vector< Point2D > footprint_;
+    double swept_step_;
+    boost::mutex sweep_mutex_;
+  };
+}
+;
+
+#endif
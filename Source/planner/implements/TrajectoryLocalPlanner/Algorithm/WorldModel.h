@@ -27,7 +27,15 @@ namespace NS_Planner
                   const std::vector< Point2D >& footprint,
                   double inscribed_radius, double circumscribed_radius) = 0;
 
-    double footprintCost(
+    /**
+     * @brief  Checks the footprint of the robot at a pose, the footprint is turned and moved to the pose here by default
+     * @param  x The x position of the robot in world coordinates
+     * @param  y The y position of the robot in world coordinates
+     * @param  theta The orientation of the robot
+     * @param  footprint_spec The specification of the footprint of the robot in the robot frame
+     * @return Positive if all the points lie outside the footprint, negative otherwise
+     */
+    virtual double footprintCost(
         double x, double y, double theta,
         const std::vector< Point2D >& footprint_spec,
         double inscribed_radius = 0.0, double circumscribed_radius = 0.0)
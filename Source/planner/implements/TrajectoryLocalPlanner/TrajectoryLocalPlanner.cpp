@@ -3,6 +3,7 @@
 #include <sys/time.h>
 #include <boost/tokenizer.hpp>
 #include <cmath>
+#include <algorithm>
 #include <Console/Console.h>
 #include "Algorithm/GoalFunctions.h"
 #include <Parameter/Parameter.h>
@@ -17,6 +18,7 @@ namespace NS_Planner
     setup_ = false;
     initialized_ = false;
     odom_helper_ = NULL;
+    plan_offset_ = 0;
   }
 
   void TrajectoryLocalPlanner::onInitialize()
@@ -170,7 +172,35 @@ namespace NS_Planner
       int simple_attractor_i = parameter.getParameter("simple_attractor", 0);
       simple_attractor = bool(simple_attractor_i);
 
-      world_model_ = new CostmapModel(*costmap_);
+      // 0 for one rollout thread per core
+      int rollout_threads = parameter.getParameter("rollout_threads", 0);
+
+      int primitive_cache = parameter.getParameter("primitive_cache", 0);
+      double primitive_vel_bin = parameter.getParameter("primitive_vel_bin", 0.01f);
+      double primitive_theta_bin = parameter.getParameter("primitive_theta_bin", 0.02f);
+
+      CostmapModel* costmap_model = new CostmapModel(*costmap_);
+      world_model_ = costmap_model;
+
+      // let the footprint checks read the clearance when the costmap keeps it
+      if(parameter.getParameter("clearance_check", 1) == 1)
+      {
+        std::vector< boost::shared_ptr< NS_CostMap::CostmapLayer > >* layers =
+            costmap->getLayeredCostmap()->getPlugins();
+        for(size_t i = 0; i < layers->size(); i++)
+        {
+          boost::shared_ptr< NS_CostMap::DistanceLayer > distance_layer =
+              boost::dynamic_pointer_cast< NS_CostMap::DistanceLayer >(
+                  layers->at(i));
+          if(distance_layer)
+          {
+            costmap_model->setDistanceLayer(distance_layer.get(),
+                                            occdist_scale == 0);
+            logInfo << "footprint checks use the clearance of the distance layer";
+            break;
+          }
+        }
+      }
 
       footprint_spec_ = costmap->getRobotFootprint();
       if(footprint_spec_.size() == 0){
@@ -198,7 +228,17 @@ namespace NS_Planner
                                   heading_scoring_timestep, meter_scoring,
                                   simple_attractor, y_vels, stop_time_buffer,
                                   sim_period_, angular_sim_granularity,
-                                  circums_radius, inscribe_radius);
+                                  circums_radius, inscribe_radius,
+                                  rollout_threads);
+
+      TrajectoryPlannerConfig config = *tc_->getConfig();
+      config.primitive_cache = primitive_cache == 1;
+      config.primitive_vel_bin = primitive_vel_bin;
+      config.primitive_theta_bin = primitive_theta_bin;
+      tc_->reconfigure(config);
+
+      // the path and goal distances are kept while the costmap under them does not change
+      tc_->setLayeredCostmap(costmap->getLayeredCostmap());
 
       initialized_ = true;
 
@@ -336,6 +376,7 @@ namespace NS_Planner
     //reset the global plan
     global_plan_.clear();
     global_plan_ = orig_global_plan;
+    plan_offset_ = 0;
 
     //when we get a new plan, we also want to clear any latch we may have on goal tolerances
     xy_tolerance_latch_ = false;
@@ -344,6 +385,24 @@ namespace NS_Planner
     return true;
   }
 
+  bool TrajectoryLocalPlanner::replacePlanSuffix(
+      const std::vector< Pose2D >& plan, size_t index)
+  {
+    if(!isInitialized() || index >= plan.size()
+        || plan_offset_ + global_plan_.size() < index
+        || plan.size() < plan_offset_)
+      return false;
+
+    // poses pruned already are not put back
+    size_t first = std::max(index, plan_offset_);
+    global_plan_.resize(first - plan_offset_);
+    global_plan_.insert(global_plan_.end(), plan.begin() + first, plan.end());
+    printf("trajectory::replace plan suffix from %d, plan size = %d\n",
+           (int)index, (int)global_plan_.size());
+    reached_goal_ = false;
+    return true;
+  }
+
   bool TrajectoryLocalPlanner::computeVelocityCommands(
 		  Velocity2D& cmd_vel)
   {
@@ -381,7 +440,11 @@ namespace NS_Planner
     logInfo<<"remove transformed plan,maybe prune_plan can be removed at the meantime";
 
     if(prune_plan_)
+    {
+      size_t plan_size = global_plan_.size();
       prunePlan(global_pose, global_plan_, global_plan_);
+      plan_offset_ += plan_size - global_plan_.size();
+    }
 
     logInfo << "compute vel global_pose x = "<<global_pose.x()<<",y = "<<global_pose.y()<<",theta = "<<global_pose.theta();
 
@@ -60,6 +60,15 @@ namespace NS_Planner
     virtual bool
     setPlan(const std::vector< Pose2D >& orig_global_plan);
 
+    /**
+     * @brief  Replace the plan from index on, the goal tolerance latch is kept
+     * @param plan The whole new plan, its poses before index are the current ones
+     * @param index First pose of plan that differs from the current one
+     * @return True if the plan was updated successfully, false otherwise
+     */
+    virtual bool
+    replacePlanSuffix(const std::vector< Pose2D >& plan, size_t index);
+
     /**
      * @brief  Check if the goal pose has been achieved
      * @return True if achieved, false otherwise
@@ -158,6 +167,8 @@ namespace NS_Planner
     double xy_goal_tolerance_, yaw_goal_tolerance_, min_in_place_vel_th_;
     std::vector< Pose2D > global_plan_;
     bool prune_plan_;
+    /// poses pruned off the front of global_plan_ since the last setPlan
+    size_t plan_offset_;
     boost::recursive_mutex odom_lock_;
 
     double max_vel_th_, min_vel_th_;